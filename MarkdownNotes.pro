@@ -1,4 +1,4 @@
-QT       += core gui widgets pdf pdfwidgets printsupport svg network
+QT       += core gui widgets pdf pdfwidgets printsupport svg network concurrent sql
 
 CONFIG   += c++20
 
@@ -7,17 +7,55 @@ TARGET = MarkdownNotes
 TEMPLATE = app
 
 SOURCES += \
+    autosavejournal.cpp \
+    documentsnapshot.cpp \
+    formulaimages.cpp \
+    fuzzymatcher.cpp \
+    incrementalpreview.cpp \
+    latexparser.cpp \
+    latexsymbols.cpp \
     main.cpp \
     mainwindow.cpp \
+    markdowndocumentbuilder.cpp \
     markdowneditor.cpp \
     mathrenderer.cpp \
-    pdfviewer.cpp
+    notecatalog.cpp \
+    noteindex.cpp \
+    notelibrary.cpp \
+    notelistmodel.cpp \
+    noteloader.cpp \
+    notesaver.cpp \
+    notesexporter.cpp \
+    pdfviewer.cpp \
+    perfoverlay.cpp \
+    perftrace.cpp \
+    piecetable.cpp \
+    quickopendialog.cpp
 
 HEADERS += \
+    autosavejournal.h \
+    documentsnapshot.h \
+    formulaimages.h \
+    fuzzymatcher.h \
+    incrementalpreview.h \
+    latexparser.h \
+    latexsymbols.h \
     mainwindow.h \
+    markdowndocumentbuilder.h \
     markdowneditor.h \
     mathrenderer.h \
-    pdfviewer.h
+    notecatalog.h \
+    noteindex.h \
+    notelibrary.h \
+    notelistmodel.h \
+    noteloader.h \
+    notesaver.h \
+    notesexporter.h \
+    pdfviewer.h \
+    perfoverlay.h \
+    perftrace.h \
+    piecetable.h \
+    quickopendialog.h
 
 FORMS += \
     mainwindow.ui
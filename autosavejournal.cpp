@@ -0,0 +1,377 @@
+// autosavejournal.cpp
+#include "autosavejournal.h"
+#include "markdowneditor.h"
+#include "perftrace.h"
+
+#include <QTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+constexpr quint32 JournalMagic = 0x4D4E4A31;  // "MNJ1"
+constexpr quint32 JournalVersion = 1;
+
+struct Header
+{
+    QString filePath;
+    QByteArray baseHash;
+    qint64 baseLength = 0;
+};
+
+QByteArray hashText(const QString &text)
+{
+    return QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1);
+}
+
+QByteArray encodeHeader(const Header &header)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << JournalMagic << JournalVersion << header.filePath << header.baseHash << header.baseLength;
+    return bytes;
+}
+
+// 读取文件头，成功时流停在第一条记录之前
+bool readHeader(QDataStream &in, Header *header)
+{
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != JournalMagic || version != JournalVersion) {
+        return false;
+    }
+    in >> header->filePath >> header->baseHash >> header->baseLength;
+    return in.status() == QDataStream::Ok;
+}
+
+// 把日志追加到文件末尾；文件缓冲写入操作系统后，程序崩溃也不会丢失
+void appendToFile(const QString &path, const QByteArray &bytes)
+{
+    PERF_SCOPE("AutosaveJournal::append");
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "无法写入自动保存日志:" << path << file.errorString();
+        return;
+    }
+    if (file.write(bytes) != bytes.size() || !file.flush()) {
+        qWarning() << "写入自动保存日志失败:" << path << file.errorString();
+    }
+}
+
+} // namespace
+
+AutosaveJournal::AutosaveJournal(MarkdownEditor *editor, QObject *parent)
+    : QObject(parent)
+    , m_editor(editor)
+    , m_flushTimer(new QTimer(this))
+{
+    m_pool.setMaxThreadCount(1);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(FlushInterval);
+    connect(m_flushTimer, &QTimer::timeout, this, &AutosaveJournal::flush);
+    connect(m_editor, &MarkdownEditor::edited, this, &AutosaveJournal::onEdited);
+}
+
+AutosaveJournal::~AutosaveJournal()
+{
+    // 编辑器可能已经销毁，这里只等待已经提交的写入
+    m_pool.waitForDone();
+}
+
+void AutosaveJournal::setDirectory(const QString &directory)
+{
+    m_directory = directory;
+    QDir().mkpath(m_directory);
+}
+
+QString AutosaveJournal::journalPath(const QString &filePath) const
+{
+    const QByteArray key = QFileInfo(filePath).absoluteFilePath().toUtf8();
+    return m_directory + "/" + QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex())
+           + ".journal";
+}
+
+QByteArray AutosaveJournal::encodeRecord(const Edit &edit)
+{
+    QByteArray payload;
+    {
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << qint64(edit.position) << qint64(edit.removed) << edit.text;
+    }
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint32(payload.size()) << quint32(qChecksum(payload));
+    record.append(payload);
+    return record;
+}
+
+void AutosaveJournal::begin(const QString &filePath, const DocumentSnapshot &base)
+{
+    m_flushTimer->stop();
+    m_pending.clear();
+    m_filePath = filePath;
+    m_base = base;
+    m_recording = !filePath.isEmpty() && !m_directory.isEmpty();
+    if (!m_recording) {
+        return;
+    }
+
+    const DocumentSnapshot current = m_editor->snapshot();
+    if (current.revision() != base.revision()) {
+        // 保存期间又有输入：日志从新的基准开始，直接记下差异
+        rewrite(current);
+    } else {
+        // 内容与磁盘一致，旧日志不再需要；第一次编辑时再写文件头
+        m_hasHeader = false;
+        m_appendedBytes = 0;
+        const QString path = journalPath(filePath);
+        QtConcurrent::run(&m_pool, [path]() {
+            QFile::remove(path);
+        });
+    }
+}
+
+void AutosaveJournal::stop()
+{
+    if (!m_recording) {
+        return;
+    }
+    flush();
+    m_recording = false;
+}
+
+void AutosaveJournal::resume()
+{
+    m_recording = !m_filePath.isEmpty() && !m_directory.isEmpty();
+}
+
+void AutosaveJournal::discard()
+{
+    m_flushTimer->stop();
+    m_pending.clear();
+    m_recording = false;
+    if (!m_filePath.isEmpty()) {
+        remove(m_filePath);
+    }
+    m_filePath.clear();
+    m_base = DocumentSnapshot();
+    m_hasHeader = false;
+    m_appendedBytes = 0;
+}
+
+void AutosaveJournal::remove(const QString &filePath)
+{
+    if (m_directory.isEmpty()) {
+        return;
+    }
+    const QString path = journalPath(filePath);
+    QtConcurrent::run(&m_pool, [path]() {
+        QFile::remove(path);
+    });
+}
+
+void AutosaveJournal::onEdited(qsizetype position, qsizetype removed, const QString &text)
+{
+    if (!m_recording) {
+        return;
+    }
+
+    // 连续输入合并为一条记录
+    if (!m_pending.isEmpty() && removed == 0) {
+        Edit &last = m_pending.last();
+        if (last.position + last.text.size() == position) {
+            last.text += text;
+            return;
+        }
+    }
+    m_pending.append({position, removed, text});
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void AutosaveJournal::flush()
+{
+    m_flushTimer->stop();
+    if (!m_recording || m_pending.isEmpty()) {
+        return;
+    }
+
+    if (!m_hasHeader || m_appendedBytes > CompactThreshold) {
+        // 第一次写入或记录太多：重写为一条相对基准的差异
+        rewrite(m_editor->snapshot());
+        return;
+    }
+
+    QByteArray bytes;
+    for (const Edit &edit : std::as_const(m_pending)) {
+        bytes += encodeRecord(edit);
+    }
+    m_pending.clear();
+    m_appendedBytes += bytes.size();
+
+    const QString path = journalPath(m_filePath);
+    QtConcurrent::run(&m_pool, [path, bytes]() {
+        appendToFile(path, bytes);
+    });
+}
+
+// 在后台把日志重写为：文件头 + 基准到 current 的一条差异记录（比较公共前缀和后缀）。
+// 重写通过 QSaveFile 完成，中途崩溃时旧日志仍然完整
+void AutosaveJournal::rewrite(const DocumentSnapshot &current)
+{
+    m_pending.clear();
+    m_hasHeader = true;
+    m_appendedBytes = 0;
+
+    const QString path = journalPath(m_filePath);
+    const QString filePath = m_filePath;
+    const DocumentSnapshot base = m_base;
+    QtConcurrent::run(&m_pool, [path, filePath, base, current]() {
+        PERF_SCOPE("AutosaveJournal::rewrite");
+        const QString baseText = base.text();
+        const QString currentText = current.text();
+
+        const qsizetype limit = qMin(baseText.size(), currentText.size());
+        qsizetype prefix = 0;
+        while (prefix < limit && baseText[prefix] == currentText[prefix]) {
+            ++prefix;
+        }
+        qsizetype suffix = 0;
+        while (suffix < limit - prefix
+               && baseText[baseText.size() - 1 - suffix] == currentText[currentText.size() - 1 - suffix]) {
+            ++suffix;
+        }
+
+        Header header;
+        header.filePath = filePath;
+        header.baseHash = hashText(baseText);
+        header.baseLength = baseText.size();
+        QByteArray bytes = encodeHeader(header);
+        if (prefix + suffix < qMax(baseText.size(), currentText.size())) {
+            Edit diff;
+            diff.position = prefix;
+            diff.removed = baseText.size() - prefix - suffix;
+            diff.text = currentText.mid(prefix, currentText.size() - prefix - suffix);
+            bytes += encodeRecord(diff);
+        }
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+            qWarning() << "无法重写自动保存日志:" << path << file.errorString();
+        }
+    });
+}
+
+void AutosaveJournal::waitForFinished()
+{
+    m_pool.waitForDone();
+}
+
+QStringList AutosaveJournal::pendingNotes() const
+{
+    QStringList notes;
+    if (m_directory.isEmpty()) {
+        return notes;
+    }
+
+    const QFileInfoList journals = QDir(m_directory).entryInfoList({"*.journal"}, QDir::Files, QDir::Time);
+    for (const QFileInfo &info : journals) {
+        QFile file(info.absoluteFilePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QDataStream in(&file);
+        Header header;
+        // 只有文件头、没有记录的日志不需要恢复
+        if (readHeader(in, &header) && !file.atEnd() && QFileInfo::exists(header.filePath)
+            && !notes.contains(header.filePath)) {
+            notes.append(header.filePath);
+        }
+    }
+    return notes;
+}
+
+bool AutosaveJournal::recover(const QString &filePath, const DocumentSnapshot &base, QString *recovered,
+                              QDateTime *journalTime) const
+{
+    if (m_directory.isEmpty()) {
+        return false;
+    }
+    const QString path = journalPath(filePath);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray bytes = file.readAll();
+    file.close();
+
+    QDataStream in(bytes);
+    Header header;
+    if (!readHeader(in, &header)) {
+        qWarning() << "自动保存日志已损坏:" << path;
+        return false;
+    }
+    // 只有存在日志时才需要完整文本
+    const QString baseText = base.text();
+    if (header.baseLength != baseText.size() || header.baseHash != hashText(baseText)) {
+        // 日志之后文件在别处被修改过，无法在当前内容上重放
+        qWarning() << "自动保存日志与笔记当前内容不一致，忽略:" << filePath;
+        return false;
+    }
+
+    // 逐条重放；不完整或校验失败的记录（崩溃时正在写入）之后的内容全部忽略
+    PieceTable content = base.content();
+    qsizetype offset = in.device()->pos();
+    int applied = 0;
+    while (offset + 8 <= bytes.size()) {
+        QDataStream frame(bytes.mid(offset, 8));
+        frame.setVersion(QDataStream::Qt_6_0);
+        quint32 length = 0;
+        quint32 checksum = 0;
+        frame >> length >> checksum;
+        if (offset + 8 + qsizetype(length) > bytes.size()) {
+            break;
+        }
+        const QByteArray payload = bytes.mid(offset + 8, length);
+        if (quint32(qChecksum(payload)) != checksum) {
+            break;
+        }
+
+        QDataStream record(payload);
+        record.setVersion(QDataStream::Qt_6_0);
+        qint64 position = 0;
+        qint64 removed = 0;
+        QString text;
+        record >> position >> removed >> text;
+        if (record.status() != QDataStream::Ok || position < 0 || removed < 0
+            || position + removed > content.size()) {
+            break;
+        }
+        content.remove(position, removed);
+        content.insert(position, text);
+        offset += 8 + length;
+        ++applied;
+    }
+
+    if (applied == 0) {
+        return false;
+    }
+    *recovered = content.text();
+    if (journalTime) {
+        *journalTime = QFileInfo(path).lastModified();
+    }
+    return *recovered != baseText;
+}
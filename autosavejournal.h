@@ -0,0 +1,93 @@
+// autosavejournal.h
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include "documentsnapshot.h"
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QThreadPool>
+
+class MarkdownEditor;
+class QTimer;
+
+// 自动保存日志：记录当前笔记自上次保存以来的每次编辑，定期在后台追加到日志文件，
+// 程序崩溃后重新打开该笔记时可以用日志把磁盘上的版本重放到崩溃前的内容。
+// 日志只追加，不重写笔记文件本身；日志超过一定大小时在后台压缩为
+// “上次保存的版本 → 当前内容”的一条差异记录。笔记保存后日志以新的版本为基准重新开始。
+//
+// 日志文件格式：文件头（魔数、版本、笔记路径、基准内容的 SHA-1 和长度），
+// 之后是若干条记录：[长度][校验和][位置、删除长度、插入文本]。
+// 重放时遇到不完整或校验失败的记录就停止，崩溃时写了一半的记录不会影响之前的内容
+class AutosaveJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AutosaveJournal(MarkdownEditor *editor, QObject *parent = nullptr);
+    ~AutosaveJournal();
+
+    // 编辑后多久把记录写入日志（毫秒）
+    static constexpr int FlushInterval = 2000;
+    // 上次压缩后追加的记录超过该大小时压缩
+    static constexpr qint64 CompactThreshold = 1024 * 1024;
+
+    // 日志文件所在目录
+    void setDirectory(const QString &directory);
+    QString directory() const { return m_directory; }
+
+    // 开始记录 filePath 的编辑；base 是磁盘上该文件的内容（刚加载或刚保存的快照）。
+    // 编辑器内容比 base 新时，日志立即记下两者的差异
+    void begin(const QString &filePath, const DocumentSnapshot &base);
+    // 暂停记录，已有的日志保留（例如切换笔记时，之后可以恢复）
+    void stop();
+    // 继续记录 stop() 之前的笔记
+    void resume();
+    // 停止记录并删除日志（修改被用户放弃）
+    void discard();
+    // 把尚未写入的记录提交到后台
+    void flush();
+    // 等待后台写入全部完成
+    void waitForFinished();
+
+    bool isActive() const { return m_recording; }
+
+    // 有未恢复日志的笔记，最近写入的在前
+    QStringList pendingNotes() const;
+    // 用日志重放 base（刚从磁盘加载的笔记内容）。
+    // 没有日志、日志不属于这个版本或者重放后内容没有变化时返回 false
+    bool recover(const QString &filePath, const DocumentSnapshot &base, QString *recovered, QDateTime *journalTime) const;
+    // 删除某个笔记的日志（用户选择不恢复）
+    void remove(const QString &filePath);
+
+private slots:
+    void onEdited(qsizetype position, qsizetype removed, const QString &text);
+
+private:
+    struct Edit
+    {
+        qsizetype position = 0;
+        qsizetype removed = 0;
+        QString text;
+    };
+
+    QString journalPath(const QString &filePath) const;
+    static QByteArray encodeRecord(const Edit &edit);
+    void rewrite(const DocumentSnapshot &current);
+
+    MarkdownEditor *m_editor;
+    QTimer *m_flushTimer;
+    QThreadPool m_pool;          // 单线程，保证写入顺序与提交顺序一致
+    QString m_directory;
+    QString m_filePath;          // 日志对应的笔记
+    bool m_recording = false;
+    DocumentSnapshot m_base;     // 日志的基准内容
+    QList<Edit> m_pending;       // 尚未提交的编辑
+    bool m_hasHeader = false;    // 日志文件已经写好文件头，可以直接追加
+    qint64 m_appendedBytes = 0;  // 上次重写后追加的字节数
+};
+
+#endif // AUTOSAVEJOURNAL_H
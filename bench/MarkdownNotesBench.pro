@@ -0,0 +1,43 @@
+# 预览渲染性能测试工具，无界面运行：
+#   qmake bench/MarkdownNotesBench.pro && make && ./MarkdownNotesBench --help
+# 渲染结果快照和模糊测试（内置样例的快照提交在 bench/golden）：
+#   ./MarkdownNotesBench --golden-check bench/golden    修改分词、分块或公式解析之后比较，有变化时返回非零
+#   ./MarkdownNotesBench --golden-write bench/golden    确认变化符合预期后更新快照，与代码一起提交
+#   ./MarkdownNotesBench --fuzz 2000 --seed 7 --max-ms 500
+#   afl-fuzz -i seeds -o findings -- ./MarkdownNotesBench --fuzz-input @@
+# libFuzzer 版本见 MarkdownNotesFuzz.pro
+QT       += core gui concurrent
+QT       -= widgets
+
+CONFIG   += c++20 console
+CONFIG   -= app_bundle
+
+TARGET = MarkdownNotesBench
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    benchmain.cpp \
+    rendercheck.cpp \
+    ../documentsnapshot.cpp \
+    ../formulaimages.cpp \
+    ../incrementalpreview.cpp \
+    ../latexparser.cpp \
+    ../latexsymbols.cpp \
+    ../markdowndocumentbuilder.cpp \
+    ../mathrenderer.cpp \
+    ../perftrace.cpp \
+    ../piecetable.cpp
+
+HEADERS += \
+    ../documentsnapshot.h \
+    ../formulaimages.h \
+    ../incrementalpreview.h \
+    ../latexparser.h \
+    ../latexsymbols.h \
+    ../markdowndocumentbuilder.h \
+    ../mathrenderer.h \
+    ../perftrace.h \
+    ../piecetable.h \
+    rendercheck.h
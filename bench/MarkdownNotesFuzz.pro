@@ -0,0 +1,43 @@
+# 公式渲染的 libFuzzer 模糊测试，需要 clang：
+#   qmake bench/MarkdownNotesFuzz.pro && make
+#   ./MarkdownNotesFuzz -max_len=20000 -timeout=5 -rss_limit_mb=1024 corpus/
+QT       += core gui concurrent
+QT       -= widgets
+
+CONFIG   += c++20 console
+CONFIG   -= app_bundle
+
+QMAKE_CXX = clang++
+QMAKE_LINK = clang++
+QMAKE_CXXFLAGS += -fsanitize=fuzzer,address,undefined -g
+QMAKE_LFLAGS += -fsanitize=fuzzer,address,undefined
+
+TARGET = MarkdownNotesFuzz
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    fuzzmain.cpp \
+    rendercheck.cpp \
+    ../documentsnapshot.cpp \
+    ../formulaimages.cpp \
+    ../incrementalpreview.cpp \
+    ../latexparser.cpp \
+    ../latexsymbols.cpp \
+    ../markdowndocumentbuilder.cpp \
+    ../mathrenderer.cpp \
+    ../perftrace.cpp \
+    ../piecetable.cpp
+
+HEADERS += \
+    ../documentsnapshot.h \
+    ../formulaimages.h \
+    ../incrementalpreview.h \
+    ../latexparser.h \
+    ../latexsymbols.h \
+    ../markdowndocumentbuilder.h \
+    ../mathrenderer.h \
+    ../perftrace.h \
+    ../piecetable.h \
+    rendercheck.h
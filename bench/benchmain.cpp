@@ -0,0 +1,487 @@
+// benchmain.cpp
+// 预览渲染性能测试：加载合成笔记和真实笔记，离屏运行各个渲染阶段，
+// 输出每个阶段的耗时、内存分配次数和吞吐量，并可与基线结果比较。
+// 另外提供渲染结果快照比较和模糊测试（见 rendercheck.h）
+#include "mathrenderer.h"
+#include "incrementalpreview.h"
+#include "rendercheck.h"
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextDocument>
+#include <QAbstractTextDocumentLayout>
+#include <QTemporaryDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QDebug>
+
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+// 统计 operator new 的调用次数和字节数。
+// Qt 的字符串和容器直接使用 malloc，不在统计范围内，这里反映的是节点和对象的分配
+namespace {
+std::atomic<quint64> allocationCount{0};
+std::atomic<quint64> allocationBytes{0};
+}
+
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+quint64 totalAllocatedBytes()
+{
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+
+struct Note
+{
+    QString name;
+    QString text;
+    int formulas = 0;
+};
+
+struct StageResult
+{
+    QString note;
+    QString stage;
+    double medianMs = 0;
+    double minMs = 0;
+    quint64 allocations = 0;
+    quint64 allocatedBytes = 0;
+    double megabytesPerSecond = 0;
+    double formulasPerSecond = 0;
+};
+
+// 生成合成笔记：段落数、公式密度（每段公式数）、图片数可调，随机种子固定保证结果可重复
+QString syntheticNote(int paragraphs, int formulasPerParagraph, int images, quint32 seed)
+{
+    static const QStringList words = {
+        "Markdown", "笔记", "预览", "渲染", "公式", "editor", "notes", "render", "layout", "文本",
+        "ཡི་གེ", "དཔེ་དེབ", "quick", "brown", "fox", "数据", "结构", "算法"
+    };
+    static const QStringList simpleFormulas = {
+        "x^2", "a_i", "\\alpha + \\beta", "e^{i\\pi}", "\\sum_{i=1}^{n} i", "x \\leq y", "\\Delta t"
+    };
+    static const QStringList complexFormulas = {
+        "\\frac{a+b}{c}", "\\sqrt{x^2+y^2}", "\\frac{1}{\\sqrt{2\\pi}} e^{-x^2}",
+        "\\sqrt[3]{\\frac{p}{q}}", "x_{i_j}^{2}"
+    };
+
+    QRandomGenerator random(seed);
+    auto pick = [&](const QStringList &list) { return list[random.bounded(int(list.size()))]; };
+
+    QString text;
+    QTextStream out(&text);
+    int imagesLeft = images;
+    for (int p = 0; p < paragraphs; ++p) {
+        switch (p % 12) {
+        case 0:
+            out << "## " << pick(words) << " " << p << "\n\n";
+            break;
+        case 5:
+            out << "- " << pick(words) << " $" << pick(simpleFormulas) << "$\n"
+                << "- " << pick(words) << "\n"
+                << "  - " << pick(words) << "\n\n";
+            break;
+        case 8:
+            out << "```cpp\nint value = " << p << "; // $not math$\n```\n\n";
+            break;
+        case 10:
+            out << "$$\n" << pick(complexFormulas) << "\n$$\n\n";
+            break;
+        default:
+            break;
+        }
+
+        for (int w = 0; w < 40; ++w) {
+            out << pick(words) << (w % 7 == 6 ? "，" : " ");
+            if (formulasPerParagraph > 0 && w % qMax(1, 40 / formulasPerParagraph) == 0) {
+                const bool complex = random.bounded(4) == 0;
+                out << "$" << (complex ? pick(complexFormulas) : pick(simpleFormulas)) << "$ ";
+            }
+        }
+        if (imagesLeft > 0 && p % 4 == 3) {
+            out << "![图片" << imagesLeft << "](images/figure" << imagesLeft << ".png)";
+            --imagesLeft;
+        }
+        out << "\n\n";
+    }
+    out.flush();
+    return text;
+}
+
+int countFormulas(const QString &text)
+{
+    int count = 0;
+    const QList<MathSpan> spans = MathRenderer::tokenize(text);
+    for (const MathSpan &span : spans) {
+        if (span.kind != MathSpan::Text) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+QList<Note> loadCorpus(const QString &directory, bool quick)
+{
+    QList<Note> notes;
+    auto add = [&](const QString &name, const QString &text) {
+        Note note;
+        note.name = name;
+        note.text = text;
+        note.formulas = countFormulas(text);
+        notes.append(note);
+    };
+
+    add("small-plain", syntheticNote(10, 0, 0, 1));
+    add("small-math", syntheticNote(10, 4, 1, 2));
+    add("medium-plain", syntheticNote(200, 0, 5, 3));
+    add("medium-math", syntheticNote(200, 4, 5, 4));
+    if (!quick) {
+        add("large-math", syntheticNote(2000, 2, 40, 5));
+        add("dense-math", syntheticNote(500, 20, 0, 6));
+    }
+
+    // 真实笔记：目录下所有 .md 文件
+    if (!directory.isEmpty()) {
+        QDirIterator it(directory, {"*.md"}, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly)) {
+                qWarning() << "无法读取笔记:" << path;
+                continue;
+            }
+            add(QDir(directory).relativeFilePath(path), QString::fromUtf8(file.readAll()));
+        }
+    }
+    return notes;
+}
+
+// 重复运行一个阶段，取中位数；prepare 在计时之外执行
+template<typename Prepare, typename Body>
+StageResult measure(const Note &note, const QString &stage, int iterations, Prepare prepare, Body body)
+{
+    QList<double> times;
+    quint64 allocations = 0;
+    quint64 bytes = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        prepare();
+        const quint64 countBefore = allocationCount.load();
+        const quint64 bytesBefore = allocationBytes.load();
+        QElapsedTimer timer;
+        timer.start();
+        body();
+        times.append(timer.nsecsElapsed() / 1e6);
+        allocations += allocationCount.load() - countBefore;
+        bytes += allocationBytes.load() - bytesBefore;
+    }
+
+    std::sort(times.begin(), times.end());
+    StageResult result;
+    result.note = note.name;
+    result.stage = stage;
+    result.medianMs = times[times.size() / 2];
+    result.minMs = times.first();
+    result.allocations = allocations / quint64(iterations);
+    result.allocatedBytes = bytes / quint64(iterations);
+    const double seconds = qMax(result.medianMs, 1e-6) / 1000.0;
+    result.megabytesPerSecond = note.text.toUtf8().size() / (1024.0 * 1024.0) / seconds;
+    result.formulasPerSecond = note.formulas / seconds;
+    return result;
+}
+
+QList<StageResult> runNote(const Note &note, int iterations, const QString &cacheRoot)
+{
+    QList<StageResult> results;
+    static int round = 0;   // 每次预览使用独立的公式缓存目录
+
+    // 1. 词法分析
+    results.append(measure(note, "tokenize", iterations, [] {}, [&] {
+        volatile qsizetype spans = MathRenderer::tokenize(note.text).size();
+        Q_UNUSED(spans);
+    }));
+
+    // 2. HTML 渲染：冷缓存（每次新建渲染器）与热缓存
+    std::unique_ptr<MathRenderer> renderer;
+    results.append(measure(note, "html-cold", iterations,
+                           [&] { renderer = std::make_unique<MathRenderer>(); },
+                           [&] { renderer->renderMarkdownWithMath(note.text); }));
+    results.append(measure(note, "html-warm", iterations, [] {},
+                           [&] { renderer->renderMarkdownWithMath(note.text); }));
+
+    // 3. 完整预览路径：切分、逐块生成文档、打补丁到预览文档。
+    //    每次使用新的公式图片缓存目录，包含排版和写入磁盘的开销
+    std::unique_ptr<QTextDocument> document;
+    std::unique_ptr<IncrementalPreview> preview;
+    auto makePreview = [&] {
+        preview.reset();
+        document = std::make_unique<QTextDocument>();
+        renderer = std::make_unique<MathRenderer>();
+        renderer->formulaImages()->setCacheDirectory(cacheRoot + QString("/round-%1").arg(round++));
+        MathRenderer *math = renderer.get();
+        preview = std::make_unique<IncrementalPreview>(document.get(),
+                                                       [math](const QString &source, MarkdownBlock::Kind) {
+                                                           return math->renderMarkdownFragment(source);
+                                                       });
+    };
+    results.append(measure(note, "preview-full", iterations, makePreview,
+                           [&] { preview->update(note.text); }));
+
+    // 4. 在笔记中间输入一个字符后的增量更新
+    const qsizetype editAt = note.text.size() / 2;
+    QString edited = note.text;
+    edited.insert(editAt, QChar(u'x'));
+    results.append(measure(note, "preview-edit", iterations,
+                           [&] {
+                               makePreview();
+                               preview->update(note.text);
+                               preview->noteChange(int(editAt), 0, 1);
+                           },
+                           [&] { preview->update(edited); }));
+
+    // 5. 预览文档的首次排版
+    results.append(measure(note, "layout", iterations,
+                           [&] {
+                               makePreview();
+                               preview->update(note.text);
+                           },
+                           [&] {
+                               document->setTextWidth(800);
+                               volatile qreal height = document->documentLayout()->documentSize().height();
+                               Q_UNUSED(height);
+                           }));
+
+    preview.reset();
+    return results;
+}
+
+QJsonObject toJson(const StageResult &result)
+{
+    QJsonObject object;
+    object["note"] = result.note;
+    object["stage"] = result.stage;
+    object["medianMs"] = result.medianMs;
+    object["minMs"] = result.minMs;
+    object["allocations"] = double(result.allocations);
+    object["allocatedBytes"] = double(result.allocatedBytes);
+    object["mbPerSecond"] = result.megabytesPerSecond;
+    object["formulasPerSecond"] = result.formulasPerSecond;
+    return object;
+}
+
+// 与基线比较，返回变慢超过容差的阶段数
+int compareWithBaseline(const QList<StageResult> &results, const QString &path, double tolerance)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法读取基线文件:" << path;
+        return 0;
+    }
+    QHash<QString, double> baseline;
+    const QJsonArray entries = QJsonDocument::fromJson(file.readAll()).object().value("results").toArray();
+    for (const QJsonValue &value : entries) {
+        const QJsonObject object = value.toObject();
+        baseline.insert(object["note"].toString() + "/" + object["stage"].toString(), object["medianMs"].toDouble());
+    }
+
+    QTextStream out(stdout);
+    int regressions = 0;
+    for (const StageResult &result : results) {
+        const QString key = result.note + "/" + result.stage;
+        if (!baseline.contains(key)) {
+            continue;
+        }
+        const double before = baseline.value(key);
+        // 太短的阶段受计时抖动影响大，不参与比较
+        if (before < 0.5 && result.medianMs < 0.5) {
+            continue;
+        }
+        const double change = (result.medianMs - before) / qMax(before, 1e-6) * 100.0;
+        if (change > tolerance) {
+            out << "REGRESSION " << key << ": " << QString::number(before, 'f', 2) << " ms -> "
+                << QString::number(result.medianMs, 'f', 2) << " ms (+" << QString::number(change, 'f', 1) << "%)\n";
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 默认离屏运行，不需要显示器
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("MarkdownNotesBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("MarkdownNotes 预览渲染性能测试");
+    parser.addHelpOption();
+    QCommandLineOption iterationsOption("iterations", "每个阶段的重复次数", "n", "5");
+    QCommandLineOption corpusOption("corpus", "真实笔记目录（递归读取 .md 文件）", "dir");
+    QCommandLineOption jsonOption("json", "把结果写入 JSON 文件", "file");
+    QCommandLineOption baselineOption("baseline", "与基线 JSON 比较，变慢超过容差时返回非零", "file");
+    QCommandLineOption toleranceOption("tolerance", "允许的变慢百分比", "percent", "15");
+    QCommandLineOption quickOption("quick", "只运行小型合成笔记");
+    QCommandLineOption goldenWriteOption("golden-write", "把内置样例和真实笔记的渲染结果写成快照", "dir");
+    QCommandLineOption goldenCheckOption("golden-check", "与快照比较渲染结果，有变化时返回非零", "dir");
+    QCommandLineOption fuzzOption("fuzz", "生成 n 个对抗性输入检查耗时和分配量", "n");
+    QCommandLineOption seedOption("seed", "模糊测试的随机种子", "seed", "1");
+    QCommandLineOption maxLengthOption("max-length", "模糊测试输入的最大规模", "n", "20000");
+    QCommandLineOption fuzzInputOption("fuzz-input", "检查单个输入文件（- 表示标准输入），供 AFL 等外部工具调用", "file");
+    QCommandLineOption maxMsOption("max-ms", "单个输入允许的最长耗时", "ms", "2000");
+    QCommandLineOption maxMbOption("max-mb", "单个输入允许的分配量", "MB", "256");
+    QCommandLineOption failuresOption("failures", "保存超出限制的输入的目录", "dir", "fuzz-failures");
+    parser.addOptions({iterationsOption, corpusOption, jsonOption, baselineOption, toleranceOption, quickOption,
+                       goldenWriteOption, goldenCheckOption, fuzzOption, seedOption, maxLengthOption,
+                       fuzzInputOption, maxMsOption, maxMbOption, failuresOption});
+    parser.process(app);
+
+    RenderCheck::Limits limits;
+    limits.maxMs = parser.value(maxMsOption).toDouble();
+    limits.maxBytes = parser.value(maxMbOption).toULongLong() << 20;
+    limits.allocatedBytes = totalAllocatedBytes;
+
+    // 检查模式：不运行性能测试
+    if (parser.isSet(goldenWriteOption) || parser.isSet(goldenCheckOption)) {
+        QList<QPair<QString, QString>> cases = RenderCheck::goldenCases();
+        for (const Note &note : loadCorpus(parser.value(corpusOption), true)) {
+            if (note.name.endsWith(".md")) {
+                cases.append(qMakePair("note-" + note.name, note.text));
+            }
+        }
+        if (parser.isSet(goldenWriteOption)) {
+            return RenderCheck::writeGolden(parser.value(goldenWriteOption), cases) > 0 ? 1 : 0;
+        }
+        return RenderCheck::checkGolden(parser.value(goldenCheckOption), cases) > 0 ? 1 : 0;
+    }
+    if (parser.isSet(fuzzInputOption)) {
+        const QString path = parser.value(fuzzInputOption);
+        QFile file(path);
+        const bool opened = path == "-" ? file.open(stdin, QIODevice::ReadOnly) : file.open(QIODevice::ReadOnly);
+        if (!opened) {
+            qWarning() << "无法读取输入:" << path;
+            return 2;
+        }
+        QString reason;
+        if (!RenderCheck::checkInput(QString::fromUtf8(file.readAll()), limits, &reason)) {
+            qWarning().noquote() << "超出限制:" << reason;
+            // 以异常退出的方式报告，AFL 会把它当作崩溃保存
+            std::abort();
+        }
+        return 0;
+    }
+    if (parser.isSet(fuzzOption)) {
+        const int failures = RenderCheck::fuzz(parser.value(fuzzOption).toInt(), parser.value(seedOption).toUInt(),
+                                               parser.value(maxLengthOption).toInt(), limits,
+                                               parser.value(failuresOption));
+        return failures > 0 ? 1 : 0;
+    }
+
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const QList<Note> notes = loadCorpus(parser.value(corpusOption), parser.isSet(quickOption));
+
+    QTemporaryDir cacheRoot;
+    if (!cacheRoot.isValid()) {
+        qWarning() << "无法创建临时目录";
+        return 2;
+    }
+
+    QTextStream out(stdout);
+    out << "operator new counts only; Qt containers allocate with malloc and are not included\n";
+    out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+               .arg("note", -28).arg("stage", -14).arg("median ms", 11).arg("min ms", 10)
+               .arg("allocs", 10).arg("MB/s", 10).arg("formulas/s", 12);
+
+    QList<StageResult> results;
+    for (const Note &note : notes) {
+        const QList<StageResult> noteResults = runNote(note, iterations, cacheRoot.path());
+        for (const StageResult &result : noteResults) {
+            out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                       .arg(result.note.left(28), -28)
+                       .arg(result.stage, -14)
+                       .arg(result.medianMs, 11, 'f', 3)
+                       .arg(result.minMs, 10, 'f', 3)
+                       .arg(result.allocations, 10)
+                       .arg(result.megabytesPerSecond, 10, 'f', 1)
+                       .arg(result.formulasPerSecond, 12, 'f', 0);
+        }
+        out.flush();
+        results.append(noteResults);
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QJsonArray array;
+        for (const StageResult &result : std::as_const(results)) {
+            array.append(toJson(result));
+        }
+        QJsonObject root;
+        root["iterations"] = iterations;
+        root["results"] = array;
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "无法写入结果文件:" << file.fileName();
+            return 2;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    if (parser.isSet(baselineOption)) {
+        const int regressions = compareWithBaseline(results, parser.value(baselineOption),
+                                                    parser.value(toleranceOption).toDouble());
+        if (regressions > 0) {
+            out << regressions << " stage(s) slower than baseline\n";
+            return 1;
+        }
+    }
+    return 0;
+}
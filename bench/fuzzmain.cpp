@@ -0,0 +1,39 @@
+// fuzzmain.cpp
+// libFuzzer 入口：每个输入按 UTF-8 解码后走一遍全部渲染路径。
+// 单个输入的时间和内存限制由 libFuzzer 的 -timeout 和 -rss_limit_mb 控制
+#include "rendercheck.h"
+
+#include <QGuiApplication>
+#include <QString>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+std::unique_ptr<QGuiApplication> application;
+}
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    // 公式图片需要字体，必须先创建 QGuiApplication
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    application = std::make_unique<QGuiApplication>(*argc, *argv);
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size)
+{
+    const QString markdown = QString::fromUtf8(reinterpret_cast<const char *>(data), qsizetype(size));
+
+    // 不统计分配量，只检查耗时；超时和内存由 libFuzzer 兜底
+    RenderCheck::Limits limits;
+    limits.maxMs = 1000;
+    QString reason;
+    if (!RenderCheck::checkInput(markdown, limits, &reason)) {
+        std::abort();
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+// rendercheck.cpp
+#include "rendercheck.h"
+#include "mathrenderer.h"
+#include "incrementalpreview.h"
+#include "latexparser.h"
+
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTextStream>
+#include <QDebug>
+
+#include <functional>
+
+namespace RenderCheck {
+
+namespace {
+
+const char *const kindNames[] = {"text", "inline", "block"};
+
+QString describe(const LatexNode &node);
+
+// 分组和命令参数加上花括号，空参数显示为 {}
+QString describeArgument(const LatexNode &node)
+{
+    return "{" + describe(node) + "}";
+}
+
+QString describeChild(const LatexNode &node)
+{
+    return node.type == LatexNode::Sequence ? describeArgument(node) : describe(node);
+}
+
+// 公式语法树的文字形式：符号命令替换为 Unicode，结构命令保留结构，例如 frac{1}{√[3]{x}}
+QString describe(const LatexNode &node)
+{
+    switch (node.type) {
+    case LatexNode::Sequence: {
+        QString result;
+        for (const LatexNode &child : node.children) {
+            result += describeChild(child);
+        }
+        return result;
+    }
+    case LatexNode::Text:
+    case LatexNode::Symbol:
+        return node.text;
+    case LatexNode::Command:
+        return "\\" + node.text;
+    case LatexNode::Fraction:
+        return "frac" + describeArgument(node.children[0]) + describeArgument(node.children[1]);
+    case LatexNode::SquareRoot:
+        return QStringLiteral("√") + (node.children.size() > 1 ? "[" + describe(node.children[1]) + "]" : QString())
+               + describeArgument(node.children[0]);
+    case LatexNode::Scripts: {
+        QString result = describeChild(node.children[0]);
+        if (node.hasSubscript) {
+            result += "_" + describeArgument(node.children[1]);
+        }
+        if (node.hasSuperscript) {
+            result += "^" + describeArgument(node.children[2]);
+        }
+        return result;
+    }
+    case LatexNode::Styled: {
+        const QString style = node.text == "b" ? "bold" : node.text == "i" ? "italic" : "text";
+        return style + describeArgument(node.children[0]);
+    }
+    }
+    return QString();
+}
+
+// 快照文件名只保留字母、数字和 - _ .，其余字符替换为 _
+QString fileNameFor(const QString &name)
+{
+    QString result = name;
+    for (QChar &c : result) {
+        if (!(c.isLetterOrNumber() && c.unicode() < 128) && c != u'-' && c != u'_' && c != u'.') {
+            c = u'_';
+        }
+    }
+    return result + ".golden";
+}
+
+bool readFile(const QString &path, QString *text)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    *text = QString::fromUtf8(file.readAll());
+    return true;
+}
+
+bool writeFile(const QString &path, const QString &text)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "无法写入文件:" << path;
+        return false;
+    }
+    file.write(text.toUtf8());
+    return true;
+}
+
+// 第一处不同的行号（从 1 开始），相同时返回 0
+int firstDifference(const QString &expected, const QString &actual)
+{
+    const QStringList a = expected.split(u'\n');
+    const QStringList b = actual.split(u'\n');
+    const qsizetype lines = qMax(a.size(), b.size());
+    for (qsizetype i = 0; i < lines; ++i) {
+        if (i >= a.size() || i >= b.size() || a[i] != b[i]) {
+            return int(i + 1);
+        }
+    }
+    return 0;
+}
+
+QString repeated(const QString &piece, int count)
+{
+    return piece.repeated(qMax(0, count));
+}
+
+// 对抗性输入：每个生成器针对一种已知的病态结构，n 控制规模
+using Generator = std::function<QString(QRandomGenerator &, int)>;
+
+QList<QPair<QString, Generator>> generators()
+{
+    static const QStringList tokens = {
+        "$", "$$", "\\", "{", "}", "[", "]", "(", ")", "^", "_", "`", "```", "*", "**", "~~",
+        "<", ">", "!", "|", "#", "- ", "> ", "1. ", "\n", "\n\n", "  \n", " ", "x", "12",
+        "中", "ཀ", "་", "\\frac", "\\sqrt", "\\left(", "\\right)", "\\left.", "\\text{", "\\alpha",
+        "\\mathbf{", "\\sum", "\\\\", "\\$", "](", "![", "<http://a>", "$x$", "$$\n", "\t"
+    };
+
+    return {
+        {"deep-braces", [](QRandomGenerator &, int n) {
+             return "$" + repeated("{", n) + "x" + repeated("}", n) + "$";
+         }},
+        {"unbalanced-braces", [](QRandomGenerator &random, int n) {
+             return "$$" + repeated(random.bounded(2) ? "{" : "}", n) + "x$$";
+         }},
+        {"nested-fractions", [](QRandomGenerator &, int n) {
+             return "$$" + repeated("\\frac{1}{", n) + "x" + repeated("}", n) + "$$";
+         }},
+        {"nested-roots", [](QRandomGenerator &, int n) {
+             return "$" + repeated("\\sqrt[3]{", n) + "y" + repeated("}", n) + "$";
+         }},
+        {"script-chain", [](QRandomGenerator &, int n) {
+             return "$$x" + repeated("^x_y", n) + "$$";
+         }},
+        {"left-chain", [](QRandomGenerator &, int n) {
+             return "$" + repeated("\\left", n) + "($ " + repeated("\\right)", n);
+         }},
+        {"dollars", [](QRandomGenerator &, int n) { return repeated("$", n); }},
+        {"dollar-words", [](QRandomGenerator &, int n) { return repeated("$a ", n); }},
+        {"double-dollars", [](QRandomGenerator &, int n) { return repeated("$$ x", n) + "\n"; }},
+        {"backtick-ladder", [](QRandomGenerator &, int n) {
+             QString text;
+             for (int i = 1; i <= n && text.size() < n * 4; ++i) {
+                 text += repeated("`", i) + " ";
+             }
+             return text;
+         }},
+        {"brackets", [](QRandomGenerator &, int n) { return repeated("[", n) + "a" + repeated("](", n); }},
+        {"angles", [](QRandomGenerator &, int n) { return repeated("<http://", n); }},
+        {"emphasis", [](QRandomGenerator &, int n) { return repeated("**a _b ~~", n); }},
+        {"quotes", [](QRandomGenerator &, int n) { return repeated(">", n) + " text\n" + repeated("> ", n); }},
+        {"lists", [](QRandomGenerator &, int n) {
+             QString text;
+             for (int i = 0; i < n; ++i) {
+                 text += repeated("  ", i % 40) + "- [ ] item $x^" + QString::number(i) + "$\n";
+             }
+             return text;
+         }},
+        {"token-soup", [](QRandomGenerator &random, int n) {
+             QString text;
+             for (int i = 0; i < n; ++i) {
+                 text += tokens[random.bounded(int(tokens.size()))];
+             }
+             return text;
+         }},
+    };
+}
+
+} // namespace
+
+QList<QPair<QString, QString>> goldenCases()
+{
+    return {
+        {"plain", "# 标题\n\n普通段落，**粗体**、*斜体*、~~删除线~~ 和 `代码`。\n"},
+        {"inline-math", "质能方程 $E = mc^2$，希腊字母 $\\alpha + \\beta \\leq \\gamma$。\n"},
+        {"block-math", "$$\n\\sum_{i=1}^{n} i = \\frac{n(n+1)}{2}\n$$\n"},
+        {"fractions", "$\\frac{a+b}{c}$ 与 $\\dfrac{1}{\\frac{1}{x}}$\n"},
+        {"roots", "$\\sqrt{x^2+y^2}$ 和 $\\sqrt[3]{\\frac{p}{q}}$\n"},
+        {"scripts", "$x_{i_j}^{2}$，$e^{i\\pi} + 1 = 0$，$a_1^2$\n"},
+        {"delimiters", "$\\left( \\frac{a}{b} \\right)$ 和 $\\left. x \\right|$\n"},
+        {"text-commands", "$\\text{速度} = \\mathbf{v}$，$\\operatorname{sin} x$\n"},
+        {"prices", "价格 $5 和 $10 不是公式，\\$x\\$ 也不是。\n"},
+        {"code", "行内 `$x$` 不渲染\n\n```\n$$ not math $$\n```\n\n    $y$ 缩进代码\n"},
+        {"unclosed", "未闭合 $x 和 $$y 以及 `代码\n"},
+        {"lists", "- 一 $x^2$\n- [ ] 任务\n- [x] 完成\n  1. 嵌套\n  2. 列表\n"},
+        {"quotes", "> 引用 $a_i$\n>\n> > 嵌套引用\n"},
+        {"links", "[链接](https://example.com \"标题\") 和 ![图片](images/a.png) 以及 <https://example.com>\n"},
+        {"table", "| a | b |\n|---|---|\n| $x$ | 2 |\n"},
+        {"multilingual", "中文 ཡི་གེ་ English $\\Delta t$ 混排\n"},
+        {"deep-nesting", "$" + repeated("{", 100) + "x" + repeated("}", 100) + "$\n"},
+    };
+}
+
+QString renderSnapshot(const QString &markdown)
+{
+    QString snapshot;
+    QTextStream out(&snapshot);
+    out << "== tokens ==\n";
+    const QList<MathSpan> spans = MathRenderer::tokenize(markdown);
+    for (const MathSpan &span : spans) {
+        out << kindNames[span.kind] << ' ' << span.start << ' ' << span.length << '\n';
+    }
+    out << "== blocks ==\n";
+    const QList<MarkdownBlock> blocks = IncrementalPreview::splitBlocks(markdown);
+    for (const MarkdownBlock &block : blocks) {
+        out << int(block.kind) << ' ' << block.start << ' ' << block.length << '\n';
+    }
+    out << "== math ==\n";
+    for (const MathSpan &span : spans) {
+        if (span.kind == MathSpan::Text) {
+            continue;
+        }
+        const LatexNode root = LatexParser(QStringView(markdown).mid(span.contentStart, span.contentLength)).parse();
+        out << kindNames[span.kind] << ' ' << span.start << ' ' << describe(root).replace(u'\n', QStringLiteral("\\n"))
+            << '\n';
+    }
+    out.flush();
+    return snapshot;
+}
+
+int writeGolden(const QString &directory, const QList<QPair<QString, QString>> &cases)
+{
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "无法创建快照目录:" << directory;
+        return int(cases.size());
+    }
+    int failures = 0;
+    for (const auto &entry : cases) {
+        if (!writeFile(QDir(directory).filePath(fileNameFor(entry.first)), renderSnapshot(entry.second))) {
+            ++failures;
+        }
+    }
+    QTextStream(stdout) << cases.size() - failures << " snapshot(s) written to " << directory << '\n';
+    return failures;
+}
+
+int checkGolden(const QString &directory, const QList<QPair<QString, QString>> &cases)
+{
+    QTextStream out(stdout);
+    int failures = 0;
+    for (const auto &entry : cases) {
+        const QString path = QDir(directory).filePath(fileNameFor(entry.first));
+        QString expected;
+        if (!readFile(path, &expected)) {
+            out << "MISSING " << entry.first << " (" << path << ")\n";
+            ++failures;
+            continue;
+        }
+        const QString actual = renderSnapshot(entry.second);
+        const int line = firstDifference(expected, actual);
+        if (line > 0) {
+            // 实际结果写在快照旁边，方便用 diff 查看
+            writeFile(path + ".actual", actual);
+            out << "CHANGED " << entry.first << " at line " << line << " (" << path << ".actual)\n";
+            ++failures;
+        }
+    }
+    out << cases.size() - failures << "/" << cases.size() << " snapshot(s) unchanged\n";
+    return failures;
+}
+
+bool checkInput(const QString &markdown, const Limits &limits, QString *reason)
+{
+    const quint64 bytesBefore = limits.allocatedBytes ? limits.allocatedBytes() : 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    // 每个输入使用新的渲染器，缓存不会把前面输入的分配算进来
+    qsizetype outputSize = 0;
+    {
+        MathRenderer renderer;
+        outputSize += MathRenderer::tokenize(markdown).size();
+        outputSize += IncrementalPreview::splitBlocks(markdown).size();
+        outputSize += renderer.renderMarkdownWithMath(markdown).size();
+        outputSize += renderer.renderMarkdownFragment(markdown).toPlainText().size();
+    }
+
+    const double elapsed = timer.nsecsElapsed() / 1e6;
+    const quint64 allocated = limits.allocatedBytes ? limits.allocatedBytes() - bytesBefore : 0;
+    // QString 的缓冲区由 malloc 分配，不在 operator new 的统计中，输出大小单独计入
+    const quint64 bytes = allocated + quint64(outputSize) * sizeof(QChar);
+
+    if (elapsed > limits.maxMs) {
+        *reason = QString("耗时 %1 ms，超过 %2 ms").arg(elapsed, 0, 'f', 1).arg(limits.maxMs);
+        return false;
+    }
+    if (bytes > limits.maxBytes) {
+        *reason = QString("分配 %1 MB，超过 %2 MB").arg(bytes / 1048576.0, 0, 'f', 1).arg(limits.maxBytes >> 20);
+        return false;
+    }
+    return true;
+}
+
+int fuzz(int count, quint32 seed, int maxLength, const Limits &limits, const QString &failureDirectory)
+{
+    QTextStream out(stdout);
+    const QList<QPair<QString, Generator>> all = generators();
+    QRandomGenerator random(seed);
+    int failures = 0;
+
+    for (int i = 0; i < count; ++i) {
+        // 前几轮按顺序覆盖每个生成器的最大规模，之后随机选择生成器和规模
+        const bool sweep = i < all.size();
+        const auto &generator = all[sweep ? i : random.bounded(int(all.size()))];
+        const int size = sweep ? maxLength : 1 + random.bounded(qMax(1, maxLength));
+        const QString input = generator.second(random, size).left(qMax(1, maxLength) * 16);
+
+        QString reason;
+        if (checkInput(input, limits, &reason)) {
+            continue;
+        }
+        ++failures;
+        out << "FAIL #" << i << ' ' << generator.first << " (" << input.size() << " chars): " << reason << '\n';
+        if (!failureDirectory.isEmpty() && QDir().mkpath(failureDirectory)) {
+            writeFile(QDir(failureDirectory).filePath(QString("fail-%1-%2-%3.md").arg(seed).arg(i).arg(generator.first)),
+                      input);
+        }
+        out.flush();
+    }
+
+    out << count - failures << "/" << count << " input(s) within limits (seed " << seed << ")\n";
+    return failures;
+}
+
+} // namespace RenderCheck
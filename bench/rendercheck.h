@@ -0,0 +1,41 @@
+// rendercheck.h
+#ifndef RENDERCHECK_H
+#define RENDERCHECK_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+
+// 公式渲染的回归检查：
+//  - 快照：把内置样例和真实笔记的渲染结果保存下来，修改渲染器后逐字比较，输出有变化的样例；
+//  - 模糊测试：生成深层嵌套、未闭合括号、成千上万个 $ 之类的输入，
+//    检查每个输入的耗时、分配量和输出大小是否在限制之内
+namespace RenderCheck {
+
+struct Limits
+{
+    double maxMs = 2000;                 // 单个输入的最长耗时
+    quint64 maxBytes = 256ull << 20;     // 单个输入通过 operator new 分配的总字节数
+    quint64 (*allocatedBytes)() = nullptr;  // 分配计数，未设置时不检查分配量
+};
+
+// 内置快照样例：名字和 Markdown 原文
+QList<QPair<QString, QString>> goldenCases();
+
+// 快照内容：公式分段、顶层块切分和每个公式转换后的 Unicode 文字。
+// 不含 HTML：HTML 随 Qt 版本变化，不适合作为提交到仓库的快照
+QString renderSnapshot(const QString &markdown);
+
+// 写入快照 / 与快照比较，返回写入失败或结果有变化的样例数
+int writeGolden(const QString &directory, const QList<QPair<QString, QString>> &cases);
+int checkGolden(const QString &directory, const QList<QPair<QString, QString>> &cases);
+
+// 依次运行所有渲染路径，超出限制时返回 false 并给出原因
+bool checkInput(const QString &markdown, const Limits &limits, QString *reason);
+
+// 按种子生成 count 个对抗性输入逐个检查，失败的输入保存到 failureDirectory，返回失败数
+int fuzz(int count, quint32 seed, int maxLength, const Limits &limits, const QString &failureDirectory);
+
+} // namespace RenderCheck
+
+#endif // RENDERCHECK_H
@@ -0,0 +1,51 @@
+// documentsnapshot.cpp
+#include "documentsnapshot.h"
+
+#include <mutex>
+
+struct DocumentSnapshot::Data
+{
+    PieceTable content;
+    quint64 revision = 0;
+
+    // 预览线程和保存可能同时第一次读取文本，只生成一次
+    mutable std::once_flag textOnce;
+    mutable QString text;
+};
+
+DocumentSnapshot::DocumentSnapshot() = default;
+
+DocumentSnapshot::DocumentSnapshot(const PieceTable &content, quint64 revision)
+{
+    auto data = std::make_shared<Data>();
+    data->content = content;
+    data->revision = revision;
+    d = std::move(data);
+}
+
+quint64 DocumentSnapshot::revision() const
+{
+    return d ? d->revision : 0;
+}
+
+qsizetype DocumentSnapshot::size() const
+{
+    return d ? d->content.size() : 0;
+}
+
+const PieceTable &DocumentSnapshot::content() const
+{
+    static const PieceTable empty;
+    return d ? d->content : empty;
+}
+
+QString DocumentSnapshot::text() const
+{
+    if (!d) {
+        return QString();
+    }
+    std::call_once(d->textOnce, [this]() {
+        d->text = d->content.text();
+    });
+    return d->text;
+}
@@ -0,0 +1,34 @@
+// documentsnapshot.h
+#ifndef DOCUMENTSNAPSHOT_H
+#define DOCUMENTSNAPSHOT_H
+
+#include "piecetable.h"
+
+#include <QString>
+#include <memory>
+
+// 编辑器内容某一时刻的只读快照。
+// 复制快照只增加引用计数；完整文本在第一次调用 text() 时生成一次，之后所有持有者共享同一个 QString。
+// revision 随编辑器的每次修改递增，使用者记下上次处理的版本号，版本号没变时可以跳过工作。
+// 快照可以在任意线程中读取
+class DocumentSnapshot
+{
+public:
+    DocumentSnapshot();
+    DocumentSnapshot(const PieceTable &content, quint64 revision);
+
+    quint64 revision() const;
+    qsizetype size() const;
+    const PieceTable &content() const;
+
+    // 完整文本，只生成一次
+    QString text() const;
+
+    bool isNull() const { return !d; }
+
+private:
+    struct Data;
+    std::shared_ptr<const Data> d;
+};
+
+#endif // DOCUMENTSNAPSHOT_H
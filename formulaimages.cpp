@@ -0,0 +1,425 @@
+// formulaimages.cpp
+#include "formulaimages.h"
+#include "latexparser.h"
+#include <QTextDocument>
+#include <QPainter>
+#include <QPainterPath>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QVariant>
+#include <QDebug>
+#include <functional>
+#include <cmath>
+
+namespace {
+
+// 修改排版规则后递增，使旧的缓存图片失效
+constexpr int LayoutVersion = 1;
+
+constexpr qreal InlinePointSize = 14.0;
+constexpr qreal BlockPointSize = 17.0;
+constexpr qreal ScriptScale = 0.7;
+constexpr qreal FractionScale = 0.85;
+constexpr qreal MinPointSize = 6.0;
+constexpr qreal ImageMargin = 2.0;
+// 单个公式图片的最大边长（逻辑像素），超出时改用格式化文本输出，避免超长公式占用大量内存
+constexpr qreal MaxImageExtent = 4000.0;
+
+const QColor FormulaColor(0x33, 0x33, 0x33);
+
+// 排版盒子：宽度、基线以上和以下的高度，以及以基线左端为原点的绘制函数
+struct MathBox
+{
+    qreal width = 0;
+    qreal ascent = 0;
+    qreal descent = 0;
+    std::function<void(QPainter &, QPointF)> paint = [](QPainter &, QPointF) {};
+};
+
+QFont scaledFont(const QFont &font, qreal scale)
+{
+    QFont result = font;
+    result.setPointSizeF(qMax(MinPointSize, font.pointSizeF() * scale));
+    return result;
+}
+
+qreal ruleThickness(const QFontMetricsF &metrics)
+{
+    return qMax<qreal>(1.0, metrics.lineWidth());
+}
+
+MathBox layoutNode(const LatexNode &node, const QFont &font);
+
+MathBox textBox(const QString &text, const QFont &font)
+{
+    const QFontMetricsF metrics(font);
+    MathBox box;
+    box.width = metrics.horizontalAdvance(text);
+    box.ascent = metrics.ascent();
+    box.descent = metrics.descent();
+    box.paint = [text, font](QPainter &painter, QPointF origin) {
+        painter.setFont(font);
+        painter.drawText(origin, text);
+    };
+    return box;
+}
+
+MathBox sequenceBox(const std::vector<LatexNode> &children, const QFont &font)
+{
+    const QFontMetricsF metrics(font);
+    MathBox box;
+    // 空序列也保留一行的高度，分数和根号的尺寸才稳定
+    box.ascent = metrics.ascent() * 0.5;
+    box.descent = 0;
+
+    QList<MathBox> parts;
+    parts.reserve(qsizetype(children.size()));
+    for (const LatexNode &child : children) {
+        MathBox part = layoutNode(child, font);
+        box.width += part.width;
+        box.ascent = qMax(box.ascent, part.ascent);
+        box.descent = qMax(box.descent, part.descent);
+        parts.append(std::move(part));
+    }
+    box.paint = [parts](QPainter &painter, QPointF origin) {
+        for (const MathBox &part : parts) {
+            part.paint(painter, origin);
+            origin.rx() += part.width;
+        }
+    };
+    return box;
+}
+
+MathBox fractionBox(const LatexNode &node, const QFont &font)
+{
+    const QFont partFont = scaledFont(font, FractionScale);
+    const MathBox numerator = layoutNode(node.children[0], partFont);
+    const MathBox denominator = layoutNode(node.children[1], partFont);
+
+    const QFontMetricsF metrics(font);
+    const qreal axis = metrics.strikeOutPos();     // 分数线的位置（数学轴）
+    const qreal thickness = ruleThickness(metrics);
+    const qreal gap = qMax<qreal>(1.5, font.pointSizeF() * 0.12);
+    const qreal padding = font.pointSizeF() * 0.15;
+
+    MathBox box;
+    box.width = qMax(numerator.width, denominator.width) + 2 * padding;
+    box.ascent = axis + thickness / 2 + gap + numerator.descent + numerator.ascent;
+    box.descent = qMax<qreal>(0, denominator.ascent + gap + thickness / 2 - axis + denominator.descent);
+
+    const qreal width = box.width;
+    box.paint = [=](QPainter &painter, QPointF origin) {
+        const qreal numeratorBaseline = origin.y() - axis - thickness / 2 - gap - numerator.descent;
+        const qreal denominatorBaseline = origin.y() - axis + thickness / 2 + gap + denominator.ascent;
+        numerator.paint(painter, QPointF(origin.x() + (width - numerator.width) / 2, numeratorBaseline));
+        denominator.paint(painter, QPointF(origin.x() + (width - denominator.width) / 2, denominatorBaseline));
+        painter.fillRect(QRectF(origin.x() + padding / 2, origin.y() - axis - thickness / 2,
+                                width - padding, thickness),
+                         painter.pen().color());
+    };
+    return box;
+}
+
+MathBox squareRootBox(const LatexNode &node, const QFont &font)
+{
+    const MathBox radicand = layoutNode(node.children[0], font);
+    const bool hasIndex = node.children.size() > 1;
+    MathBox index;
+    if (hasIndex) {
+        index = layoutNode(node.children[1], scaledFont(font, ScriptScale * 0.85));
+    }
+
+    const QFontMetricsF metrics(font);
+    const qreal thickness = ruleThickness(metrics);
+    const qreal gap = qMax<qreal>(1.5, font.pointSizeF() * 0.12);
+    const qreal signWidth = metrics.ascent() * 0.55;
+    const qreal top = radicand.ascent + gap + thickness;
+    const qreal bottom = radicand.descent;
+    const qreal tickY = bottom - (top + bottom) * 0.45;   // 根号左侧短勾的高度
+    const qreal indexShift = hasIndex ? qMax<qreal>(0, index.width - signWidth * 0.45) : 0;
+    const qreal padding = font.pointSizeF() * 0.1;
+
+    MathBox box;
+    box.width = indexShift + signWidth + radicand.width + padding;
+    box.ascent = top + thickness;
+    box.descent = bottom;
+    if (hasIndex) {
+        box.ascent = qMax(box.ascent, -tickY + thickness * 2 + index.descent + index.ascent);
+    }
+
+    box.paint = [=](QPainter &painter, QPointF origin) {
+        const qreal x = origin.x() + indexShift;
+        const qreal y = origin.y();
+        QPainterPath path;
+        path.moveTo(x, y + tickY);
+        path.lineTo(x + signWidth * 0.25, y + tickY - thickness);
+        path.lineTo(x + signWidth * 0.55, y + bottom);
+        path.lineTo(x + signWidth, y - top);
+        path.lineTo(x + signWidth + radicand.width + padding, y - top);
+
+        QPen pen(painter.pen().color(), thickness);
+        pen.setJoinStyle(Qt::MiterJoin);
+        painter.save();
+        painter.setPen(pen);
+        painter.setBrush(Qt::NoBrush);
+        painter.drawPath(path);
+        painter.restore();
+
+        if (hasIndex) {
+            index.paint(painter, QPointF(origin.x(), y + tickY - thickness * 2 - index.descent));
+        }
+        radicand.paint(painter, QPointF(x + signWidth, y));
+    };
+    return box;
+}
+
+MathBox scriptsBox(const LatexNode &node, const QFont &font)
+{
+    const MathBox base = layoutNode(node.children[0], font);
+    const QFont scriptFont = scaledFont(font, ScriptScale);
+    const QFontMetricsF metrics(font);
+
+    MathBox subscript;
+    MathBox superscript;
+    if (node.hasSubscript) {
+        subscript = layoutNode(node.children[1], scriptFont);
+    }
+    if (node.hasSuperscript) {
+        superscript = layoutNode(node.children[2], scriptFont);
+    }
+
+    const qreal baseAscent = qMax(base.ascent, metrics.xHeight());
+    const qreal raise = qMax(baseAscent - superscript.ascent * 0.5, metrics.xHeight() * 0.6) + superscript.descent;
+    const qreal drop = qMax(base.descent, metrics.descent() * 0.5) + subscript.ascent * 0.4;
+    const qreal gap = font.pointSizeF() * 0.05;
+
+    MathBox box;
+    box.width = base.width + gap + qMax(node.hasSubscript ? subscript.width : 0.0,
+                                        node.hasSuperscript ? superscript.width : 0.0);
+    box.ascent = base.ascent;
+    box.descent = base.descent;
+    if (node.hasSuperscript) {
+        box.ascent = qMax(box.ascent, raise + superscript.ascent);
+    }
+    if (node.hasSubscript) {
+        box.descent = qMax(box.descent, drop + subscript.descent);
+    }
+
+    const bool hasSub = node.hasSubscript;
+    const bool hasSup = node.hasSuperscript;
+    box.paint = [=](QPainter &painter, QPointF origin) {
+        base.paint(painter, origin);
+        const qreal x = origin.x() + base.width + gap;
+        if (hasSup) {
+            superscript.paint(painter, QPointF(x, origin.y() - raise));
+        }
+        if (hasSub) {
+            subscript.paint(painter, QPointF(x, origin.y() + drop));
+        }
+    };
+    return box;
+}
+
+MathBox layoutNode(const LatexNode &node, const QFont &font)
+{
+    switch (node.type) {
+    case LatexNode::Sequence:
+        return sequenceBox(node.children, font);
+
+    case LatexNode::Text:
+    case LatexNode::Symbol:
+        return textBox(node.text, font);
+
+    case LatexNode::Command: {
+        const QString &name = node.text;
+        if (name.size() == 1 && !name[0].isLetter()) {
+            // 单字符命令：转义字符与间距，图片中不换行
+            const QChar c = name[0];
+            if (c == u',' || c == u';' || c == u':' || c == u' ' || c == u'>' || c == u'\\') {
+                return textBox(QStringLiteral(" "), font);
+            }
+            if (c == u'!') {
+                return sequenceBox({}, font);
+            }
+            return textBox(QString(c), font);
+        }
+        // 未知命令保持原样
+        return textBox(QStringLiteral("\\") + name, font);
+    }
+
+    case LatexNode::Fraction:
+        return fractionBox(node, font);
+
+    case LatexNode::SquareRoot:
+        return squareRootBox(node, font);
+
+    case LatexNode::Scripts:
+        return scriptsBox(node, font);
+
+    case LatexNode::Styled: {
+        QFont styled = font;
+        if (node.text == "b") {
+            styled.setBold(true);
+        } else if (node.text == "i") {
+            styled.setItalic(true);
+        } else {
+            styled.setItalic(false);
+        }
+        return layoutNode(node.children[0], styled);
+    }
+    }
+    return MathBox();
+}
+
+bool containsStructure(const LatexNode &node, bool insideScript)
+{
+    switch (node.type) {
+    case LatexNode::Fraction:
+    case LatexNode::SquareRoot:
+        return true;
+    case LatexNode::Scripts:
+        if (insideScript) {
+            // 上下标中再嵌套上下标，垂直对齐无法表达
+            return true;
+        }
+        if (containsStructure(node.children[0], false)) {
+            return true;
+        }
+        return containsStructure(node.children[1], true) || containsStructure(node.children[2], true);
+    default:
+        for (const LatexNode &child : node.children) {
+            if (containsStructure(child, insideScript)) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+} // namespace
+
+FormulaImages::FormulaImages()
+    : m_known(4096)
+{
+}
+
+void FormulaImages::setCacheDirectory(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_directory = path;
+    m_known.clear();
+    if (!m_directory.isEmpty()) {
+        QDir().mkpath(m_directory);
+    }
+}
+
+QString FormulaImages::cacheDirectory() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_directory;
+}
+
+bool FormulaImages::needsImage(const LatexNode &node)
+{
+    return containsStructure(node, false);
+}
+
+// 缓存键：公式内容、显示方式和排版版本的 SHA-1
+QString FormulaImages::cacheKey(const QString &latex, bool block)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(LayoutVersion));
+    hash.addData(block ? QByteArray("B") : QByteArray("I"));
+    hash.addData(latex.toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QUrl FormulaImages::imageFor(const QString &latex, const LatexNode &root, bool block, QSizeF *size)
+{
+    const QString key = cacheKey(latex, block);
+
+    QString directory;
+    {
+        QMutexLocker locker(&m_mutex);
+        directory = m_directory;
+    }
+    const QString path = directory.isEmpty() ? QString() : directory + "/" + key + ".png";
+    const QUrl url = path.isEmpty() ? QUrl(QStringLiteral("formula:") + key) : QUrl::fromLocalFile(path);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const QSizeF *known = m_known.object(key)) {
+            *size = *known;
+            return url;
+        }
+    }
+
+    // 先查磁盘缓存，没有时再排版绘制
+    QImage image;
+    if (!path.isEmpty() && QFile::exists(path)) {
+        image.load(path, "PNG");
+    }
+    if (image.isNull()) {
+        image = render(root, block);
+        if (image.isNull()) {
+            return QUrl();
+        }
+        if (!path.isEmpty()) {
+            // 先写临时文件再替换，多个线程同时生成同一个公式时不会写出损坏的图片
+            QSaveFile file(path);
+            if (!file.open(QIODevice::WriteOnly) || !image.save(&file, "PNG") || !file.commit()) {
+                qWarning() << "无法写入公式缓存:" << path;
+            }
+        }
+    }
+    image.setDevicePixelRatio(ImageScale);
+
+    *size = QSizeF(image.width() / ImageScale, image.height() / ImageScale);
+
+    QMutexLocker locker(&m_mutex);
+    m_known.insert(key, new QSizeF(*size));
+    m_pending.append(qMakePair(url, image));
+    return url;
+}
+
+void FormulaImages::registerResources(QTextDocument *document)
+{
+    QList<QPair<QUrl, QImage>> pending;
+    {
+        QMutexLocker locker(&m_mutex);
+        pending.swap(m_pending);
+    }
+    for (const auto &entry : std::as_const(pending)) {
+        document->addResource(QTextDocument::ImageResource, entry.first, QVariant(entry.second));
+    }
+}
+
+QImage FormulaImages::render(const LatexNode &root, bool block)
+{
+    QFont font;
+    font.setFamilies({QStringLiteral("Cambria Math"), QStringLiteral("STIX Two Math"),
+                      QStringLiteral("Times New Roman")});
+    font.setPointSizeF(block ? BlockPointSize : InlinePointSize);
+
+    const MathBox box = layoutNode(root, font);
+    if (box.width <= 0 || box.width > MaxImageExtent || box.ascent + box.descent > MaxImageExtent) {
+        return QImage();
+    }
+
+    const QSize pixels(int(std::ceil((box.width + 2 * ImageMargin) * ImageScale)),
+                       int(std::ceil((box.ascent + box.descent + 2 * ImageMargin) * ImageScale)));
+    QImage image(pixels, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(ImageScale);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+    painter.setPen(FormulaColor);
+    box.paint(painter, QPointF(ImageMargin, ImageMargin + box.ascent));
+    painter.end();
+    return image;
+}
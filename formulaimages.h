@@ -0,0 +1,51 @@
+// formulaimages.h
+#ifndef FORMULAIMAGES_H
+#define FORMULAIMAGES_H
+
+#include <QString>
+#include <QImage>
+#include <QUrl>
+#include <QSizeF>
+#include <QList>
+#include <QPair>
+#include <QCache>
+#include <QMutex>
+
+class QTextDocument;
+struct LatexNode;
+
+// 复杂公式（分数、根号、嵌套上下标）的排版引擎：用 QPainter 把公式画成图片，
+// 图片按内容哈希保存在磁盘缓存目录中，重新打开笔记时直接复用。
+// 可以在后台线程中调用
+class FormulaImages
+{
+public:
+    FormulaImages();
+
+    // 磁盘缓存目录，为空时只在内存中缓存
+    void setCacheDirectory(const QString &path);
+    QString cacheDirectory() const;
+
+    // 返回公式图片的地址，size 为图片在文档中的显示尺寸；公式为空时返回空地址
+    QUrl imageFor(const QString &latex, const LatexNode &root, bool block, QSizeF *size);
+
+    // 把新渲染的图片注册为文档资源，预览不必再从磁盘读取（在 GUI 线程调用）
+    void registerResources(QTextDocument *document);
+
+    // 公式是否包含无法用格式化文本表达的结构
+    static bool needsImage(const LatexNode &node);
+
+    // 图片按两倍分辨率绘制，高分屏上也保持清晰
+    static constexpr qreal ImageScale = 2.0;
+
+private:
+    static QString cacheKey(const QString &latex, bool block);
+    static QImage render(const LatexNode &root, bool block);
+
+    mutable QMutex m_mutex;
+    QString m_directory;
+    QCache<QString, QSizeF> m_known;           // 已经生成过的图片及其显示尺寸
+    QList<QPair<QUrl, QImage>> m_pending;      // 等待注册到预览文档的图片
+};
+
+#endif // FORMULAIMAGES_H
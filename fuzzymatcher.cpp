@@ -0,0 +1,179 @@
+// fuzzymatcher.cpp
+#include "fuzzymatcher.h"
+#include "perftrace.h"
+
+#include <algorithm>
+
+namespace {
+
+// 逐个 UTF-16 单元转小写，长度不变，与原文的位置一一对应
+QString fold(QStringView text)
+{
+    QString folded(text.size(), Qt::Uninitialized);
+    QChar *out = folded.data();
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        out[i] = text[i].toLower();
+    }
+    return folded;
+}
+
+} // namespace
+
+FuzzyMatcher::FuzzyMatcher(const QStringList &candidates)
+    : m_candidates(candidates)
+{
+    PERF_SCOPE("FuzzyMatcher::build");
+    qsizetype total = 0;
+    for (const QString &candidate : candidates) {
+        total += candidate.size();
+    }
+    m_folded.reserve(total);
+    m_offsets.reserve(candidates.size() + 1);
+    m_masks.reserve(candidates.size());
+    for (const QString &candidate : candidates) {
+        const QString folded = fold(candidate);
+        m_folded += folded;
+        m_offsets.append(int(m_folded.size()));
+        m_masks.append(charMask(folded));
+    }
+}
+
+// 字母和数字各占一位，其他字符按编码散列到其余的位上
+quint64 FuzzyMatcher::charMask(QStringView folded)
+{
+    quint64 mask = 0;
+    for (const QChar c : folded) {
+        const char16_t u = c.unicode();
+        int bit;
+        if (u >= 'a' && u <= 'z') {
+            bit = u - 'a';
+        } else if (u >= '0' && u <= '9') {
+            bit = 26 + (u - '0');
+        } else {
+            bit = 36 + u % 28;
+        }
+        mask |= quint64(1) << bit;
+    }
+    return mask;
+}
+
+bool FuzzyMatcher::isSeparator(QChar c)
+{
+    return c.isSpace() || c == '/' || c == '\\' || c == '_' || c == '-' || c == '.' || c == '#' || c == ':';
+}
+
+// 在第 index 个候选中匹配 term（已转小写），不匹配时返回 -1。
+// 先向前找到第一个完整匹配的结尾，再从结尾向后找到最晚的开头，只在这个最短窗口内计分
+int FuzzyMatcher::scoreTerm(QStringView term, int index) const
+{
+    const QStringView text = QStringView(m_folded).mid(m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+    const QString &original = m_candidates[index];
+    const qsizetype length = term.size();
+
+    qsizetype matched = 0;
+    qsizetype end = -1;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        if (text[i] == term[matched] && ++matched == length) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        return -1;
+    }
+
+    qsizetype start = end;
+    matched = length - 1;
+    for (qsizetype i = end; i >= 0; --i) {
+        if (text[i] == term[matched] && --matched < 0) {
+            start = i;
+            break;
+        }
+    }
+
+    int score = 0;
+    bool previousMatched = false;
+    matched = 0;
+    for (qsizetype i = start; i <= end && matched < length; ++i) {
+        if (text[i] != term[matched]) {
+            score -= previousMatched ? PenaltyGapStart : PenaltyGapExtension;
+            previousMatched = false;
+            continue;
+        }
+        int charScore = ScoreMatch;
+        if (i == 0 || isSeparator(text[i - 1])) {
+            charScore += BonusBoundary;
+        } else if (original[i].isUpper() && original[i - 1].isLower()) {
+            charScore += BonusCamel;
+        }
+        if (previousMatched) {
+            charScore += BonusConsecutive;
+        }
+        score += charScore;
+        previousMatched = true;
+        ++matched;
+    }
+    return score;
+}
+
+QList<FuzzyMatcher::Match> FuzzyMatcher::match(const QString &query, int limit) const
+{
+    PERF_SCOPE("FuzzyMatcher::match");
+    QList<Match> matches;
+    const QStringList terms = fold(query).split(' ', Qt::SkipEmptyParts);
+    if (terms.isEmpty() || limit <= 0) {
+        return matches;
+    }
+
+    quint64 required = 0;
+    for (const QString &term : terms) {
+        required |= charMask(term);
+    }
+
+    // 第一遍：只看掩码，把可能匹配的候选下标紧凑地写到前面（无分支）
+    const int count = size();
+    QList<int> survivors(count);
+    int *out = survivors.data();
+    const quint64 *masks = m_masks.constData();
+    int survived = 0;
+    for (int i = 0; i < count; ++i) {
+        out[survived] = i;
+        survived += (masks[i] & required) == required;
+    }
+
+    // 第二遍：逐字符计分
+    for (int s = 0; s < survived; ++s) {
+        const int index = out[s];
+        int total = 0;
+        for (const QString &term : terms) {
+            const int score = scoreTerm(term, index);
+            if (score < 0) {
+                total = -1;
+                break;
+            }
+            total += score;
+        }
+        if (total >= 0) {
+            matches.append({index, total});
+        }
+    }
+
+    const auto better = [this](const Match &a, const Match &b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        const int lengthA = m_offsets[a.index + 1] - m_offsets[a.index];
+        const int lengthB = m_offsets[b.index + 1] - m_offsets[b.index];
+        if (lengthA != lengthB) {
+            return lengthA < lengthB;
+        }
+        return a.index < b.index;
+    };
+    if (matches.size() > limit) {
+        std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+        matches.resize(limit);
+    } else {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
+}
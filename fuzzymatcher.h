@@ -0,0 +1,53 @@
+// fuzzymatcher.h
+#ifndef FUZZYMATCHER_H
+#define FUZZYMATCHER_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+
+// 快速打开使用的模糊匹配：查询的字符按顺序出现在候选中即匹配（子序列），
+// 匹配在单词开头、驼峰处或连续出现时得分更高，中间的间隔扣分。查询中的空格分隔多个词，每个词都要匹配。
+//
+// 候选在构造时一次性转为小写，连续存放在一个缓冲区中，每个候选另外记录一个 64 位的字符掩码。
+// 匹配先对掩码数组做一遍无分支的筛选（缺少查询中任何字符的候选直接排除，编译器可以向量化），
+// 只有剩下的候选才逐字符计算得分。构造后只读，可以在多个线程中同时调用 match()
+class FuzzyMatcher
+{
+public:
+    struct Match
+    {
+        int index = 0;  // 候选下标
+        int score = 0;
+    };
+
+    FuzzyMatcher() = default;
+    explicit FuzzyMatcher(const QStringList &candidates);
+
+    int size() const { return int(m_offsets.size()) - 1; }
+    QString candidate(int index) const { return m_candidates.at(index); }
+
+    // 按得分从高到低返回最多 limit 个匹配；得分相同时较短的候选在前
+    QList<Match> match(const QString &query, int limit) const;
+
+    // 计分参数
+    static constexpr int ScoreMatch = 16;
+    static constexpr int BonusBoundary = 8;      // 在开头或分隔符之后
+    static constexpr int BonusCamel = 7;         // 小写字母之后的大写字母
+    static constexpr int BonusConsecutive = 4;   // 与上一个匹配字符相邻
+    static constexpr int PenaltyGapStart = 3;
+    static constexpr int PenaltyGapExtension = 1;
+
+private:
+    static quint64 charMask(QStringView folded);
+    static bool isSeparator(QChar c);
+    int scoreTerm(QStringView term, int index) const;
+
+    QStringList m_candidates;
+    QString m_folded;              // 所有候选的小写形式首尾相接
+    QList<int> m_offsets{0};       // 第 i 个候选是 m_folded[m_offsets[i], m_offsets[i + 1])
+    QList<quint64> m_masks;
+};
+
+#endif // FUZZYMATCHER_H
@@ -0,0 +1,539 @@
+// incrementalpreview.cpp
+#include "incrementalpreview.h"
+#include "perftrace.h"
+#include <QTextDocument>
+#include <QTextFrame>
+#include <QTextCursor>
+#include <QHashFunctions>
+#include <QtConcurrent/QtConcurrentRun>
+#include <utility>
+
+namespace {
+
+// 块 ID 写入 frame 格式的属性，便于从预览文档反查源块
+constexpr int BlockIdProperty = QTextFormat::UserProperty + 1;
+
+bool isListItem(QStringView line)
+{
+    if (line.size() >= 2 && (line[0] == u'-' || line[0] == u'*' || line[0] == u'+') && line[1] == u' ') {
+        return true;
+    }
+    qsizetype i = 0;
+    while (i < line.size() && line[i].isDigit()) {
+        ++i;
+    }
+    return i > 0 && i + 1 < line.size() && (line[i] == u'.' || line[i] == u')') && line[i + 1] == u' ';
+}
+
+bool startsBlock(QStringView trimmed)
+{
+    return trimmed.startsWith(u"```") || trimmed.startsWith(u"~~~")
+           || trimmed.startsWith(u"$$") || trimmed.startsWith(u'#');
+}
+
+} // namespace
+
+IncrementalPreview::IncrementalPreview(QTextDocument *target, BlockRenderer renderer, QObject *parent)
+    : QObject(parent)
+    , m_target(target)
+    , m_renderer(std::move(renderer))
+    , m_watcher(new QFutureWatcher<JobResult>(this))
+{
+    // 预览文档由程序生成，不需要撤销历史
+    m_target->setUndoRedoEnabled(false);
+
+    connect(m_watcher, &QFutureWatcherBase::finished, this, &IncrementalPreview::onJobFinished);
+}
+
+IncrementalPreview::~IncrementalPreview()
+{
+    // 后台任务仍在使用渲染回调，必须等它结束
+    m_watcher->waitForFinished();
+}
+
+QList<MarkdownBlock> IncrementalPreview::splitBlocks(QStringView text)
+{
+    QList<MarkdownBlock> blocks;
+    const qsizetype n = text.size();
+
+    auto lineEnd = [&](qsizetype from) {
+        const qsizetype end = text.indexOf(u'\n', from);
+        return end < 0 ? n : end;
+    };
+    auto lineAt = [&](qsizetype from) {
+        return text.mid(from, lineEnd(from) - from);
+    };
+
+    qsizetype pos = 0;
+    while (pos < n) {
+        qsizetype end = lineEnd(pos);
+        const QStringView trimmed = text.mid(pos, end - pos).trimmed();
+        if (trimmed.isEmpty()) {
+            pos = end + 1;
+            continue;
+        }
+
+        MarkdownBlock block;
+        block.start = pos;
+
+        if (trimmed.startsWith(u"```") || trimmed.startsWith(u"~~~")) {
+            // 代码块：直到匹配的结束围栏或文末
+            block.kind = MarkdownBlock::CodeFence;
+            const QStringView fence = trimmed.left(3);
+            qsizetype next = end + 1;
+            while (next < n) {
+                const qsizetype nextEnd = lineEnd(next);
+                end = nextEnd;
+                if (text.mid(next, nextEnd - next).trimmed().startsWith(fence)) {
+                    break;
+                }
+                next = nextEnd + 1;
+            }
+        } else if (trimmed.startsWith(u"$$")) {
+            // 公式块：$$ 可以在同一行闭合，也可以跨多行
+            block.kind = MarkdownBlock::MathBlock;
+            if (!trimmed.mid(2).contains(u"$$")) {
+                qsizetype next = end + 1;
+                while (next < n) {
+                    const qsizetype nextEnd = lineEnd(next);
+                    end = nextEnd;
+                    if (text.mid(next, nextEnd - next).contains(u"$$")) {
+                        break;
+                    }
+                    next = nextEnd + 1;
+                }
+            }
+        } else if (trimmed.startsWith(u'#')) {
+            block.kind = MarkdownBlock::Heading;
+        } else if (isListItem(trimmed)) {
+            // 列表：连续的非空行；空行之后如果还是列表项或缩进行，则属于同一个列表
+            block.kind = MarkdownBlock::List;
+            qsizetype next = end + 1;
+            while (next < n) {
+                const QStringView line = lineAt(next);
+                if (line.trimmed().isEmpty()) {
+                    qsizetype probe = next;
+                    while (probe < n && lineAt(probe).trimmed().isEmpty()) {
+                        probe = lineEnd(probe) + 1;
+                    }
+                    if (probe >= n) {
+                        break;
+                    }
+                    const QStringView following = lineAt(probe);
+                    if (!isListItem(following.trimmed()) && !following.startsWith(u' ') && !following.startsWith(u'\t')) {
+                        break;
+                    }
+                    next = probe;
+                    continue;
+                }
+                end = lineEnd(next);
+                next = end + 1;
+            }
+        } else {
+            // 段落或引用：连续的非空行，遇到标题、代码块、公式块时结束
+            block.kind = trimmed.startsWith(u'>') ? MarkdownBlock::Quote : MarkdownBlock::Paragraph;
+            qsizetype next = end + 1;
+            while (next < n) {
+                const QStringView line = lineAt(next).trimmed();
+                if (line.isEmpty() || startsBlock(line)) {
+                    break;
+                }
+                end = lineEnd(next);
+                next = end + 1;
+            }
+        }
+
+        block.length = end - block.start;
+        blocks.append(block);
+        pos = end + 1;
+    }
+
+    return blocks;
+}
+
+void IncrementalPreview::noteChange(int position, int charsRemoved, int charsAdded)
+{
+    const qsizetype changeEnd = position + charsAdded;
+    if (!m_hasDirty) {
+        m_dirtyStart = position;
+        m_dirtyEnd = changeEnd;
+        m_hasDirty = true;
+    } else {
+        // 先把之前记录的区域映射到本次修改之后的坐标，再与本次修改合并
+        if (m_dirtyEnd >= position + charsRemoved) {
+            m_dirtyEnd += charsAdded - charsRemoved;
+        } else if (m_dirtyEnd > position) {
+            m_dirtyEnd = changeEnd;
+        }
+        m_dirtyStart = qMin<qsizetype>(m_dirtyStart, position);
+        m_dirtyEnd = qMax(m_dirtyEnd, changeEnd);
+    }
+}
+
+void IncrementalPreview::clearDirty()
+{
+    m_hasDirty = false;
+    m_dirtyStart = 0;
+    m_dirtyEnd = 0;
+}
+
+void IncrementalPreview::reset()
+{
+    m_blocks.clear();
+    m_textLength = 0;
+    m_dirtyUnknown = false;
+    m_hasRequested = false;
+    clearDirty();
+    // 正在后台渲染的计划基于旧的块列表，提升版本号使其失效
+    ++m_modelRevision;
+}
+
+void IncrementalPreview::waitForFinished()
+{
+    m_watcher->waitForFinished();
+}
+
+bool IncrementalPreview::sameContent(const BlockKey &block, QStringView source)
+{
+    return block.length == source.size()
+           && block.hash == qHash(source)
+           && QStringView(block.source) == source;
+}
+
+int IncrementalPreview::update(const QString &text)
+{
+    if (!m_target) {
+        return 0;
+    }
+
+    if (m_jobRunning) {
+        // 后台任务的计划已经清空了修改区域，而块列表尚未更新
+        m_dirtyUnknown = true;
+    }
+    ++m_generation;
+    QElapsedTimer clock;
+    clock.start();
+    const Plan plan = makePlan(captureInput(), text);
+    const QList<QTextDocumentFragment> fragments = renderPlan(plan, m_renderer);
+    m_lastRenderMs = clock.restart();
+    const int rendered = applyPlan(plan, fragments);
+    m_lastApplyMs = clock.elapsed();
+    return rendered;
+}
+
+void IncrementalPreview::requestUpdate(const DocumentSnapshot &snapshot)
+{
+    if (!m_target) {
+        return;
+    }
+    if (m_hasRequested && snapshot.revision() == m_requestedRevision) {
+        // 内容没有变化（例如最长延迟定时器到期而期间没有输入）
+        return;
+    }
+    m_requestedRevision = snapshot.revision();
+    m_hasRequested = true;
+
+    ++m_generation;
+    if (m_jobRunning) {
+        // 后台仍在渲染，只保留最新的快照，等当前任务结束后再处理
+        m_pendingSnapshot = snapshot;
+        return;
+    }
+    startJob(snapshot);
+}
+
+void IncrementalPreview::startJob(const DocumentSnapshot &snapshot)
+{
+    m_jobRunning = true;
+    m_jobClock.start();
+
+    // GUI 线程只复制块列表的摘要，全文在后台线程生成
+    const PlanInput input = captureInput();
+    const BlockRenderer renderer = m_renderer;
+    m_watcher->setFuture(QtConcurrent::run([snapshot, input, renderer]() {
+        JobResult result;
+        result.plan = makePlan(input, snapshot.text());
+        result.fragments = renderPlan(result.plan, renderer);
+        return result;
+    }));
+}
+
+void IncrementalPreview::onJobFinished()
+{
+    m_jobRunning = false;
+    m_lastRenderMs = m_jobClock.restart();
+    const JobResult result = m_watcher->result();
+
+    // 渲染期间编辑器又有修改时，结果虽然不是最新的，但仍与块列表一致（applyPlan 检查 modelRevision），
+    // 先应用它：渲染比输入间隔慢时预览也能持续刷新。然后再渲染等待中的快照
+    const int rendered = applyPlan(result.plan, result.fragments);
+    m_lastApplyMs = m_jobClock.elapsed();
+
+    if (!m_pendingSnapshot.isNull()) {
+        const DocumentSnapshot snapshot = std::exchange(m_pendingSnapshot, DocumentSnapshot());
+        // 修改区域按编辑器的最新内容记录，等待的快照可能更旧，只能逐块比较内容
+        m_dirtyUnknown = true;
+        startJob(snapshot);
+    }
+    if (rendered >= 0) {
+        emit updated(rendered);
+    }
+}
+
+// GUI 线程：取得块列表的摘要和修改区域，之后的修改相对于这次提交的文本记录
+IncrementalPreview::PlanInput IncrementalPreview::captureInput()
+{
+    PlanInput input;
+    input.generation = m_generation;
+    input.modelRevision = m_modelRevision;
+    input.textLength = m_textLength;
+    input.dirtyKnown = m_hasDirty && !m_dirtyUnknown;
+    input.dirtyStart = m_dirtyStart;
+    input.dirtyEnd = m_dirtyEnd;
+
+    // 预览文档被外部清空（frame 已被删除）时只能整体重建
+    input.rebuild = m_blocks.isEmpty();
+    for (const Block &block : std::as_const(m_blocks)) {
+        if (!block.frame) {
+            input.rebuild = true;
+            break;
+        }
+    }
+    if (!input.rebuild) {
+        input.blocks.reserve(m_blocks.size());
+        for (const Block &block : std::as_const(m_blocks)) {
+            input.blocks.append({block.kind, block.start, block.length, block.hash, block.source});
+        }
+    }
+
+    clearDirty();
+    return input;
+}
+
+// 后台线程：切分文本并与块列表摘要比较，确定需要重新渲染的块
+IncrementalPreview::Plan IncrementalPreview::makePlan(const PlanInput &input, const QString &text)
+{
+    PERF_SCOPE("IncrementalPreview::makePlan");
+    Plan plan;
+    plan.generation = input.generation;
+    plan.modelRevision = input.modelRevision;
+    plan.text = text;
+    plan.parts = splitBlocks(text);
+
+    const QStringView view(plan.text);
+    const QList<MarkdownBlock> &parts = plan.parts;
+
+    if (input.rebuild) {
+        plan.rebuild = true;
+        for (qsizetype i = 0; i < parts.size(); ++i) {
+            plan.renderIndexes.append(i);
+        }
+        return plan;
+    }
+
+    const QList<BlockKey> &blocks = input.blocks;
+    const qsizetype oldCount = blocks.size();
+    const qsizetype newCount = parts.size();
+    const qsizetype lengthDelta = text.size() - input.textLength;
+    const qsizetype oldDirtyEnd = input.dirtyEnd - lengthDelta;
+    const bool dirtyKnown = input.dirtyKnown;
+
+    // 1. 相同的前缀：修改区域之前、边界不变的块无需比较内容
+    qsizetype prefix = 0;
+    while (prefix < oldCount && prefix < newCount) {
+        const BlockKey &block = blocks[prefix];
+        const MarkdownBlock &part = parts[prefix];
+        if (block.start != part.start || block.length != part.length || block.kind != part.kind) {
+            break;
+        }
+        const bool knownClean = dirtyKnown && part.start + part.length < input.dirtyStart;
+        if (!knownClean && !sameContent(block, view.mid(part.start, part.length))) {
+            break;
+        }
+        ++prefix;
+    }
+
+    // 2. 相同的后缀：修改区域之后的块只是整体平移
+    qsizetype suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix) {
+        const BlockKey &block = blocks[oldCount - 1 - suffix];
+        const MarkdownBlock &part = parts[newCount - 1 - suffix];
+        if (block.start + lengthDelta != part.start || block.length != part.length || block.kind != part.kind) {
+            break;
+        }
+        const bool knownClean = dirtyKnown && block.start > oldDirtyEnd;
+        if (!knownClean && !sameContent(block, view.mid(part.start, part.length))) {
+            break;
+        }
+        ++suffix;
+    }
+
+    plan.prefix = prefix;
+    plan.suffix = suffix;
+
+    // 3. 中间区域：复用原有 frame 的块只有内容变化时才渲染，新增的块都要渲染
+    const qsizetype oldMiddle = oldCount - suffix - prefix;
+    const qsizetype newMiddle = newCount - suffix - prefix;
+    const qsizetype common = qMin(oldMiddle, newMiddle);
+    for (qsizetype i = prefix; i < prefix + newMiddle; ++i) {
+        const MarkdownBlock &part = parts[i];
+        if (i < prefix + common) {
+            const BlockKey &block = blocks[i];
+            if (block.kind == part.kind && sameContent(block, view.mid(part.start, part.length))) {
+                continue;
+            }
+        }
+        plan.renderIndexes.append(i);
+    }
+
+    return plan;
+}
+
+// 后台线程：渲染计划中需要更新的块，不访问任何 GUI 对象
+QList<QTextDocumentFragment> IncrementalPreview::renderPlan(const Plan &plan, const BlockRenderer &renderer)
+{
+    PERF_SCOPE("IncrementalPreview::renderPlan");
+    QList<QTextDocumentFragment> fragments;
+    fragments.reserve(plan.renderIndexes.size());
+    const QStringView view(plan.text);
+    for (qsizetype index : plan.renderIndexes) {
+        const MarkdownBlock &part = plan.parts[index];
+        fragments.append(renderer(view.mid(part.start, part.length).toString(), part.kind));
+    }
+    return fragments;
+}
+
+// GUI 线程：把渲染结果打补丁到预览文档，返回重新渲染的块数，计划已失效时返回 -1
+int IncrementalPreview::applyPlan(const Plan &plan, const QList<QTextDocumentFragment> &fragments)
+{
+    PERF_SCOPE("IncrementalPreview::applyPlan");
+    if (!m_target || plan.modelRevision != m_modelRevision || fragments.size() != plan.renderIndexes.size()) {
+        m_dirtyUnknown = true;
+        return -1;
+    }
+
+    const QStringView view(plan.text);
+    const QList<MarkdownBlock> &parts = plan.parts;
+    qsizetype next = 0; // 下一个待使用的渲染结果
+
+    auto takeFragment = [&](qsizetype partIndex) -> const QTextDocumentFragment * {
+        if (next < plan.renderIndexes.size() && plan.renderIndexes[next] == partIndex) {
+            return &fragments[next++];
+        }
+        return nullptr;
+    };
+    auto makeBlock = [&](const MarkdownBlock &part) {
+        Block block;
+        block.id = m_nextId++;
+        block.kind = part.kind;
+        block.start = part.start;
+        block.length = part.length;
+        block.source = view.mid(part.start, part.length).toString();
+        block.hash = qHash(QStringView(block.source));
+        return block;
+    };
+
+    QTextCursor editBlock(m_target);
+    editBlock.beginEditBlock();
+
+    if (plan.rebuild) {
+        m_blocks.clear();
+        m_target->clear();
+        for (qsizetype i = 0; i < parts.size(); ++i) {
+            Block block = makeBlock(parts[i]);
+            const int position = m_blocks.isEmpty() ? 0 : m_blocks.last().frame->lastPosition() + 1;
+            block.frame = insertFrame(position, block.id);
+            if (const QTextDocumentFragment *fragment = takeFragment(i)) {
+                fillFrame(block.frame, *fragment);
+            }
+            m_blocks.append(block);
+        }
+    } else {
+        const qsizetype oldCount = m_blocks.size();
+        const qsizetype newCount = parts.size();
+        const qsizetype lengthDelta = plan.text.size() - m_textLength;
+
+        for (qsizetype i = oldCount - plan.suffix; i < oldCount; ++i) {
+            m_blocks[i].start += lengthDelta;
+        }
+
+        // 中间被修改的块：尽量复用原有 frame（保持块 ID 稳定），多删少补
+        const qsizetype oldMiddle = oldCount - plan.suffix - plan.prefix;
+        const qsizetype newMiddle = newCount - plan.suffix - plan.prefix;
+        const qsizetype common = qMin(oldMiddle, newMiddle);
+
+        for (qsizetype i = plan.prefix; i < plan.prefix + common; ++i) {
+            Block &block = m_blocks[i];
+            const MarkdownBlock &part = parts[i];
+            block.start = part.start;
+            block.length = part.length;
+            if (const QTextDocumentFragment *fragment = takeFragment(i)) {
+                block.kind = part.kind;
+                block.source = view.mid(part.start, part.length).toString();
+                block.hash = qHash(QStringView(block.source));
+                fillFrame(block.frame, *fragment);
+            }
+        }
+
+        if (oldMiddle > newMiddle) {
+            const qsizetype first = plan.prefix + common;
+            const qsizetype count = oldMiddle - newMiddle;
+            for (qsizetype i = first; i < first + count; ++i) {
+                removeFrame(m_blocks[i].frame);
+            }
+            m_blocks.remove(first, count);
+        } else if (newMiddle > oldMiddle) {
+            for (qsizetype i = plan.prefix + common; i < plan.prefix + newMiddle; ++i) {
+                Block block = makeBlock(parts[i]);
+                const int position = i > 0 ? m_blocks[i - 1].frame->lastPosition() + 1 : 0;
+                block.frame = insertFrame(position, block.id);
+                if (const QTextDocumentFragment *fragment = takeFragment(i)) {
+                    fillFrame(block.frame, *fragment);
+                }
+                m_blocks.insert(i, block);
+            }
+        }
+    }
+
+    editBlock.endEditBlock();
+
+    m_textLength = plan.text.size();
+    m_dirtyUnknown = false;
+    ++m_modelRevision;
+    return plan.renderIndexes.size();
+}
+
+QTextFrame *IncrementalPreview::insertFrame(int position, quint64 id)
+{
+    QTextFrameFormat format;
+    format.setBorder(0);
+    format.setMargin(0);
+    format.setPadding(0);
+    format.setProperty(BlockIdProperty, id);
+
+    QTextCursor cursor(m_target);
+    cursor.setPosition(position);
+    return cursor.insertFrame(format);
+}
+
+void IncrementalPreview::fillFrame(QTextFrame *frame, const QTextDocumentFragment &fragment)
+{
+    QTextCursor cursor = frame->firstCursorPosition();
+    cursor.setPosition(frame->lastPosition(), QTextCursor::KeepAnchor);
+    if (cursor.hasSelection()) {
+        cursor.removeSelectedText();
+    }
+    cursor.insertFragment(fragment);
+}
+
+void IncrementalPreview::removeFrame(QTextFrame *frame)
+{
+    if (!frame) {
+        return;
+    }
+    // 选中包括 frame 起止标记在内的整个区域，删除后 frame 随之销毁
+    QTextCursor cursor(m_target);
+    cursor.setPosition(frame->firstPosition() - 1);
+    cursor.setPosition(frame->lastPosition() + 1, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+}
@@ -0,0 +1,169 @@
+// incrementalpreview.h
+#ifndef INCREMENTALPREVIEW_H
+#define INCREMENTALPREVIEW_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QStringView>
+#include <QTextDocumentFragment>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <functional>
+#include "documentsnapshot.h"
+
+class QTextDocument;
+class QTextFrame;
+
+// Markdown 顶层块：段落、标题、列表、引用、代码块、公式块
+struct MarkdownBlock
+{
+    enum Kind { Paragraph, Heading, List, Quote, CodeFence, MathBlock };
+
+    Kind kind = Paragraph;
+    qsizetype start = 0;   // 块在原文中的起始偏移
+    qsizetype length = 0;  // 块长度（不含结尾换行）
+};
+
+// 增量预览：把笔记切分为顶层块，每个块对应预览文档中的一个 QTextFrame，
+// 编辑后只重新渲染内容发生变化的块并就地替换。
+// 生成全文、切分、比较和渲染都在后台线程进行，GUI 线程只复制块列表的摘要并把结果打补丁到预览文档
+class IncrementalPreview : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 渲染回调会在后台线程中调用，不能访问界面对象
+    using BlockRenderer = std::function<QTextDocumentFragment(const QString &source, MarkdownBlock::Kind kind)>;
+
+    IncrementalPreview(QTextDocument *target, BlockRenderer renderer, QObject *parent = nullptr);
+    ~IncrementalPreview();
+
+    // 单遍扫描，切分顶层 Markdown 块
+    static QList<MarkdownBlock> splitBlocks(QStringView text);
+
+    // 同步更新预览，返回本次重新渲染的块数
+    int update(const QString &text);
+
+    // 异步更新：提交编辑器内容快照，在后台渲染，完成后发出 updated 信号；
+    // 渲染期间提交的快照只保留最新的一个，当前结果应用之后再渲染。与上次提交的快照版本相同时直接忽略
+    void requestUpdate(const DocumentSnapshot &snapshot);
+
+    // 清空预览（预览文档被外部清空后调用）
+    void reset();
+
+    // 等待后台渲染结束
+    void waitForFinished();
+
+    quint64 generation() const { return m_generation; }
+
+    // 最近一次更新的耗时（毫秒）：渲染变化的块、打补丁到预览文档
+    qint64 lastRenderTime() const { return m_lastRenderMs; }
+    qint64 lastApplyTime() const { return m_lastApplyMs; }
+
+    int blockCount() const { return m_blocks.size(); }
+
+public slots:
+    // 连接到编辑器文档的 contentsChange 信号，记录被修改的区域
+    void noteChange(int position, int charsRemoved, int charsAdded);
+
+signals:
+    // 后台渲染的结果已经应用到预览文档
+    void updated(int renderedBlocks);
+
+private slots:
+    void onJobFinished();
+
+private:
+    struct Block
+    {
+        quint64 id = 0;  // 稳定的块 ID，同时写入对应 frame 的格式属性
+        MarkdownBlock::Kind kind = MarkdownBlock::Paragraph;
+        qsizetype start = 0;
+        qsizetype length = 0;
+        size_t hash = 0;
+        QString source;
+        QPointer<QTextFrame> frame;
+    };
+
+    // 块列表的摘要，交给后台任务比较；source 隐式共享，复制只增加引用计数
+    struct BlockKey
+    {
+        MarkdownBlock::Kind kind = MarkdownBlock::Paragraph;
+        qsizetype start = 0;
+        qsizetype length = 0;
+        size_t hash = 0;
+        QString source;
+    };
+
+    // 生成计划所需的 GUI 线程状态，在提交任务时取得
+    struct PlanInput
+    {
+        quint64 generation = 0;
+        quint64 modelRevision = 0;
+        bool rebuild = false;        // 块列表为空或 frame 已被删除
+        QList<BlockKey> blocks;
+        qsizetype textLength = 0;
+        bool dirtyKnown = false;
+        qsizetype dirtyStart = 0;
+        qsizetype dirtyEnd = 0;
+    };
+
+    // 一次更新的计划：基于文本快照与当前块列表比较的结果
+    struct Plan
+    {
+        quint64 generation = 0;
+        quint64 modelRevision = 0;   // 计划基于的块列表版本，应用时必须一致
+        QString text;
+        QList<MarkdownBlock> parts;
+        bool rebuild = false;
+        qsizetype prefix = 0;        // 未变化的前缀块数
+        qsizetype suffix = 0;        // 未变化的后缀块数
+        QList<qsizetype> renderIndexes; // 需要重新渲染的块（parts 下标，递增）
+    };
+
+    // 后台任务的结果
+    struct JobResult
+    {
+        Plan plan;
+        QList<QTextDocumentFragment> fragments;
+    };
+
+    PlanInput captureInput();
+    static Plan makePlan(const PlanInput &input, const QString &text);
+    static QList<QTextDocumentFragment> renderPlan(const Plan &plan, const BlockRenderer &renderer);
+    int applyPlan(const Plan &plan, const QList<QTextDocumentFragment> &fragments);
+    void startJob(const DocumentSnapshot &snapshot);
+    static bool sameContent(const BlockKey &block, QStringView source);
+    QTextFrame *insertFrame(int position, quint64 id);
+    void fillFrame(QTextFrame *frame, const QTextDocumentFragment &fragment);
+    void removeFrame(QTextFrame *frame);
+    void clearDirty();
+
+    QPointer<QTextDocument> m_target;
+    BlockRenderer m_renderer;
+    QList<Block> m_blocks;
+    qsizetype m_textLength = 0;     // 块列表对应的文本长度
+    quint64 m_nextId = 1;
+    quint64 m_modelRevision = 0;
+
+    // 自上次生成计划以来被修改的区域（最新文本坐标）
+    bool m_hasDirty = false;
+    bool m_dirtyUnknown = false;    // 修改区域与块列表不再对应，只能逐块比较内容
+    qsizetype m_dirtyStart = 0;
+    qsizetype m_dirtyEnd = 0;
+
+    // 后台渲染
+    QFutureWatcher<JobResult> *m_watcher;
+    bool m_jobRunning = false;      // 同一时间只有一个后台任务
+    DocumentSnapshot m_pendingSnapshot;  // 为空表示没有等待的快照
+    quint64 m_requestedRevision = 0;     // 最近一次提交的快照版本
+    bool m_hasRequested = false;
+    QElapsedTimer m_jobClock;
+    qint64 m_lastRenderMs = 0;
+    qint64 m_lastApplyMs = 0;
+    quint64 m_generation = 0;
+};
+
+#endif // INCREMENTALPREVIEW_H
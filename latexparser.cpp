@@ -0,0 +1,292 @@
+// latexparser.cpp
+#include "latexparser.h"
+#include "latexsymbols.h"
+#include <QStringList>
+
+namespace {
+
+bool isCommandLetter(QChar c)
+{
+    return (c >= u'a' && c <= u'z') || (c >= u'A' && c <= u'Z');
+}
+
+LatexNode makeText(const QString &text)
+{
+    LatexNode node;
+    node.type = LatexNode::Text;
+    node.text = text;
+    return node;
+}
+
+LatexNode makeEmpty()
+{
+    return LatexNode();
+}
+
+} // namespace
+
+LatexParser::LatexParser(QStringView source)
+    : m_source(source)
+{
+}
+
+LatexNode LatexParser::parse()
+{
+    m_pos = 0;
+    return parseSequence(0, QChar());
+}
+
+// 解析节点序列，直到遇到终止符（'}' 或 ']'）或输入结束
+LatexNode LatexParser::parseSequence(int depth, QChar terminator)
+{
+    LatexNode sequence;
+    sequence.type = LatexNode::Sequence;
+
+    while (!atEnd()) {
+        const QChar c = peek();
+        if (!terminator.isNull() && c == terminator) {
+            break;
+        }
+
+        if (c == u'^' || c == u'_') {
+            ++m_pos;
+            const bool isSuperscript = (c == u'^');
+
+            // 上下标作用于前一个节点；x_1^2 这样的写法合并到同一个节点
+            LatexNode scripts;
+            bool merged = false;
+            if (!sequence.children.empty() && sequence.children.back().type == LatexNode::Scripts) {
+                const LatexNode &last = sequence.children.back();
+                if ((isSuperscript && !last.hasSuperscript) || (!isSuperscript && !last.hasSubscript)) {
+                    scripts = std::move(sequence.children.back());
+                    sequence.children.pop_back();
+                    merged = true;
+                }
+            }
+            if (!merged) {
+                scripts.type = LatexNode::Scripts;
+                // 重复的上标/下标（如 x^2^3）不再嵌套，作为独立的上下标追加，避免树无限加深
+                if (!sequence.children.empty() && sequence.children.back().type != LatexNode::Scripts) {
+                    scripts.children.push_back(std::move(sequence.children.back()));
+                    sequence.children.pop_back();
+                } else {
+                    scripts.children.push_back(makeEmpty());
+                }
+                scripts.children.push_back(makeEmpty());
+                scripts.children.push_back(makeEmpty());
+            }
+
+            LatexNode argument = parseArgument(depth + 1);
+            if (isSuperscript) {
+                scripts.children[2] = std::move(argument);
+                scripts.hasSuperscript = true;
+            } else {
+                scripts.children[1] = std::move(argument);
+                scripts.hasSubscript = true;
+            }
+            sequence.children.push_back(std::move(scripts));
+            continue;
+        }
+
+        if (c == u'}') {
+            // 多余的右括号按普通字符处理
+            ++m_pos;
+            sequence.children.push_back(makeText(QStringLiteral("}")));
+            continue;
+        }
+
+        sequence.children.push_back(parseAtom(depth));
+    }
+
+    // 合并相邻的普通字符，减少后续输出时的节点数量
+    std::vector<LatexNode> compacted;
+    compacted.reserve(sequence.children.size());
+    for (LatexNode &child : sequence.children) {
+        if (child.type == LatexNode::Text && !compacted.empty()
+            && compacted.back().type == LatexNode::Text) {
+            compacted.back().text += child.text;
+        } else {
+            compacted.push_back(std::move(child));
+        }
+    }
+    sequence.children = std::move(compacted);
+    return sequence;
+}
+
+// 解析单个元素：分组、命令或字符
+LatexNode LatexParser::parseAtom(int depth)
+{
+    const QChar c = peek();
+
+    if (c == u'{') {
+        ++m_pos;
+        if (depth >= MaxDepth) {
+            return rawGroup();
+        }
+        LatexNode group = parseSequence(depth + 1, u'}');
+        if (peek() == u'}') {
+            ++m_pos;
+        }
+        return group;
+    }
+
+    if (c == u'\\') {
+        return parseCommand(depth);
+    }
+
+    // 普通字符（保持代理对完整）
+    qsizetype length = 1;
+    if (c.isHighSurrogate() && m_pos + 1 < m_source.size() && m_source[m_pos + 1].isLowSurrogate()) {
+        length = 2;
+    }
+    LatexNode node = makeText(m_source.mid(m_pos, length).toString());
+    m_pos += length;
+    return node;
+}
+
+// 解析命令参数：跳过空白后读取一个元素
+LatexNode LatexParser::parseArgument(int depth)
+{
+    while (!atEnd() && peek().isSpace()) {
+        ++m_pos;
+    }
+    if (atEnd() || peek() == u'}' || peek() == u']') {
+        return makeEmpty();
+    }
+    return parseAtom(depth);
+}
+
+LatexNode LatexParser::parseCommand(int depth)
+{
+    ++m_pos; // 跳过反斜杠
+    const QString name = readCommandName();
+    if (name.isEmpty()) {
+        return makeText(QStringLiteral("\\"));
+    }
+
+    static const QStringList structuralCommands = {
+        "frac", "dfrac", "tfrac", "sqrt", "text", "textrm", "mathrm", "mbox",
+        "operatorname", "mathit", "textit", "mathbf", "textbf",
+        "left", "right", "bigl", "bigr", "Bigl", "Bigr", "big", "Big"
+    };
+    if (depth >= MaxDepth && structuralCommands.contains(name)) {
+        // 嵌套过深，不再展开参数
+        return makeText(QStringLiteral("\\") + name);
+    }
+
+    if (name == "frac" || name == "dfrac" || name == "tfrac") {
+        LatexNode fraction;
+        fraction.type = LatexNode::Fraction;
+        fraction.children.push_back(parseArgument(depth + 1));
+        fraction.children.push_back(parseArgument(depth + 1));
+        return fraction;
+    }
+
+    if (name == "sqrt") {
+        LatexNode root;
+        root.type = LatexNode::SquareRoot;
+        while (!atEnd() && peek().isSpace()) {
+            ++m_pos;
+        }
+        LatexNode index;
+        bool hasIndex = false;
+        if (peek() == u'[') {
+            ++m_pos;
+            index = parseSequence(depth + 1, u']');
+            if (peek() == u']') {
+                ++m_pos;
+            }
+            hasIndex = true;
+        }
+        root.children.push_back(parseArgument(depth + 1));
+        if (hasIndex) {
+            root.children.push_back(std::move(index));
+        }
+        return root;
+    }
+
+    if (name == "left" || name == "right" || name == "bigl" || name == "bigr"
+        || name == "Bigl" || name == "Bigr" || name == "big" || name == "Big") {
+        // 定界符只输出其本身，\left. 表示空定界符
+        while (!atEnd() && peek().isSpace()) {
+            ++m_pos;
+        }
+        if (peek() == u'.') {
+            ++m_pos;
+            return makeEmpty();
+        }
+        // 连续的 \left\left... 每层都要计入深度，否则会无限递归
+        return parseArgument(depth + 1);
+    }
+
+    if (name == "text" || name == "textrm" || name == "mathrm" || name == "mbox"
+        || name == "operatorname" || name == "mathit" || name == "textit"
+        || name == "mathbf" || name == "textbf") {
+        LatexNode styled;
+        styled.type = LatexNode::Styled;
+        if (name == "mathbf" || name == "textbf") {
+            styled.text = QStringLiteral("b");
+        } else if (name == "mathit" || name == "textit") {
+            styled.text = QStringLiteral("i");
+        }
+        styled.children.push_back(parseArgument(depth + 1));
+        return styled;
+    }
+
+    // 扫描到命令时直接查符号表
+    LatexNode command;
+    const QStringView symbol = LatexSymbols::lookup(name);
+    if (!symbol.isNull()) {
+        command.type = LatexNode::Symbol;
+        command.text = symbol.toString();
+    } else {
+        command.type = LatexNode::Command;
+        command.text = name;
+    }
+    return command;
+}
+
+// 嵌套过深时，把分组内容原样作为文本读取（迭代匹配括号，不再递归）
+LatexNode LatexParser::rawGroup()
+{
+    const qsizetype start = m_pos;
+    int level = 1;
+    while (!atEnd()) {
+        const QChar c = peek();
+        if (c == u'\\') {
+            m_pos += 2;
+            continue;
+        }
+        if (c == u'{') {
+            ++level;
+        } else if (c == u'}') {
+            if (--level == 0) {
+                break;
+            }
+        }
+        ++m_pos;
+    }
+    m_pos = qMin(m_pos, m_source.size());
+    LatexNode node = makeText(m_source.mid(start, m_pos - start).toString());
+    if (!atEnd()) {
+        ++m_pos; // 跳过右括号
+    }
+    return node;
+}
+
+// 读取命令名：连续字母，或单个非字母字符（如 \{、\,）
+QString LatexParser::readCommandName()
+{
+    if (atEnd()) {
+        return QString();
+    }
+    const qsizetype start = m_pos;
+    if (!isCommandLetter(peek())) {
+        ++m_pos;
+        return m_source.mid(start, 1).toString();
+    }
+    while (!atEnd() && isCommandLetter(peek())) {
+        ++m_pos;
+    }
+    return m_source.mid(start, m_pos - start).toString();
+}
@@ -0,0 +1,56 @@
+// latexparser.h
+#ifndef LATEXPARSER_H
+#define LATEXPARSER_H
+
+#include <QString>
+#include <QStringView>
+#include <vector>
+
+// LaTeX 公式的语法树节点
+struct LatexNode
+{
+    enum Type {
+        Sequence,    // 节点序列（也用于 {...} 分组）
+        Text,        // 普通字符
+        Command,     // 未知命令，text 为命令名（不含反斜杠）
+        Symbol,      // 已识别的符号命令，text 为对应的 Unicode 字符串
+        Fraction,    // \frac，children = [分子, 分母]
+        SquareRoot,  // \sqrt，children = [被开方数] 或 [被开方数, 次数]
+        Scripts,     // 上下标，children = [底数, 下标, 上标]，缺省的一项为空序列
+        Styled       // \text、\mathbf 等，text 为样式（""、"b"、"i"），children = [内容]
+    };
+
+    Type type = Sequence;
+    QString text;
+    std::vector<LatexNode> children;
+    bool hasSubscript = false;
+    bool hasSuperscript = false;
+};
+
+// 递归下降的 LaTeX 解析器：一遍扫描生成语法树，支持任意嵌套
+class LatexParser
+{
+public:
+    explicit LatexParser(QStringView source);
+
+    LatexNode parse();
+
+    // 嵌套层数上限，超过后剩余内容按原文输出，避免恶意输入导致栈溢出
+    static constexpr int MaxDepth = 64;
+
+private:
+    LatexNode parseSequence(int depth, QChar terminator);
+    LatexNode parseAtom(int depth);
+    LatexNode parseArgument(int depth);
+    LatexNode parseCommand(int depth);
+    LatexNode rawGroup();
+
+    QString readCommandName();
+    bool atEnd() const { return m_pos >= m_source.size(); }
+    QChar peek() const { return atEnd() ? QChar() : m_source[m_pos]; }
+
+    QStringView m_source;
+    qsizetype m_pos = 0;
+};
+
+#endif // LATEXPARSER_H
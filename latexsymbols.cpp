@@ -0,0 +1,263 @@
+// latexsymbols.cpp
+#include "latexsymbols.h"
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace {
+
+struct SymbolEntry
+{
+    std::u16string_view name;
+    std::u16string_view value;
+};
+
+// LaTeX 命令 -> Unicode 映射表
+constexpr SymbolEntry kSymbols[] = {
+    // 希腊字母
+    {u"alpha", u"α"}, {u"beta", u"β"}, {u"gamma", u"γ"},
+    {u"delta", u"δ"}, {u"epsilon", u"ε"}, {u"varepsilon", u"ϵ"},
+    {u"zeta", u"ζ"}, {u"eta", u"η"}, {u"theta", u"θ"},
+    {u"vartheta", u"ϑ"}, {u"iota", u"ι"}, {u"kappa", u"κ"},
+    {u"varkappa", u"ϰ"}, {u"lambda", u"λ"}, {u"mu", u"μ"},
+    {u"nu", u"ν"}, {u"xi", u"ξ"}, {u"omicron", u"ο"},
+    {u"pi", u"π"}, {u"varpi", u"ϖ"}, {u"rho", u"ρ"},
+    {u"varrho", u"ϱ"}, {u"sigma", u"σ"}, {u"varsigma", u"ς"},
+    {u"tau", u"τ"}, {u"upsilon", u"υ"}, {u"phi", u"φ"},
+    {u"varphi", u"ϕ"}, {u"chi", u"χ"}, {u"psi", u"ψ"},
+    {u"omega", u"ω"}, {u"digamma", u"ϝ"}, {u"Gamma", u"Γ"},
+    {u"Delta", u"Δ"}, {u"Theta", u"Θ"}, {u"Lambda", u"Λ"},
+    {u"Xi", u"Ξ"}, {u"Pi", u"Π"}, {u"Sigma", u"Σ"},
+    {u"Upsilon", u"Υ"}, {u"Phi", u"Φ"}, {u"Psi", u"Ψ"},
+    {u"Omega", u"Ω"}, {u"varGamma", u"Γ"}, {u"varDelta", u"Δ"},
+    {u"varTheta", u"Θ"}, {u"varLambda", u"Λ"}, {u"varXi", u"Ξ"},
+    {u"varPi", u"Π"}, {u"varSigma", u"Σ"}, {u"varUpsilon", u"Υ"},
+    {u"varPhi", u"Φ"}, {u"varPsi", u"Ψ"}, {u"varOmega", u"Ω"},
+    // 希伯来字母
+    {u"aleph", u"ℵ"}, {u"beth", u"ℶ"}, {u"gimel", u"ℷ"},
+    {u"daleth", u"ℸ"},
+    // 二元运算符
+    {u"pm", u"±"}, {u"mp", u"∓"}, {u"times", u"×"},
+    {u"div", u"÷"}, {u"cdot", u"·"}, {u"ast", u"∗"},
+    {u"star", u"⋆"}, {u"circ", u"∘"}, {u"bullet", u"∙"},
+    {u"oplus", u"⊕"}, {u"ominus", u"⊖"}, {u"otimes", u"⊗"},
+    {u"oslash", u"⊘"}, {u"odot", u"⊙"}, {u"bigcirc", u"◯"},
+    {u"dagger", u"†"}, {u"ddagger", u"‡"}, {u"amalg", u"⨿"},
+    {u"cap", u"∩"}, {u"cup", u"∪"}, {u"uplus", u"⊎"},
+    {u"sqcap", u"⊓"}, {u"sqcup", u"⊔"}, {u"vee", u"∨"},
+    {u"lor", u"∨"}, {u"wedge", u"∧"}, {u"land", u"∧"},
+    {u"setminus", u"∖"}, {u"smallsetminus", u"∖"}, {u"wr", u"≀"},
+    {u"diamond", u"⋄"}, {u"bigtriangleup", u"△"}, {u"bigtriangledown", u"▽"},
+    {u"triangleleft", u"◁"}, {u"triangleright", u"▷"}, {u"lhd", u"⊲"},
+    {u"rhd", u"⊳"}, {u"unlhd", u"⊴"}, {u"unrhd", u"⊵"},
+    {u"dotplus", u"∔"}, {u"ltimes", u"⋉"}, {u"rtimes", u"⋊"},
+    {u"leftthreetimes", u"⋋"}, {u"rightthreetimes", u"⋌"}, {u"curlyvee", u"⋎"},
+    {u"curlywedge", u"⋏"}, {u"boxplus", u"⊞"}, {u"boxminus", u"⊟"},
+    {u"boxtimes", u"⊠"}, {u"boxdot", u"⊡"}, {u"circledast", u"⊛"},
+    {u"circledcirc", u"⊚"}, {u"divideontimes", u"⋇"}, {u"intercal", u"⊺"},
+    {u"barwedge", u"⊼"}, {u"veebar", u"⊻"}, {u"doublecap", u"⋒"},
+    {u"Cap", u"⋒"}, {u"doublecup", u"⋓"}, {u"Cup", u"⋓"},
+    // 关系符号
+    {u"leq", u"≤"}, {u"le", u"≤"}, {u"geq", u"≥"},
+    {u"ge", u"≥"}, {u"neq", u"≠"}, {u"ne", u"≠"},
+    {u"equiv", u"≡"}, {u"approx", u"≈"}, {u"approxeq", u"≊"},
+    {u"cong", u"≅"}, {u"sim", u"∼"}, {u"simeq", u"≃"},
+    {u"backsim", u"∽"}, {u"asymp", u"≍"}, {u"doteq", u"≐"},
+    {u"propto", u"∝"}, {u"models", u"⊨"}, {u"prec", u"≺"},
+    {u"succ", u"≻"}, {u"preceq", u"⪯"}, {u"succeq", u"⪰"},
+    {u"ll", u"≪"}, {u"gg", u"≫"}, {u"lll", u"⋘"},
+    {u"ggg", u"⋙"}, {u"subset", u"⊂"}, {u"supset", u"⊃"},
+    {u"subseteq", u"⊆"}, {u"supseteq", u"⊇"}, {u"subsetneq", u"⊊"},
+    {u"supsetneq", u"⊋"}, {u"nsubseteq", u"⊈"}, {u"nsupseteq", u"⊉"},
+    {u"sqsubset", u"⊏"}, {u"sqsupset", u"⊐"}, {u"sqsubseteq", u"⊑"},
+    {u"sqsupseteq", u"⊒"}, {u"in", u"∈"}, {u"ni", u"∋"},
+    {u"owns", u"∋"}, {u"notin", u"∉"}, {u"vdash", u"⊢"},
+    {u"dashv", u"⊣"}, {u"vDash", u"⊨"}, {u"Vdash", u"⊩"},
+    {u"perp", u"⊥"}, {u"mid", u"∣"}, {u"nmid", u"∤"},
+    {u"parallel", u"∥"}, {u"nparallel", u"∦"}, {u"bowtie", u"⋈"},
+    {u"Join", u"⋈"}, {u"smile", u"⌣"}, {u"frown", u"⌢"},
+    {u"lt", u"<"}, {u"gt", u">"}, {u"nless", u"≮"},
+    {u"ngtr", u"≯"}, {u"nleq", u"≰"}, {u"ngeq", u"≱"},
+    {u"leqslant", u"⩽"}, {u"geqslant", u"⩾"}, {u"lesssim", u"≲"},
+    {u"gtrsim", u"≳"}, {u"lessgtr", u"≶"}, {u"gtrless", u"≷"},
+    {u"nsim", u"≁"}, {u"ncong", u"≇"}, {u"triangleq", u"≜"},
+    {u"coloneqq", u"≔"}, {u"eqqcolon", u"≕"}, {u"risingdotseq", u"≓"},
+    {u"fallingdotseq", u"≒"}, {u"therefore", u"∴"}, {u"because", u"∵"},
+    {u"between", u"≬"}, {u"pitchfork", u"⋔"}, {u"vartriangleleft", u"⊲"},
+    {u"vartriangleright", u"⊳"}, {u"trianglelefteq", u"⊴"}, {u"trianglerighteq", u"⊵"},
+    {u"ntriangleleft", u"⋪"}, {u"ntriangleright", u"⋫"},
+    // 箭头
+    {u"leftarrow", u"←"}, {u"gets", u"←"}, {u"rightarrow", u"→"},
+    {u"to", u"→"}, {u"uparrow", u"↑"}, {u"downarrow", u"↓"},
+    {u"leftrightarrow", u"↔"}, {u"updownarrow", u"↕"}, {u"Leftarrow", u"⇐"},
+    {u"Rightarrow", u"⇒"}, {u"Uparrow", u"⇑"}, {u"Downarrow", u"⇓"},
+    {u"Leftrightarrow", u"⇔"}, {u"Updownarrow", u"⇕"}, {u"longleftarrow", u"⟵"},
+    {u"longrightarrow", u"⟶"}, {u"longleftrightarrow", u"⟷"}, {u"Longleftarrow", u"⟸"},
+    {u"Longrightarrow", u"⟹"}, {u"Longleftrightarrow", u"⟺"}, {u"implies", u"⟹"},
+    {u"impliedby", u"⟸"}, {u"iff", u"⟺"}, {u"mapsto", u"↦"},
+    {u"longmapsto", u"⟼"}, {u"hookleftarrow", u"↩"}, {u"hookrightarrow", u"↪"},
+    {u"leftharpoonup", u"↼"}, {u"leftharpoondown", u"↽"}, {u"rightharpoonup", u"⇀"},
+    {u"rightharpoondown", u"⇁"}, {u"rightleftharpoons", u"⇌"}, {u"leftrightharpoons", u"⇋"},
+    {u"nearrow", u"↗"}, {u"searrow", u"↘"}, {u"swarrow", u"↙"},
+    {u"nwarrow", u"↖"}, {u"leadsto", u"⇝"}, {u"rightsquigarrow", u"⇝"},
+    {u"leftleftarrows", u"⇇"}, {u"rightrightarrows", u"⇉"}, {u"leftrightarrows", u"⇆"},
+    {u"rightleftarrows", u"⇄"}, {u"twoheadleftarrow", u"↞"}, {u"twoheadrightarrow", u"↠"},
+    {u"leftarrowtail", u"↢"}, {u"rightarrowtail", u"↣"}, {u"looparrowleft", u"↫"},
+    {u"looparrowright", u"↬"}, {u"circlearrowleft", u"↺"}, {u"circlearrowright", u"↻"},
+    {u"curvearrowleft", u"↶"}, {u"curvearrowright", u"↷"}, {u"Lsh", u"↰"},
+    {u"Rsh", u"↱"}, {u"upuparrows", u"⇈"}, {u"downdownarrows", u"⇊"},
+    {u"nleftarrow", u"↚"}, {u"nrightarrow", u"↛"}, {u"nLeftarrow", u"⇍"},
+    {u"nRightarrow", u"⇏"}, {u"nleftrightarrow", u"↮"}, {u"nLeftrightarrow", u"⇎"},
+    {u"Lleftarrow", u"⇚"}, {u"Rrightarrow", u"⇛"},
+    // 大型运算符
+    {u"sum", u"∑"}, {u"prod", u"∏"}, {u"coprod", u"∐"},
+    {u"int", u"∫"}, {u"iint", u"∬"}, {u"iiint", u"∭"},
+    {u"oint", u"∮"}, {u"oiint", u"∯"}, {u"bigcap", u"⋂"},
+    {u"bigcup", u"⋃"}, {u"bigsqcup", u"⨆"}, {u"bigvee", u"⋁"},
+    {u"bigwedge", u"⋀"}, {u"bigodot", u"⨀"}, {u"bigoplus", u"⨁"},
+    {u"bigotimes", u"⨂"}, {u"biguplus", u"⨄"},
+    // 定界符
+    {u"langle", u"⟨"}, {u"rangle", u"⟩"}, {u"lceil", u"⌈"},
+    {u"rceil", u"⌉"}, {u"lfloor", u"⌊"}, {u"rfloor", u"⌋"},
+    {u"lbrace", u"{"}, {u"rbrace", u"}"}, {u"lbrack", u"["},
+    {u"rbrack", u"]"}, {u"vert", u"|"}, {u"Vert", u"‖"},
+    {u"lvert", u"|"}, {u"rvert", u"|"}, {u"lVert", u"‖"},
+    {u"rVert", u"‖"}, {u"backslash", u"\\"}, {u"ulcorner", u"⌜"},
+    {u"urcorner", u"⌝"}, {u"llcorner", u"⌞"}, {u"lrcorner", u"⌟"},
+    // 其他符号
+    {u"infty", u"∞"}, {u"partial", u"∂"}, {u"nabla", u"∇"},
+    {u"forall", u"∀"}, {u"exists", u"∃"}, {u"nexists", u"∄"},
+    {u"neg", u"¬"}, {u"lnot", u"¬"}, {u"emptyset", u"∅"},
+    {u"varnothing", u"∅"}, {u"surd", u"√"}, {u"top", u"⊤"},
+    {u"bot", u"⊥"}, {u"angle", u"∠"}, {u"measuredangle", u"∡"},
+    {u"sphericalangle", u"∢"}, {u"triangle", u"△"}, {u"triangledown", u"▽"},
+    {u"square", u"□"}, {u"Box", u"□"}, {u"blacksquare", u"■"},
+    {u"Diamond", u"◊"}, {u"lozenge", u"◊"}, {u"blacklozenge", u"⧫"},
+    {u"blacktriangle", u"▲"}, {u"blacktriangledown", u"▼"}, {u"blacktriangleleft", u"◀"},
+    {u"blacktriangleright", u"▶"}, {u"prime", u"′"}, {u"backprime", u"‵"},
+    {u"hbar", u"ℏ"}, {u"hslash", u"ℏ"}, {u"ell", u"ℓ"},
+    {u"wp", u"℘"}, {u"Re", u"ℜ"}, {u"Im", u"ℑ"},
+    {u"mho", u"℧"}, {u"Finv", u"Ⅎ"}, {u"Game", u"⅁"},
+    {u"eth", u"ð"}, {u"complement", u"∁"}, {u"imath", u"ı"},
+    {u"jmath", u"ȷ"}, {u"flat", u"♭"}, {u"natural", u"♮"},
+    {u"sharp", u"♯"}, {u"clubsuit", u"♣"}, {u"diamondsuit", u"♢"},
+    {u"heartsuit", u"♡"}, {u"spadesuit", u"♠"}, {u"checkmark", u"✓"},
+    {u"maltese", u"✠"}, {u"circledR", u"®"}, {u"circledS", u"Ⓢ"},
+    {u"degree", u"°"}, {u"ldots", u"…"}, {u"dots", u"…"},
+    {u"cdots", u"⋯"}, {u"vdots", u"⋮"}, {u"ddots", u"⋱"},
+    {u"dotsc", u"…"}, {u"dotsb", u"⋯"}, {u"colon", u":"},
+    {u"S", u"§"}, {u"P", u"¶"}, {u"copyright", u"©"},
+    {u"pounds", u"£"}, {u"yen", u"¥"}, {u"euro", u"€"},
+    {u"dag", u"†"}, {u"ddag", u"‡"}, {u"textbackslash", u"\\"},
+    {u"textasciitilde", u"~"}, {u"textasciicircum", u"^"},
+    // 间距
+    {u"quad", u"\u2003"}, {u"qquad", u"\u2003\u2003"}, {u"enspace", u"\u2002"},
+    {u"thinspace", u"\u2009"},
+    // 常用函数名
+    {u"sin", u"sin"}, {u"cos", u"cos"}, {u"tan", u"tan"},
+    {u"cot", u"cot"}, {u"sec", u"sec"}, {u"csc", u"csc"},
+    {u"arcsin", u"arcsin"}, {u"arccos", u"arccos"}, {u"arctan", u"arctan"},
+    {u"sinh", u"sinh"}, {u"cosh", u"cosh"}, {u"tanh", u"tanh"},
+    {u"coth", u"coth"}, {u"log", u"log"}, {u"ln", u"ln"},
+    {u"lg", u"lg"}, {u"exp", u"exp"}, {u"lim", u"lim"},
+    {u"liminf", u"lim inf"}, {u"limsup", u"lim sup"}, {u"max", u"max"},
+    {u"min", u"min"}, {u"sup", u"sup"}, {u"inf", u"inf"},
+    {u"det", u"det"}, {u"dim", u"dim"}, {u"ker", u"ker"},
+    {u"deg", u"deg"}, {u"gcd", u"gcd"}, {u"arg", u"arg"},
+    {u"hom", u"hom"}, {u"Pr", u"Pr"}, {u"mod", u"mod"},
+    {u"bmod", u"mod"},
+};
+
+constexpr std::size_t kSymbolCount = std::size(kSymbols);
+
+// FNV-1a 哈希，编译期和运行期使用同一实现
+constexpr std::uint32_t hashName(const char16_t *data, std::size_t length)
+{
+    std::uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < length; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr std::size_t tableSizeFor(std::size_t count)
+{
+    std::size_t size = 1;
+    while (size < count * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+constexpr std::size_t kTableSize = tableSizeFor(kSymbolCount);
+constexpr std::size_t kTableMask = kTableSize - 1;
+constexpr std::uint16_t kEmptySlot = 0xFFFF;
+
+struct SymbolTable
+{
+    std::array<std::uint16_t, kTableSize> buckets {};
+    std::size_t maxProbe = 0;
+};
+
+// 编译期构建线性探测哈希表，表中存放 kSymbols 的下标
+constexpr SymbolTable buildTable()
+{
+    SymbolTable table;
+    for (std::uint16_t &slot : table.buckets) {
+        slot = kEmptySlot;
+    }
+
+    for (std::size_t i = 0; i < kSymbolCount; ++i) {
+        const std::u16string_view name = kSymbols[i].name;
+        std::size_t slot = hashName(name.data(), name.size()) & kTableMask;
+        std::size_t probe = 0;
+        while (table.buckets[slot] != kEmptySlot) {
+            if (kSymbols[table.buckets[slot]].name == name) {
+                throw "duplicate LaTeX symbol"; // 编译期报错：符号表中有重复命令
+            }
+            slot = (slot + 1) & kTableMask;
+            ++probe;
+        }
+        table.buckets[slot] = static_cast<std::uint16_t>(i);
+        if (probe > table.maxProbe) {
+            table.maxProbe = probe;
+        }
+    }
+    return table;
+}
+
+constexpr SymbolTable kTable = buildTable();
+
+static_assert(kSymbolCount < kEmptySlot, "symbol table index overflow");
+static_assert(kTable.maxProbe < 16, "symbol table probe sequence too long, change the hash");
+
+} // namespace
+
+namespace LatexSymbols {
+
+QStringView lookup(QStringView name)
+{
+    if (name.isEmpty()) {
+        return QStringView();
+    }
+
+    const std::u16string_view key(name.utf16(), static_cast<std::size_t>(name.size()));
+    std::size_t slot = hashName(key.data(), key.size()) & kTableMask;
+    for (std::size_t probe = 0; probe <= kTable.maxProbe; ++probe) {
+        const std::uint16_t index = kTable.buckets[slot];
+        if (index == kEmptySlot) {
+            break;
+        }
+        const SymbolEntry &entry = kSymbols[index];
+        if (entry.name == key) {
+            return QStringView(entry.value.data(), static_cast<qsizetype>(entry.value.size()));
+        }
+        slot = (slot + 1) & kTableMask;
+    }
+    return QStringView();
+}
+
+} // namespace LatexSymbols
@@ -0,0 +1,15 @@
+// latexsymbols.h
+#ifndef LATEXSYMBOLS_H
+#define LATEXSYMBOLS_H
+
+#include <QStringView>
+
+namespace LatexSymbols {
+
+// 查找 LaTeX 命令（不含反斜杠，如 "alpha"）对应的 Unicode 字符串，找不到时返回空视图。
+// 符号表在编译期构建为开放寻址哈希表，查找耗时与表大小无关。
+QStringView lookup(QStringView name);
+
+} // namespace LatexSymbols
+
+#endif // LATEXSYMBOLS_H
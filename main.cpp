@@ -1,16 +1,128 @@
 #include "mainwindow.h"
+#include "notesexporter.h"  // 新增：批量导出
+#include "perftrace.h"  // 新增：启动耗时
 
 #include <QApplication>
 #include <QTranslator>  // 新增
 #include <QLibraryInfo> // 新增
+#include <QCommandLineParser>  // 新增：命令行参数
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QEvent>
+
+// 新增：启动耗时的目标值（毫秒），--measure-startup 超出时返回非零
+static const int StartupBudget = 200;
+
+// 新增：记录窗口第一次绘制的时间，作为启动完成的时刻（安装在 QApplication 上，之后自动移除）
+class FirstPaintWatcher : public QObject
+{
+public:
+    FirstPaintWatcher(const QElapsedTimer &clock, bool exitAfterPaint, int budget)
+        : clock(clock), exitAfterPaint(exitAfterPaint), budget(budget) {}
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint && !done) {
+            done = true;
+            qApp->removeEventFilter(this);
+            const qint64 ms = clock.elapsed();
+            PerfTrace::record("startup", 0, clock.nsecsElapsed());
+            qInfo() << "启动耗时" << ms << "ms";
+            if (exitAfterPaint) {
+                // 测量模式：绘制完成后退出，超出预算时返回 1，可以在脚本中检查
+                QTextStream(stdout) << "startup " << ms << " ms (budget " << budget << " ms)\n";
+                QMetaObject::invokeMethod(qApp, [ms, this]() { QCoreApplication::exit(ms > budget ? 1 : 0); },
+                                          Qt::QueuedConnection);
+            }
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+private:
+    const QElapsedTimer &clock;
+    bool exitAfterPaint;
+    int budget;
+    bool done = false;
+};
+
+// 新增：是否以无界面导出模式启动（需要在创建 QApplication 之前判断）
+static bool isExportMode(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--export") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 新增：--measure-startup [预算毫秒]，返回预算值，未指定该参数时返回 -1
+static int startupMeasureBudget(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--measure-startup") == 0) {
+            bool ok = false;
+            const int budget = i + 1 < argc ? QByteArray(argv[i + 1]).toInt(&ok) : 0;
+            return ok && budget > 0 ? budget : StartupBudget;
+        }
+    }
+    return -1;
+}
+
+// 新增：MarkdownNotes --export <resources 目录> <输出目录> [--pdf] [--jobs N]
+static int runExport(QApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Markdown Notes 批量导出");
+    parser.addHelpOption();
+    QCommandLineOption exportOption("export", "把笔记库导出为 HTML，不显示界面");
+    QCommandLineOption pdfOption("pdf", "同时导出 PDF");
+    QCommandLineOption jobsOption("jobs", "并行线程数（默认使用全部 CPU 核）", "n", "0");
+    parser.addOptions({exportOption, pdfOption, jobsOption});
+    parser.addPositionalArgument("resources", "笔记库目录（包含各个笔记文件夹的 resources 目录）");
+    parser.addPositionalArgument("output", "输出目录");
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2) {
+        QTextStream(stderr) << "用法: " << QCoreApplication::applicationName()
+                            << " --export <resources 目录> <输出目录> [--pdf] [--jobs N]\n";
+        return 2;
+    }
+
+    NotesExporter exporter(arguments.at(0), arguments.at(1));
+    exporter.setPdfEnabled(parser.isSet(pdfOption));
+    exporter.setThreadCount(parser.value(jobsOption).toInt());
+    return exporter.run() > 0 ? 1 : 0;
+}
 
 int main(int argc, char *argv[])
 {
+    // 新增：从进程进入 main 开始计时，性能跟踪的时钟也从这里开始
+    QElapsedTimer startupClock;
+    startupClock.start();
+    PerfTrace::now();
+
+    // 新增：导出模式不需要显示器，在服务器上的定时任务中也能运行
+    const bool exportMode = isExportMode(argc, argv);
+    if (exportMode && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication a(argc, argv);
     a.setApplicationName("Markdown Notes");
     a.setApplicationVersion("1.0");
 
+    if (exportMode) {
+        return runExport(a);
+    }
+
+    const int budget = startupMeasureBudget(argc, argv);
+    FirstPaintWatcher paintWatcher(startupClock, budget > 0, budget > 0 ? budget : StartupBudget);
+
     MainWindow w;
+    a.installEventFilter(&paintWatcher);
     w.show();
     return a.exec();
 }
@@ -1,6 +1,16 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "pdfviewer.h" // PDF查看器
+#include "perftrace.h" // 性能跟踪
+#include "perfoverlay.h" // 性能面板
+#include "noteloader.h" // 笔记流式加载
+#include "notesaver.h" // 后台保存
+#include "autosavejournal.h" // 自动保存日志
+#include "noteindex.h" // 全文搜索
+#include "notelibrary.h" // 笔记库目录监视
+#include "notelistmodel.h" // 笔记列表模型
+#include "notecatalog.h" // 笔记库元数据目录
+#include "quickopendialog.h" // 快速打开
 
 #include <QFile>
 #include <QFileDialog>
@@ -12,6 +22,7 @@
 #include <QMimeData>
 #include <QDateTime>
 #include <QTextCursor>
+#include <QTextBlock>
 #include <QTimer>
 #include <QUrl> // 包含 URL 头文件
 #include <QCoreApplication> // 用于获取程序路径
@@ -22,40 +33,189 @@
 #include <QLabel> // 用于关于对话框
 #include <QTranslator> // 翻译器
 #include <QEvent> // 事件处理
+#include <QStatusBar> // 状态栏
+#include <QHash>
+#include <QElapsedTimer>
+#include <QMenu>
+#include <QCryptographicHash>
 #include <QActionGroup> // 动作组
 
+// 新增：预览防抖间隔的范围（毫秒）
+static const int PreviewMinDelay = 30;
+static const int PreviewMaxDelay = 1000;
+// 新增：连续输入时预览的最长刷新间隔（毫秒）
+static const int PreviewMaxLatency = 1500;
+// 新增：搜索框停止输入后多久开始搜索（毫秒），以及显示的结果数
+static const int SearchDelay = 150;
+static const int SearchResultLimit = 20;
+// 新增：笔记库变化后多久重新生成快速打开的候选（毫秒）
+static const int QuickOpenRebuildDelay = 500;
+
+// 新增：名称在按顺序排列的列表中应插入的位置，与 NoteLibrary 的排序一致
+static int sortedRow(const QListWidget *list, const QString &text)
+{
+    int row = 0;
+    while (row < list->count() && QString::localeAwareCompare(list->item(row)->text(), text) < 0) {
+        ++row;
+    }
+    return row;
+}
+
+static bool isMarkdownFile(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    return suffix == "md" || suffix == "markdown";
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , appTranslator(new QTranslator(this))
     , qtTranslator(new QTranslator(this))
     , currentLanguage("zh_CN") // 默认中文
-    , mathRenderer(new MathRenderer(this))  // 使用MathRenderer
+    , mathRenderer(nullptr)  // 使用MathRenderer，第一次预览时创建
     , previewTimer(new QTimer(this))
+    , previewMaxLatencyTimer(new QTimer(this))
+    , previewStatsLabel(nullptr)
+    , incrementalPreview(nullptr)
+    , perfOverlay(nullptr)
+    , noteLoader(new NoteLoader(this))
+    , noteSaver(new NoteSaver(this))
+    , autosaveJournal(nullptr)
+    , noteIndex(new NoteIndex(this))
+    , noteLibrary(new NoteLibrary(this))
+    , noteListModel(new NoteListModel(this))
+    , noteCatalog(new NoteCatalog(this))
+    , searchTimer(new QTimer(this))
+    , quickOpenTimer(new QTimer(this))
     , directoriesToCreateCount(0)  // 新增
     , directoriesCreatedCount(0)   // 新增
 {
     ui->setupUi(this);
 
-    // 设置预览定时器
+    // 设置预览定时器：防抖间隔根据上一次预览的耗时自动调整
     previewTimer->setSingleShot(true);
-    previewTimer->setInterval(800); // 增加延迟避免频繁渲染
+    previewTimer->setInterval(PreviewMinDelay);
     connect(previewTimer, &QTimer::timeout, this, [this]() {
         updatePreview();
     });
 
+    // 持续输入时防抖定时器会一直被推迟，这个定时器保证预览至少定期刷新一次
+    previewMaxLatencyTimer->setSingleShot(true);
+    previewMaxLatencyTimer->setInterval(PreviewMaxLatency);
+    connect(previewMaxLatencyTimer, &QTimer::timeout, this, [this]() {
+        updatePreview();
+    });
+
+    previewStatsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(previewStatsLabel);
+
+    // 设置增量预览：编辑器文档的每次修改都记录下来，预览时只重新渲染受影响的块
+    incrementalPreview = new IncrementalPreview(ui->htmlPreview->document(),
+                                                [this](const QString &source, MarkdownBlock::Kind kind) {
+                                                    return renderPreviewBlock(source, kind);
+                                                },
+                                                this);
+    connect(ui->markdownEditor->document(), &QTextDocument::contentsChange,
+            incrementalPreview, &IncrementalPreview::noteChange);
+    connect(incrementalPreview, &IncrementalPreview::updated, this, &MainWindow::onPreviewUpdated);
+
+    // 笔记流式加载：大文件分批插入编辑器
+    connect(noteLoader, &NoteLoader::progress, this, &MainWindow::onNoteLoadProgress);
+    connect(noteLoader, &NoteLoader::finished, this, &MainWindow::onNoteLoadFinished);
+
+    // 后台保存：写入在工作线程进行，完成后在这里更新界面
+    connect(noteSaver, &NoteSaver::saved, this, &MainWindow::onNoteSaved);
+    connect(noteSaver, &NoteSaver::failed, this, &MainWindow::onNoteSaveFailed);
+
+    // 自动保存日志：记录自上次保存以来的编辑，程序崩溃后重新打开笔记时可以恢复
+    autosaveJournal = new AutosaveJournal(ui->markdownEditor, this);
+    autosaveJournal->setDirectory(QCoreApplication::applicationDirPath() + "/journal");
+
+    // 全文搜索：索引建好之前输入的查询在索引就绪后执行
+    ui->searchResults->hide();
+    searchTimer->setSingleShot(true);
+    searchTimer->setInterval(SearchDelay);
+    connect(searchTimer, &QTimer::timeout, this, &MainWindow::runSearch);
+    connect(noteIndex, &NoteIndex::ready, this, &MainWindow::runSearch);
+    connect(noteIndex, &NoteIndex::searchFinished, this, &MainWindow::onSearchFinished);
+
+    // 笔记库：目录变化时只更新变化的笔记和文档，不重新扫描整个 resources/
+    connect(noteLibrary, &NoteLibrary::noteAdded, this, &MainWindow::onLibraryNoteAdded);
+    connect(noteLibrary, &NoteLibrary::noteRemoved, this, &MainWindow::onLibraryNoteRemoved);
+    connect(noteLibrary, &NoteLibrary::fileAdded, this, &MainWindow::onLibraryFileAdded);
+    connect(noteLibrary, &NoteLibrary::fileRemoved, this, &MainWindow::onLibraryFileRemoved);
+    connect(noteLibrary, &NoteLibrary::fileChanged, this, &MainWindow::onLibraryFileChanged);
+    // 文档列表、按时间排序和同步计划读取元数据目录
+    noteLibrary->setCatalog(noteCatalog);
+    noteListModel->setCatalog(noteCatalog);
+    connect(noteCatalog, &NoteCatalog::validated, this, [this]() {
+        if (syncPending) {
+            syncPending = false;
+            planSyncFromCatalog();
+        }
+    });
+
+    // 性能面板：默认隐藏，从“关于”菜单或 F12 打开
+    perfOverlay = new PerfOverlay(this);
+    addDockWidget(Qt::RightDockWidgetArea, perfOverlay);
+    perfOverlay->hide();
+    QAction *perfAction = perfOverlay->toggleViewAction();
+    perfAction->setText(tr("性能面板"));
+    perfAction->setShortcut(QKeySequence(Qt::Key_F12));
+    ui->menu_3->addAction(perfAction);
+
+    // 快速打开：Ctrl+P 模糊查找笔记、文档和标题
+    // 候选在后台生成并缓存，笔记库或元数据目录变化后稍等片刻再重新生成
+    quickOpenDialog = new QuickOpenDialog(this);
+    connect(quickOpenDialog, &QuickOpenDialog::itemActivated, this, [this](const QuickOpenItem &item) {
+        openQuickOpenItem(item);
+    });
+    quickOpenTimer->setSingleShot(true);
+    quickOpenTimer->setInterval(QuickOpenRebuildDelay);
+    connect(quickOpenTimer, &QTimer::timeout, this, &MainWindow::rebuildQuickOpen);
+    const auto scheduleQuickOpenRebuild = [this]() {
+        // 不重新计时：持续变化时也按固定间隔生成
+        if (!quickOpenTimer->isActive()) {
+            quickOpenTimer->start();
+        }
+    };
+    connect(noteCatalog, &NoteCatalog::validated, this, scheduleQuickOpenRebuild);
+    connect(noteCatalog, &NoteCatalog::noteUpdated, this, scheduleQuickOpenRebuild);
+    connect(noteLibrary, &NoteLibrary::noteAdded, this, scheduleQuickOpenRebuild);
+    connect(noteLibrary, &NoteLibrary::noteRemoved, this, scheduleQuickOpenRebuild);
+    connect(noteLibrary, &NoteLibrary::fileAdded, this, scheduleQuickOpenRebuild);
+    connect(noteLibrary, &NoteLibrary::fileRemoved, this, scheduleQuickOpenRebuild);
+    connect(noteLibrary, &NoteLibrary::fileChanged, this, scheduleQuickOpenRebuild);
+    QAction *quickOpenAction = new QAction(tr("快速打开..."), this);
+    quickOpenAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_P));
+    const QList<QAction *> fileActions = ui->menuFile->actions();
+    ui->menuFile->insertAction(fileActions.value(fileActions.indexOf(ui->actionOpen) + 1), quickOpenAction);
+    connect(quickOpenAction, &QAction::triggered, this, &MainWindow::openQuickOpen);
+
     // 初始化语言系统
     setupLanguageSystem();
 
     // 初始化同步系统
     setupSyncSystem();
 
-    // 调用新增的函数，创建/加载笔记资源
-    setupResourcesAndLoadNotes();
+    // 调用新增的函数，创建/加载笔记资源。
+    // 放到窗口显示之后的第一次事件循环中执行，扫描笔记目录不会推迟窗口出现
+    QTimer::singleShot(0, this, &MainWindow::setupResourcesAndLoadNotes);
+    QTimer::singleShot(0, this, &MainWindow::openAutosavedNote);
+    // 搜索索引在后台加载，只重新索引上次退出后变化的笔记
+    QTimer::singleShot(0, this, [this]() {
+        noteIndex->open(QCoreApplication::applicationDirPath() + "/index/notes.idx", resourcesPath);
+    });
+
+    // 新增：笔记列表使用模型，只为可见的行查询数据
+    ui->noteListView->setModel(noteListModel);
+    ui->noteListView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->noteListView, &QListView::customContextMenuRequested, this, &MainWindow::onNoteListContextMenu);
 
-    QFont font = ui->listWidget->font();
+    QFont font = ui->noteListView->font();
     font.setPointSize(14);  // 设置字体大小
-    ui->listWidget->setFont(font);
+    ui->noteListView->setFont(font);
 
     // 设置详情列表的字体
     QFont detailsFont = ui->listWidget_details->font();
@@ -67,9 +227,6 @@ MainWindow::MainWindow(QWidget *parent)
     // 将编辑器的 imageDropped 信号连接到主窗口的 onImageDropped 槽
     connect(ui->markdownEditor, &MarkdownEditor::imageDropped, this, &MainWindow::onImageDropped);
 
-    // 连接 listWidget 的双击信号到对应的槽函数
-    connect(ui->listWidget, &QListWidget::itemDoubleClicked, this, &MainWindow::on_listWidget_itemDoubleClicked);
-
     // 连接 listWidget_details 的双击信号到对应的槽函数
     // connect(ui->listWidget_details, &QListWidget::itemDoubleClicked,
     //         this, &MainWindow::on_listWidget_details_itemDoubleClicked,
@@ -86,12 +243,25 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // 后台预览任务会用到 mathRenderer，先等它结束
+    incrementalPreview->waitForFinished();
+    // 排队中的保存必须写完；退出时不再继续等待保存的同步
+    syncAfterSave = false;
+    noteSaver->waitForFinished();
+    autosaveJournal->waitForFinished();
+
+    // 设置了 MARKDOWNNOTES_TRACE 时，退出前把性能跟踪写到该文件，方便用户反馈卡顿问题
+    const QString tracePath = qEnvironmentVariable("MARKDOWNNOTES_TRACE");
+    if (!tracePath.isEmpty()) {
+        PerfTrace::writeChromeTrace(tracePath);
+    }
     delete ui;
 }
 
 // 初始化语言系统
 void MainWindow::setupLanguageSystem()
 {
+    PERF_SCOPE("MainWindow::setupLanguageSystem");
     // 创建动作组，使语言菜单项互斥
     QActionGroup *languageGroup = new QActionGroup(this);
     languageGroup->addAction(ui->action);
@@ -99,8 +269,10 @@ void MainWindow::setupLanguageSystem()
     languageGroup->addAction(ui->actionEnglish);
     languageGroup->setExclusive(true);
 
-    // 加载默认语言
-    loadLanguage(currentLanguage);
+    // 加载默认语言。默认的中文就是界面的源语言，翻译文件推迟到窗口显示之后再加载
+    QTimer::singleShot(0, this, [this]() {
+        loadLanguage(currentLanguage);
+    });
 }
 
 // 语言切换槽函数
@@ -136,21 +308,6 @@ void MainWindow::loadLanguage(const QString &languageCode)
     qApp->removeTranslator(appTranslator);
     qApp->removeTranslator(qtTranslator);
 
-    // 尝试多个可能的翻译文件路径
-    QStringList possiblePaths;
-
-    // 1. 应用程序目录下的 translations 文件夹
-    possiblePaths << QApplication::applicationDirPath() + "/translations";
-
-    // 2. 源代码目录下的 translations 文件夹（开发时使用）
-    possiblePaths << QDir::currentPath() + "/translations";
-
-    // 3. 如果使用 shadow build，可能在构建目录
-    possiblePaths << QDir::currentPath();
-
-    // 4. 应用程序目录本身
-    possiblePaths << QApplication::applicationDirPath();
-
     // 尝试加载应用程序翻译
     QString appQmFile;
     if (languageCode == "zh_CN") {
@@ -163,46 +320,19 @@ void MainWindow::loadLanguage(const QString &languageCode)
         appQmFile = QString("%1.qm").arg(languageCode);
     }
 
-    bool translationLoaded = false;
-
-    // 尝试所有可能的路径
-    for (const QString &path : possiblePaths) {
-        QString fullPath = path + "/" + appQmFile;
-        qDebug() << "Trying to load translation from:" << fullPath;
-
-        if (QFile::exists(fullPath)) {
-            if (appTranslator->load(fullPath)) {
-                qApp->installTranslator(appTranslator);
-                qDebug() << "Successfully loaded translation:" << fullPath;
-                translationLoaded = true;
-                break;
-            }
-        }
-    }
-
-    if (!translationLoaded) {
+    const QString fullPath = translationFilePath(appQmFile);
+    if (!fullPath.isEmpty() && appTranslator->load(fullPath)) {
+        qApp->installTranslator(appTranslator);
+        qDebug() << "Successfully loaded translation:" << fullPath;
+    } else {
         qDebug() << "Failed to load application translation:" << appQmFile;
-        qDebug() << "Searched in paths:" << possiblePaths;
-
-        // 列出 translations 目录中的所有文件，帮助调试
-        for (const QString &path : possiblePaths) {
-            QDir dir(path);
-            if (dir.exists()) {
-                QStringList files = dir.entryList(QStringList() << "*.qm", QDir::Files);
-                qDebug() << "QM files in" << path << ":" << files;
-            }
-        }
     }
 
     // 尝试加载Qt基础翻译（可选）
-    QString qtQmFile = QString("qt_%1.qm").arg(languageCode);
-    for (const QString &path : possiblePaths) {
-        QString fullQtPath = path + "/" + qtQmFile;
-        if (QFile::exists(fullQtPath) && qtTranslator->load(fullQtPath)) {
-            qApp->installTranslator(qtTranslator);
-            qDebug() << "Loaded Qt translation:" << fullQtPath;
-            break;
-        }
+    const QString fullQtPath = translationFilePath(QString("qt_%1.qm").arg(languageCode));
+    if (!fullQtPath.isEmpty() && qtTranslator->load(fullQtPath)) {
+        qApp->installTranslator(qtTranslator);
+        qDebug() << "Loaded Qt translation:" << fullQtPath;
     }
 
     // 重新翻译UI
@@ -217,6 +347,50 @@ void MainWindow::loadLanguage(const QString &languageCode)
     }
 }
 
+// 新增：查找翻译文件，结果按文件名缓存，切换语言时不再重复探测目录。
+// 找不到时返回空字符串
+QString MainWindow::translationFilePath(const QString &fileName)
+{
+    static QHash<QString, QString> resolved;
+    const auto cached = resolved.constFind(fileName);
+    if (cached != resolved.constEnd()) {
+        return cached.value();
+    }
+
+    // 尝试多个可能的翻译文件路径
+    const QStringList possiblePaths = {
+        // 1. 应用程序目录下的 translations 文件夹
+        QApplication::applicationDirPath() + "/translations",
+        // 2. 源代码目录下的 translations 文件夹（开发时使用）
+        QDir::currentPath() + "/translations",
+        // 3. 如果使用 shadow build，可能在构建目录
+        QDir::currentPath(),
+        // 4. 应用程序目录本身
+        QApplication::applicationDirPath()
+    };
+
+    QString found;
+    for (const QString &path : possiblePaths) {
+        const QString fullPath = path + "/" + fileName;
+        if (QFile::exists(fullPath)) {
+            found = fullPath;
+            break;
+        }
+    }
+    if (found.isEmpty() && !fileName.startsWith("qt_")) {
+        // 列出各目录中的翻译文件，帮助调试（每个文件只输出一次）
+        qDebug() << "Translation not found:" << fileName << "searched in:" << possiblePaths;
+        for (const QString &path : possiblePaths) {
+            QDir dir(path);
+            if (dir.exists()) {
+                qDebug() << "QM files in" << path << ":" << dir.entryList(QStringList() << "*.qm", QDir::Files);
+            }
+        }
+    }
+    resolved.insert(fileName, found);
+    return found;
+}
+
 // 更新语言菜单状态
 void MainWindow::updateLanguageMenu()
 {
@@ -233,6 +407,9 @@ void MainWindow::changeEvent(QEvent *event)
         // 语言改变时更新UI
         ui->retranslateUi(this);
         updateWindowTitle();
+        if (perfOverlay) {
+            perfOverlay->toggleViewAction()->setText(tr("性能面板"));
+        }
     }
     QMainWindow::changeEvent(event);
 }
@@ -287,10 +464,22 @@ void MainWindow::on_actionAbout_triggered()
 // 初始化同步系统
 void MainWindow::setupSyncSystem()
 {
-    networkManager = new QNetworkAccessManager(this);
-    syncSettings = new QSettings("MarkdownNotes", "SyncConfig", this);
+    // 网络和配置对象在第一次使用同步功能时才创建（见 ensureSyncSystem）
+    networkManager = nullptr;
+    syncSettings = nullptr;
     syncConfigured = false;
     isSyncing = false;
+}
+
+// 新增：创建网络访问管理器并读取同步设置，只在第一次调用时执行
+void MainWindow::ensureSyncSystem()
+{
+    if (networkManager) {
+        return;
+    }
+    PERF_SCOPE("MainWindow::ensureSyncSystem");
+    networkManager = new QNetworkAccessManager(this);
+    syncSettings = new QSettings("MarkdownNotes", "SyncConfig", this);
 
     // 连接网络回复信号
     connect(networkManager, &QNetworkAccessManager::finished,
@@ -337,6 +526,7 @@ void MainWindow::saveSyncSettings()
 // 同步设置槽函数
 void MainWindow::on_actionSyncSettings_triggered()
 {
+    ensureSyncSystem();
     bool ok;
     QString url = QInputDialog::getText(this, tr("同步设置"),
                                         tr("WebDAV服务器地址:\n(例如: https://dav.jianguoyun.com/dav)"), // 去掉结尾的斜杠
@@ -384,6 +574,7 @@ void MainWindow::on_actionSyncSettings_triggered()
 // 开始同步槽函数
 void MainWindow::on_actionSync_triggered()
 {
+    ensureSyncSystem();
     if (!syncConfigured) {
         QMessageBox::warning(this, tr("警告"),
                              tr("请先配置同步设置！\n\n点击\"同步设置\"配置WebDAV服务器信息。"));
@@ -408,7 +599,9 @@ void MainWindow::on_actionSync_triggered()
 // 同步文件
 void MainWindow::syncFiles()
 {
+    PERF_SCOPE("MainWindow::syncFiles");
     if (isSyncing) return;
+    ensureSyncSystem();
 
     statusBar()->showMessage(tr("开始同步..."));
     isSyncing = true;
@@ -416,6 +609,21 @@ void MainWindow::syncFiles()
     failedUploads = 0;
     uploadQueue.clear();
 
+    // 新增：先保存当前笔记，上传的是编辑器中的最新内容（内容未变化时 saveFile 不会重写文件）。
+    // 上传会读取磁盘上的文件，后台保存还没写完时等 saved / failed 信号再继续，不阻塞界面
+    if (isWindowModified() && !currentFilePath.isEmpty() && !noteLoader->isLoading()) {
+        saveFile();
+    }
+    if (noteSaver->isSaving()) {
+        syncAfterSave = true;
+        statusBar()->showMessage(tr("正在保存笔记..."));
+        return;
+    }
+    checkLocalChanges();
+}
+
+void MainWindow::checkLocalChanges()
+{
     // 检查resources目录
     QDir resourcesDir(resourcesPath);
     if (!resourcesDir.exists()) {
@@ -424,7 +632,57 @@ void MainWindow::syncFiles()
         return;
     }
 
-    // 遍历所有笔记文件夹和文件
+    // 新增：同步计划从元数据目录读取，只上传内容哈希与上次上传到同一服务器时不同的文件。
+    // 先在后台重新校验一遍：刚保存的笔记和程序外修改的文件（assets/ 没有被监视）都会重新计算哈希，
+    // 校验完成（validated 信号）后再制定计划。数据库打不开时遍历目录，上传全部文件
+    if (!noteCatalog->isOpen()) {
+        qWarning() << "笔记目录数据库不可用，上传全部文件";
+        planSyncFromDirectories();
+        return;
+    }
+    syncPending = true;
+    statusBar()->showMessage(tr("正在检查本地文件的变化..."));
+    noteCatalog->validate();
+}
+
+// 新增：按元数据目录制定同步计划（笔记目录和 assets 中的所有文件）
+void MainWindow::planSyncFromCatalog()
+{
+    PERF_SCOPE("MainWindow::planSyncFromCatalog");
+    const QHash<QString, QByteArray> uploaded = noteCatalog->uploadedHashes(webdavUrl + remoteBasePath);
+    const QList<NoteCatalog::FileRecord> files = noteCatalog->allFiles();
+
+    // 首先收集所有需要创建的目录
+    QSet<QString> directoriesToCreate;
+    directoriesToCreate.insert(remoteBasePath); // 根目录
+
+    int upToDateFiles = 0;
+    for (const NoteCatalog::FileRecord &file : files) {
+        if (!file.hash.isEmpty() && uploaded.value(file.note + "/" + file.path) == file.hash) {
+            ++upToDateFiles;
+            continue;
+        }
+
+        // 添加笔记目录和 assets 目录
+        QString remoteNoteDir = remoteBasePath + file.note + "/";
+        directoriesToCreate.insert(remoteNoteDir);
+        if (file.path.startsWith("assets/")) {
+            directoriesToCreate.insert(remoteNoteDir + "assets/");
+        }
+
+        QString localFilePath = resourcesPath + "/" + file.note + "/" + file.path;
+        QString remoteFilePath = getRemotePath(localFilePath);
+        uploadQueue.append(qMakePair(localFilePath, remoteFilePath));
+        qDebug() << "添加文件到上传队列:" << localFilePath << "->" << remoteFilePath;
+    }
+
+    startSync(directoriesToCreate, upToDateFiles);
+}
+
+// 新增：没有元数据目录时遍历所有笔记文件夹，上传全部文件
+void MainWindow::planSyncFromDirectories()
+{
+    QDir resourcesDir(resourcesPath);
     QStringList noteFolders = resourcesDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
 
     // 首先收集所有需要创建的目录
@@ -467,8 +725,18 @@ void MainWindow::syncFiles()
         }
     }
 
+    startSync(directoriesToCreate, 0);
+}
+
+// 新增：按上传队列创建远程目录，目录创建完成后开始上传
+void MainWindow::startSync(const QSet<QString> &directoriesToCreate, int upToDateFiles)
+{
     if (uploadQueue.isEmpty()) {
-        QMessageBox::information(this, tr("提示"), tr("没有找到需要同步的文件。"));
+        if (upToDateFiles > 0) {
+            QMessageBox::information(this, tr("提示"), tr("所有文件都已是最新，无需上传。"));
+        } else {
+            QMessageBox::information(this, tr("提示"), tr("没有找到需要同步的文件。"));
+        }
         isSyncing = false;
         return;
     }
@@ -554,11 +822,15 @@ void MainWindow::uploadFile(const QString &localPath, const QString &remotePath)
 
     qDebug() << "发送PUT请求到:" << url.toString();
 
+    // 新增：记下上传内容的哈希，上传成功后写入元数据目录，下次同步时跳过未变化的文件
+    const QByteArray hash = QCryptographicHash::hash(fileData, QCryptographicHash::Sha1);
+
     // 发送PUT请求
     QNetworkReply *reply = networkManager->put(request, fileData);
 
     // 设置用户属性以便在回复处理中识别
     reply->setProperty("operation", "uploadFile");
+    reply->setProperty("hash", hash);
     reply->setProperty("localPath", localPath);
     reply->setProperty("remotePath", remotePath);
 
@@ -581,6 +853,7 @@ void MainWindow::processNextUpload()
 // 网络回复处理
 void MainWindow::onNetworkReplyFinished(QNetworkReply *reply)
 {
+    PERF_SCOPE("MainWindow::onNetworkReplyFinished");
     QString operation = reply->property("operation").toString();
     QString remotePath = reply->property("remotePath").toString();
     QString localPath = reply->property("localPath").toString();
@@ -607,6 +880,10 @@ void MainWindow::onNetworkReplyFinished(QNetworkReply *reply)
         } else if (operation == "uploadFile") {
             qDebug() << "成功上传文件:" << localPath << "到" << remotePath;
             successfulUploads++;
+            const QString relativePath = QDir(resourcesPath).relativeFilePath(localPath);
+            const int slash = relativePath.indexOf('/');
+            noteCatalog->setUploaded(webdavUrl + remoteBasePath, relativePath.left(slash), relativePath.mid(slash + 1),
+                                     reply->property("hash").toByteArray());
             processNextUpload();
         }
     } else {
@@ -782,29 +1059,29 @@ void MainWindow::setupResourcesAndLoadNotes()
 {
     // 1. 获取程序可执行文件所在目录，并确定 resources 文件夹的路径
     resourcesPath = QCoreApplication::applicationDirPath() + "/resources";
-    QDir resourcesDir(resourcesPath);
 
-    // 2. 检查路径是否存在，如果不存在则创建
-    if (!resourcesDir.exists()) {
-        // mkpath可以递归创建路径，比mkdir更安全
-        if (!resourcesDir.mkpath(".")) {
-            QMessageBox::critical(this, tr("错误"), tr("无法创建笔记存储文件夹: %1").arg(resourcesPath));
-            return;
-        }
+    // 2. 打开笔记库：路径不存在时创建，扫描一次后由文件系统监视保持列表最新
+    if (!noteLibrary->open(resourcesPath)) {
+        QMessageBox::critical(this, tr("错误"), tr("无法创建笔记存储文件夹: %1").arg(resourcesPath));
+        return;
+    }
+    // 元数据目录在后台与磁盘校验，只重新读取上次退出后变化的文件
+    if (noteCatalog->open(resourcesPath)) {
+        noteCatalog->validate();
+    } else {
+        qWarning() << "无法打开笔记目录数据库，将直接读取文件系统";
     }
 
-    // 3. 刷新笔记列表
-    ui->listWidget->clear(); // 清空旧列表
-    // 设置过滤，只查找目录
-    resourcesDir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
-    // 获取所有子目录的名称列表
-    QStringList noteList = resourcesDir.entryList();
-    // 将笔记名称添加到 listWidget
-    ui->listWidget->addItems(noteList);
+    // 3. 填充笔记列表：只有名称，元数据在行显示或排序需要时才读取
+    noteListModel->setLibraryPath(resourcesPath);
+    noteListModel->setNotes(noteLibrary->notes());
+
+    // 新增：先生成只有笔记名称的快速打开候选，元数据目录校验完成后再补上文档和标题
+    rebuildQuickOpen();
 }
 
-// 新增槽函数：处理 listWidget 列表项的双击事件
-void MainWindow::on_listWidget_itemDoubleClicked(QListWidgetItem *item)
+// 新增槽函数：处理笔记列表的双击事件
+void MainWindow::on_noteListView_doubleClicked(const QModelIndex &index)
 {
     /*
     // 如果当前文件已修改，则提示用户保存
@@ -816,7 +1093,10 @@ void MainWindow::on_listWidget_itemDoubleClicked(QListWidgetItem *item)
 
 
     // 保存当前笔记名称，以便在保存后加载
-    QString targetNoteName = item->text();
+    QString targetNoteName = noteListModel->noteName(index);
+    if (targetNoteName.isEmpty()) {
+        return;
+    }
 
 
     // 检查是否需要保存当前笔记
@@ -846,35 +1126,10 @@ void MainWindow::on_listWidget_details_itemDoubleClicked(QListWidgetItem *item)
         }
 
         // 加载Markdown文件
-        QFile file(filePath);
-        if (!file.open(QIODevice::ReadOnly | QFile::Text)) {
-            QMessageBox::warning(this, tr("警告"), tr("无法打开文件: %1\n错误: %2").arg(fileName, file.errorString()));
+        if (!loadEditorFile(filePath, tr("文档 '%1' 已加载").arg(fileName))) {
+            QMessageBox::warning(this, tr("警告"), tr("无法打开文件: %1\n错误: %2").arg(fileName, noteLoader->errorString()));
             return;
         }
-
-        // 屏蔽 textChanged 信号
-        disconnect(ui->markdownEditor, &QTextEdit::textChanged,
-                   this, &MainWindow::on_markdownEditor_textChanged);
-
-        // 设置当前文件路径
-        setCurrentFile(filePath);
-
-        // 读取文件内容
-        QTextStream in(&file);
-        QString content = in.readAll();
-        file.close();
-
-        // 设置文本内容
-        ui->markdownEditor->setPlainText(content);
-
-        // 设置窗口为未修改状态
-        setWindowModified(false);
-
-        // 恢复信号连接
-        connect(ui->markdownEditor, &QTextEdit::textChanged,
-                this, &MainWindow::on_markdownEditor_textChanged);
-
-        statusBar()->showMessage(tr("文档 '%1' 已加载").arg(fileName), 2000);
     }
     else if (suffix == "pdf") {
         // 如果是PDF文件，打开PDF查看器
@@ -888,38 +1143,282 @@ void MainWindow::on_listWidget_details_itemDoubleClicked(QListWidgetItem *item)
 // 新增函数：更新详情列表，显示当前笔记文件夹下的文档
 void MainWindow::updateDetailsList(const QString &noteName)
 {
+    // 新增：只监视当前笔记的目录。先切换，重新列出时发出的信号不会重复加入下面的列表
+    noteLibrary->setActiveNote(noteName);
     ui->listWidget_details->clear();
     currentNoteName = noteName;
 
-    QString notePath = resourcesPath + "/" + noteName;
-    QDir noteDir(notePath);
+    // 新增：文档列表由笔记库维护，不再扫描目录
+    const QStringList fileList = noteLibrary->files(noteName);
+    for (const QString &fileName : fileList) {
+        addDetailsItem(fileName);
+    }
+}
 
-    if (!noteDir.exists()) {
+// 新增：在详情列表中按顺序插入一个文档
+void MainWindow::addDetailsItem(const QString &fileName)
+{
+    QListWidgetItem *item = new QListWidgetItem(fileName);
+    QFileInfo fileInfo(fileName);
+    QString suffix = fileInfo.suffix().toLower();
+
+    // 为不同类型的文件设置不同的图标或显示方式
+    if (suffix == "pdf") {
+        item->setForeground(Qt::blue);
+        item->setToolTip(tr("PDF文档"));
+    } else {
+        item->setToolTip(tr("Markdown文档"));
+    }
+    ui->listWidget_details->insertItem(sortedRow(ui->listWidget_details, fileName), item);
+}
+
+// 新增：笔记库中出现新的笔记目录
+void MainWindow::onLibraryNoteAdded(const QString &noteName)
+{
+    noteListModel->addNote(noteName);
+}
+
+// 新增：笔记目录被删除或重命名；编辑器中的内容保留，保存时会重新创建
+void MainWindow::onLibraryNoteRemoved(const QString &noteName)
+{
+    noteListModel->removeNote(noteName);
+    if (noteName == currentNoteName) {
+        ui->listWidget_details->clear();
+    }
+}
+
+void MainWindow::onLibraryFileAdded(const QString &noteName, const QString &fileName)
+{
+    if (noteName == currentNoteName && ui->listWidget_details->findItems(fileName, Qt::MatchExactly).isEmpty()) {
+        addDetailsItem(fileName);
+    }
+    if (isMarkdownFile(fileName)) {
+        noteIndex->refreshFile(resourcesPath + "/" + noteName + "/" + fileName);
+        noteListModel->invalidate(noteName);
+    }
+}
+
+void MainWindow::onLibraryFileRemoved(const QString &noteName, const QString &fileName)
+{
+    if (noteName == currentNoteName) {
+        const QList<QListWidgetItem *> items = ui->listWidget_details->findItems(fileName, Qt::MatchExactly);
+        qDeleteAll(items);
+    }
+    if (isMarkdownFile(fileName)) {
+        noteIndex->removeFile(resourcesPath + "/" + noteName + "/" + fileName);
+        noteListModel->invalidate(noteName);
+    }
+}
+
+// 新增：文档内容变化（程序外的修改，例如 git pull）时更新搜索索引
+void MainWindow::onLibraryFileChanged(const QString &noteName, const QString &fileName)
+{
+    if (isMarkdownFile(fileName)) {
+        noteIndex->refreshFile(resourcesPath + "/" + noteName + "/" + fileName);
+        noteListModel->invalidate(noteName);
+    }
+}
+
+// 新增：笔记列表右键菜单，切换排序方式
+void MainWindow::onNoteListContextMenu(const QPoint &position)
+{
+    QMenu menu(this);
+    QAction *byName = menu.addAction(tr("按名称排序"));
+    QAction *byModified = menu.addAction(tr("按修改时间排序"));
+    byName->setCheckable(true);
+    byModified->setCheckable(true);
+    byName->setChecked(noteListModel->sortMode() == NoteListModel::SortByName);
+    byModified->setChecked(noteListModel->sortMode() == NoteListModel::SortByModified);
+
+    QAction *chosen = menu.exec(ui->noteListView->viewport()->mapToGlobal(position));
+    if (chosen == byName) {
+        noteListModel->setSortMode(NoteListModel::SortByName);
+    } else if (chosen == byModified) {
+        noteListModel->setSortMode(NoteListModel::SortByModified);
+    }
+}
+
+// 新增：搜索框内容变化，停止输入一小段时间后再搜索
+void MainWindow::on_searchEdit_textChanged(const QString &text)
+{
+    Q_UNUSED(text);
+    searchTimer->start();
+}
+
+// 新增：在索引中搜索（后台进行），结果显示在笔记列表的位置；搜索框为空时恢复笔记列表
+void MainWindow::runSearch()
+{
+    searchTimer->stop();
+    const QString query = ui->searchEdit->text().trimmed();
+    if (query.isEmpty() || !noteIndex->isReady()) {
+        ui->searchResults->clear();
+        // 索引建好之前先在笔记列表中按名称筛选，索引就绪后（ready 信号）再全文搜索
+        noteListModel->setFilterText(query);
+        ui->searchResults->hide();
+        ui->noteListView->show();
+        if (!query.isEmpty()) {
+            statusBar()->showMessage(tr("正在建立搜索索引，暂时只按笔记名称筛选..."));
+        }
         return;
     }
+    noteListModel->setFilterText(QString());
+    ui->noteListView->hide();
+    ui->searchResults->show();
 
-    // 设置过滤器，查找.md和.pdf文件
-    QStringList filters;
-    filters << "*.md" << "*.markdown" << "*.pdf";
-    noteDir.setNameFilters(filters);
-    noteDir.setFilter(QDir::Files);
+    searchClock.start();
+    noteIndex->startSearch(query, SearchResultLimit);
+}
 
-    QStringList fileList = noteDir.entryList();
+// 新增：后台搜索完成，显示结果和摘要；搜索框已经改变时丢弃
+void MainWindow::onSearchFinished(const QString &query, const QList<NoteIndex::Hit> &hits)
+{
+    if (query != ui->searchEdit->text().trimmed() || ui->searchResults->isHidden()) {
+        return;
+    }
+    ui->searchResults->clear();
+    for (const NoteIndex::Hit &hit : hits) {
+        const QFileInfo fileInfo(hit.filePath);
+        QListWidgetItem *item = new QListWidgetItem(fileInfo.completeBaseName() + "\n" + hit.snippet,
+                                                    ui->searchResults);
+        item->setData(Qt::UserRole, hit.filePath);
+        item->setToolTip(hit.filePath);
+    }
+    statusBar()->showMessage(tr("找到 %1 个结果（%2 ms）").arg(hits.size()).arg(searchClock.elapsed()), 3000);
+}
 
-    // 为不同类型的文件设置不同的图标或显示方式
-    for (const QString &fileName : fileList) {
-        QListWidgetItem *item = new QListWidgetItem(fileName, ui->listWidget_details);
-        QFileInfo fileInfo(fileName);
-        QString suffix = fileInfo.suffix().toLower();
-
-        // 可以根据文件类型设置不同的图标
-        if (suffix == "pdf") {
-            item->setForeground(Qt::blue);
-            item->setToolTip(tr("PDF文档"));
-        } else {
-            item->setToolTip(tr("Markdown文档"));
+// 新增：双击搜索结果打开对应的文档
+void MainWindow::on_searchResults_itemDoubleClicked(QListWidgetItem *item)
+{
+    const QString filePath = item->data(Qt::UserRole).toString();
+    if (filePath.isEmpty() || !maybeSave()) {
+        return;
+    }
+
+    const QString noteName = noteNameForFile(filePath);
+    if (!noteName.isEmpty()) {
+        updateDetailsList(noteName);
+    }
+    const QString fileName = QFileInfo(filePath).fileName();
+    if (!loadEditorFile(filePath, tr("文档 '%1' 已加载").arg(fileName))) {
+        QMessageBox::warning(this, tr("警告"), tr("无法打开文件: %1\n错误: %2").arg(fileName, noteLoader->errorString()));
+    }
+}
+
+// 新增：在后台重新生成快速打开的候选。候选包括所有笔记；元数据目录校验完成后还包括
+// 各笔记目录中的文档和其中的 Markdown 标题（与详情列表一致，不含 assets/ 等子目录）
+void MainWindow::rebuildQuickOpen()
+{
+    quickOpenTimer->stop();
+    const QStringList notes = noteLibrary->notes();
+    const QString databasePath = noteCatalog->isValid() ? noteCatalog->databasePath() : QString();
+    quickOpenDialog->rebuild([notes, databasePath]() {
+        QList<QuickOpenItem> items;
+        QStringList sortedNotes = notes;
+        sortedNotes.sort();
+        for (const QString &noteName : std::as_const(sortedNotes)) {
+            QuickOpenItem item;
+            item.kind = QuickOpenItem::Note;
+            item.note = noteName;
+            item.text = noteName;
+            items.append(item);
+        }
+
+        QList<NoteCatalog::FileRecord> files;
+        QList<NoteCatalog::HeadingRecord> headings;
+        if (databasePath.isEmpty() || !NoteCatalog::readListing(databasePath, &files, &headings)) {
+            return items;
+        }
+        for (const NoteCatalog::FileRecord &record : std::as_const(files)) {
+            if (record.path.contains('/')) {
+                continue;
+            }
+            const QString suffix = QFileInfo(record.path).suffix().toLower();
+            if (suffix != "md" && suffix != "markdown" && suffix != "pdf") {
+                continue;
+            }
+            QuickOpenItem item;
+            item.kind = QuickOpenItem::File;
+            item.note = record.note;
+            item.path = record.path;
+            item.text = record.note + "/" + record.path;
+            items.append(item);
         }
+        for (const NoteCatalog::HeadingRecord &record : std::as_const(headings)) {
+            if (record.path.contains('/')) {
+                continue;
+            }
+            QuickOpenItem item;
+            item.kind = QuickOpenItem::Heading;
+            item.note = record.note;
+            item.path = record.path;
+            item.line = record.line;
+            item.text = record.text;
+            items.append(item);
+        }
+        return items;
+    });
+}
+
+// 新增：快速打开。使用缓存的候选；笔记库有变化还没来得及重新生成时立即开始生成，完成后面板自动刷新
+void MainWindow::openQuickOpen()
+{
+    if (quickOpenTimer->isActive()) {
+        rebuildQuickOpen();
     }
+    if (!noteCatalog->isValid()) {
+        statusBar()->showMessage(tr("笔记库目录尚未就绪，暂时只能查找笔记名称"), 3000);
+    }
+    quickOpenDialog->showPalette();
+}
+
+// 新增：打开快速打开面板中选中的项
+void MainWindow::openQuickOpenItem(const QuickOpenItem &item)
+{
+    if (item.kind == QuickOpenItem::Note) {
+        if (maybeSave()) {
+            loadNote(item.note);
+        }
+        return;
+    }
+
+    const QString filePath = resourcesPath + "/" + item.note + "/" + item.path;
+    if (QFileInfo(item.path).suffix().toLower() == "pdf") {
+        openPdfFile(filePath);
+        return;
+    }
+
+    // 已经打开的文档直接跳到标题
+    if (QFileInfo(filePath) == QFileInfo(currentFilePath) && !noteLoader->isLoading()) {
+        if (item.line > 0) {
+            const QTextBlock block = ui->markdownEditor->document()->findBlockByNumber(item.line - 1);
+            if (block.isValid()) {
+                ui->markdownEditor->setTextCursor(QTextCursor(block));
+                ui->markdownEditor->centerCursor();
+            }
+        }
+        return;
+    }
+
+    if (!maybeSave()) {
+        return;
+    }
+    updateDetailsList(item.note);
+    pendingJumpLine = item.line;
+    if (!loadEditorFile(filePath, tr("文档 '%1' 已加载").arg(item.path))) {
+        pendingJumpLine = 0;
+        QMessageBox::warning(this, tr("警告"), tr("无法打开文件: %1\n错误: %2").arg(item.path, noteLoader->errorString()));
+    }
+}
+
+// 新增：文件位于 resources/<笔记>/ 下时返回笔记名称，否则返回空字符串
+QString MainWindow::noteNameForFile(const QString &filePath) const
+{
+    const QDir noteDir = QFileInfo(filePath).absoluteDir();
+    QDir parentDir = noteDir;
+    if (!parentDir.cdUp() || parentDir.absolutePath() != QDir(resourcesPath).absolutePath()) {
+        return QString();
+    }
+    return noteDir.dirName();
 }
 
 // 新增函数：打开PDF文件
@@ -940,6 +1439,7 @@ void MainWindow::openPdfFile(const QString &filePath)
 // 新增函数：根据笔记名称加载笔记
 void MainWindow::loadNote(const QString &noteName)
 {
+    PERF_SCOPE("MainWindow::loadNote");
     /*
     // 假设笔记文件名为 "笔记名.md"，存放在 "resources/笔记名/" 目录下
     QString filePath = resourcesPath + "/" + noteName + "/" + noteName + ".md";
@@ -966,38 +1466,122 @@ void MainWindow::loadNote(const QString &noteName)
 
     QString filePath = resourcesPath + "/" + noteName + "/" + noteName + ".md";
 
-    QFile file(filePath);
-    if (!file.exists() || !file.open(QIODevice::ReadOnly | QFile::Text)) {
-        QMessageBox::warning(this, tr("警告"), tr("无法打开笔记文件: %1\n错误: %2").arg(QFileInfo(filePath).fileName(), file.errorString()));
+    if (!loadEditorFile(filePath, tr("笔记 '%1' 已加载").arg(noteName))) {
+        QMessageBox::warning(this, tr("警告"), tr("无法打开笔记文件: %1\n错误: %2").arg(QFileInfo(filePath).fileName(), noteLoader->errorString()));
         return;
     }
 
-    // 完全屏蔽 textChanged 信号，直到加载完成
-    disconnect(ui->markdownEditor, &QTextEdit::textChanged,
-               this, &MainWindow::on_markdownEditor_textChanged);
+    // 更新详情列表
+    updateDetailsList(noteName);
+}
+
+// 新增：把文件流式加载到编辑器。大文件分批插入，加载期间编辑器只读，
+// textChanged 信号一直屏蔽到加载完成（见 onNoteLoadFinished）。
+// 无法打开文件时返回 false，错误信息见 noteLoader->errorString()
+bool MainWindow::loadEditorFile(const QString &filePath, const QString &loadedMessage)
+{
+    // 上一次加载还没完成时，它的信号已经被屏蔽，不要重复断开
+    if (!noteLoader->isLoading()) {
+        disconnect(ui->markdownEditor, &QPlainTextEdit::textChanged,
+                   this, &MainWindow::on_markdownEditor_textChanged);
+    }
+    noteLoadedMessage = loadedMessage;
+    ui->markdownEditor->setReadOnly(true);
+
+    // 新增：加载会清空编辑器，先暂停自动保存日志（之前的日志保留）
+    autosaveJournal->stop();
 
-    // 设置当前文件路径
+    // 先设置路径，让预览器知道基准；打开失败时恢复原来的路径
+    const QString previousPath = currentFilePath;
+    const bool previousModified = isWindowModified();
     setCurrentFile(filePath);
 
-    // 读取文件内容
-    QTextStream in(&file);
-    QString content = in.readAll();
-    file.close();
+    if (!noteLoader->load(filePath, ui->markdownEditor->document())) {
+        setCurrentFile(previousPath);
+        setWindowModified(previousModified);
+        autosaveJournal->resume();
+        ui->markdownEditor->setReadOnly(false);
+        connect(ui->markdownEditor, &QPlainTextEdit::textChanged,
+                this, &MainWindow::on_markdownEditor_textChanged);
+        return false;
+    }
+    return true;
+}
 
-    // 设置文本内容（此时信号被屏蔽，不会触发on_markdownEditor_textChanged）
-    ui->markdownEditor->setPlainText(content);
+// 新增：显示大文件的加载进度
+void MainWindow::onNoteLoadProgress(qint64 bytesLoaded, qint64 bytesTotal)
+{
+    statusBar()->showMessage(tr("正在加载... %1%").arg(bytesTotal > 0 ? bytesLoaded * 100 / bytesTotal : 100));
+}
+
+// 新增：加载完成后恢复编辑，并刷新预览
+void MainWindow::onNoteLoadFinished()
+{
+    ui->markdownEditor->setReadOnly(false);
+    ui->markdownEditor->moveCursor(QTextCursor::Start);
 
     // 立即设置窗口为未修改状态
     setWindowModified(false);
+    savedRevision = ui->markdownEditor->revision();
+    savedFilePath = currentFilePath;
 
     // 恢复信号连接
-    connect(ui->markdownEditor, &QTextEdit::textChanged,
+    connect(ui->markdownEditor, &QPlainTextEdit::textChanged,
             this, &MainWindow::on_markdownEditor_textChanged);
 
-    // 更新详情列表
-    updateDetailsList(noteName);
+    statusBar()->showMessage(noteLoadedMessage, 2000);
+
+    // 新增：上次崩溃前这个笔记有未保存的修改时，询问是否用自动保存日志恢复
+    const DocumentSnapshot loaded = ui->markdownEditor->snapshot();
+    QString recovered;
+    QDateTime journalTime;
+    if (autosaveJournal->recover(currentFilePath, loaded, &recovered, &journalTime)) {
+        const QMessageBox::StandardButton ret =
+            QMessageBox::question(this, tr("恢复未保存的修改"),
+                                  tr("“%1”有上次未保存的修改（自动保存于 %2）。\n是否恢复？")
+                                      .arg(QFileInfo(currentFilePath).fileName(),
+                                           journalTime.toString("yyyy-MM-dd HH:mm:ss")));
+        if (ret == QMessageBox::Yes) {
+            // 作为一次编辑整体替换，可以撤销
+            QTextCursor cursor(ui->markdownEditor->document());
+            cursor.select(QTextCursor::Document);
+            cursor.insertText(recovered);
+            ui->markdownEditor->moveCursor(QTextCursor::Start);
+            statusBar()->showMessage(tr("已恢复未保存的修改"), 2000);
+        }
+    }
+    // 以磁盘上的内容为基准开始记录；恢复了修改时日志立即写下差异，不恢复时旧日志被删除
+    autosaveJournal->begin(currentFilePath, loaded);
+
+    // 新增：从快速打开的标题进入时跳到标题所在行
+    if (pendingJumpLine > 0) {
+        const QTextBlock block = ui->markdownEditor->document()->findBlockByNumber(pendingJumpLine - 1);
+        if (block.isValid()) {
+            ui->markdownEditor->setTextCursor(QTextCursor(block));
+            ui->markdownEditor->centerCursor();
+        }
+        pendingJumpLine = 0;
+    }
 
-    statusBar()->showMessage(tr("笔记 '%1' 已加载").arg(noteName), 2000);
+    updatePreview();
+}
+
+// 新增：启动时如果有崩溃前未保存的笔记，打开最近的一个（加载完成后询问是否恢复）
+void MainWindow::openAutosavedNote()
+{
+    const QStringList notes = autosaveJournal->pendingNotes();
+    if (notes.isEmpty() || !currentFilePath.isEmpty() || noteLoader->isLoading()) {
+        return;
+    }
+
+    const QString filePath = notes.first();
+    const QString noteName = noteNameForFile(filePath);
+    if (!noteName.isEmpty()) {
+        updateDetailsList(noteName);
+    }
+    if (!loadEditorFile(filePath, tr("已打开上次未保存的笔记"))) {
+        qWarning() << "无法打开自动保存的笔记:" << filePath << noteLoader->errorString();
+    }
 }
 
 // 当图片被拖放到编辑器时，这个槽会被调用
@@ -1064,6 +1648,11 @@ void MainWindow::handleDroppedImage(const QMimeData *mime, QTextCursor &cursor)
     }
 
     if (success) {
+        // 新增：assets 目录没有被监视，请求在后台更新元数据目录，同步时才会包含这张图片
+        const QString noteName = noteNameForFile(currentFilePath);
+        if (!noteName.isEmpty()) {
+            noteCatalog->updateNote(noteName);
+        }
         QString relativePath = QDir(mdFileInfo.path()).relativeFilePath(destinationPath);
         relativePath.replace('\\', '/');
         cursor.insertText(QString("\n![%1](%2)\n").arg(QFileInfo(baseName).baseName(), relativePath));
@@ -1093,6 +1682,10 @@ void MainWindow::on_markdownEditor_textChanged()
     // 停止之前的定时器，重新开始延迟
     previewTimer->stop();
     previewTimer->start();
+    // 最长延迟只在本轮输入的第一次修改时开始计时
+    if (!previewMaxLatencyTimer->isActive()) {
+        previewMaxLatencyTimer->start();
+    }
 
     setWindowModified(true);
 }
@@ -1100,40 +1693,60 @@ void MainWindow::on_markdownEditor_textChanged()
 // 延迟预览更新函数
 void MainWindow::updatePreview()
 {
-    QString markdownText = ui->markdownEditor->toPlainText();
-
-    if (markdownText.contains('$')) {
-        // 使用改进的数学渲染器
-        QString html = mathRenderer->renderMarkdownWithMath(markdownText);
-
-        // 添加CSS样式来美化数学公式
-        QString styledHtml = QString(
-                                 "<style>"
-                                 ".math-block {"
-                                 "  text-align: center;"
-                                 "  margin: 1em 0;"
-                                 "  padding: 0.5em;"
-                                 "  border: 1px solid #ccc;"
-                                 "  background: #f9f9f9;"
-                                 "  font-family: 'Cambria Math', 'DejaVu Math', serif;"
-                                 "  font-size: 12pt;"
-                                 "}"
-                                 ".math-inline {"
-                                 "  font-family: 'Cambria Math', 'DejaVu Math', serif;"
-                                 "  background: #f0f0f0;"
-                                 "  padding: 0.1em 0.3em;"
-                                 "  border-radius: 3px;"
-                                 "  font-size: 16pt;"
-                                 "}"
-                                 "</style>"
-                                 "%1"
-                                 ).arg(html);
-
-        ui->htmlPreview->setHtml(styledHtml);
-    } else {
-        // 如果没有数学公式，使用Qt内置Markdown渲染
-        ui->htmlPreview->setMarkdown(markdownText);
+    PERF_SCOPE("MainWindow::updatePreview");
+    previewTimer->stop();
+    previewMaxLatencyTimer->stop();
+
+    // 只重新渲染内容发生变化的顶层块，其余块保留在预览文档中；
+    // 渲染在后台线程进行，输入时界面不会卡顿。
+    // 渲染器在这里（GUI 线程）创建好，后台任务只使用已经存在的对象
+    ensureMathRenderer();
+    incrementalPreview->requestUpdate(ui->markdownEditor->snapshot());
+}
+
+// 新增：预览更新完成后，根据本次耗时计算下一次的防抖间隔
+void MainWindow::onPreviewUpdated(int renderedBlocks)
+{
+    PERF_SCOPE("MainWindow::onPreviewUpdated");
+    // 本次新生成的公式图片直接注册为预览文档的资源
+    ensureMathRenderer()->formulaImages()->registerResources(ui->htmlPreview->document());
+
+    const qint64 renderMs = incrementalPreview->lastRenderTime();
+    const qint64 applyMs = incrementalPreview->lastApplyTime();
+
+    // 渲染越慢，越要等输入停顿后再刷新；小笔记几乎即时刷新
+    const int interval = int(qBound<qint64>(PreviewMinDelay, (renderMs + applyMs) * 3 + PreviewMinDelay, PreviewMaxDelay));
+    previewTimer->setInterval(interval);
+
+    previewStatsLabel->setText(tr("预览：渲染 %1 ms，更新 %2 ms，%3/%4 块，防抖 %5 ms")
+                                   .arg(renderMs)
+                                   .arg(applyMs)
+                                   .arg(renderedBlocks)
+                                   .arg(incrementalPreview->blockCount())
+                                   .arg(interval));
+}
+
+// 新增：第一次预览时才创建公式渲染器
+MathRenderer *MainWindow::ensureMathRenderer()
+{
+    if (!mathRenderer) {
+        PERF_SCOPE("MainWindow::ensureMathRenderer");
+        mathRenderer = new MathRenderer(this);
+        // 复杂公式渲染成图片，缓存在 resources 旁边的 formula-cache 目录，重新打开笔记时直接复用
+        mathRenderer->formulaImages()->setCacheDirectory(QCoreApplication::applicationDirPath() + "/formula-cache");
     }
+    return mathRenderer;
+}
+
+// 新增：渲染单个预览块，返回可直接插入预览文档的片段。
+// 在后台线程中调用，不能访问界面对象
+QTextDocumentFragment MainWindow::renderPreviewBlock(const QString &source, MarkdownBlock::Kind kind)
+{
+    Q_UNUSED(kind);
+
+    // 统一的 Markdown 渲染路径：公式在词法分析时识别，没有公式的块直接解析，
+    // 正文中单独出现的 $ 或代码中的 $ 不会让整块走公式渲染
+    return mathRenderer->renderMarkdownFragment(source);
 }
 
 // --- 文件操作和核心逻辑 (包含问题3的修复) ---
@@ -1197,19 +1810,9 @@ void MainWindow::openFile()
         return;
     }
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QFile::Text)) {
-        QMessageBox::warning(this, tr("警告"), tr("无法打开文件: %1").arg(file.errorString()));
-        return;
+    if (!loadEditorFile(filePath, tr("文件已加载"))) {
+        QMessageBox::warning(this, tr("警告"), tr("无法打开文件: %1").arg(noteLoader->errorString()));
     }
-
-    setCurrentFile(filePath); // 先设置路径，让预览器知道基准
-
-    QTextStream in(&file);
-    ui->markdownEditor->setPlainText(in.readAll()); // 后加载文本，触发 on_markdownEditor_textChanged
-    file.close();
-
-    statusBar()->showMessage(tr("文件已加载"), 2000);
 }
 
 // ... 其他函数 (newFile, saveFile, saveFileAs, maybeSave, updateWindowTitle, closeEvent) 保持不变即可 ...
@@ -1217,42 +1820,99 @@ void MainWindow::openFile()
 
 void MainWindow::newFile()
 {
+    // 新增：放弃尚未完成的加载，恢复编辑器状态
+    if (noteLoader->isLoading()) {
+        noteLoader->cancel();
+        ui->markdownEditor->setReadOnly(false);
+        connect(ui->markdownEditor, &QPlainTextEdit::textChanged,
+                this, &MainWindow::on_markdownEditor_textChanged);
+    }
 
+    // 新增：新建不会询问是否保存，保留当前笔记的自动保存日志，之后打开该笔记时可以恢复
+    autosaveJournal->stop();
     ui->markdownEditor->clear();
     setCurrentFile(QString());
+    savedFilePath.clear();
     ui->listWidget_details->clear();
     currentNoteName.clear();
     // 重置预览
     ui->htmlPreview->clear();
+    incrementalPreview->reset();
 }
 
 bool MainWindow::saveFile()
 {
+    PERF_SCOPE("MainWindow::saveFile");
+    // 新增：加载尚未完成时编辑器中只有部分内容，不能保存
+    if (noteLoader->isLoading()) {
+        statusBar()->showMessage(tr("笔记正在加载，请稍后再保存"), 2000);
+        return false;
+    }
     if (currentFilePath.isEmpty()) {
         return saveFileAs();
     } else {
-        QFile file(currentFilePath);
-        if (!file.open(QIODevice::WriteOnly | QFile::Text)) {
-            QMessageBox::warning(this, tr("警告"), tr("无法保存文件: %1").arg(file.errorString()));
-            return false;
+        // 新增：与预览共享同一个快照；内容自上次保存后没有变化时不再重写文件
+        const DocumentSnapshot snapshot = ui->markdownEditor->snapshot();
+        if (snapshot.revision() == savedRevision && currentFilePath == savedFilePath
+            && QFileInfo::exists(currentFilePath)) {
+            setWindowModified(false);
+            statusBar()->showMessage(tr("文件未修改"), 2000);
+            return true;
         }
 
-        QTextStream out(&file);
-        out << ui->markdownEditor->toPlainText();
-        file.close();
-
-        setWindowModified(false);
-        statusBar()->showMessage(tr("文件已保存"), 2000);
-        setupResourcesAndLoadNotes();
+        // 新增：在后台线程原子写入，完成后由 onNoteSaved 更新窗口状态和列表
+        noteSaver->save(currentFilePath, snapshot);
+        statusBar()->showMessage(tr("正在保存..."));
+        return true;
+    }
+}
 
-        // 如果当前有选中的笔记，更新详情列表
-        if (!currentNoteName.isEmpty()) {
-            updateDetailsList(currentNoteName);
+// 新增：后台保存完成
+void MainWindow::onNoteSaved(const QString &filePath, const DocumentSnapshot &snapshot)
+{
+    if (filePath == currentFilePath) {
+        savedRevision = snapshot.revision();
+        savedFilePath = filePath;
+        // 保存期间又有输入时仍保持修改状态
+        if (snapshot.revision() == ui->markdownEditor->revision()) {
+            setWindowModified(false);
         }
-        return true;
+        // 自动保存日志以刚保存的版本为基准重新开始
+        autosaveJournal->begin(filePath, snapshot);
+    } else {
+        // 切换笔记前提交的保存：这个笔记的日志已经没有用了
+        autosaveJournal->remove(filePath);
+    }
+    // 笔记库中的 Markdown 笔记只更新它自己的索引条目，并立即刷新所在笔记的列表项，
+    // 不等待文件系统通知
+    const QString noteName = noteNameForFile(filePath);
+    if (!noteName.isEmpty()) {
+        if (isMarkdownFile(filePath)) {
+            noteIndex->updateFile(filePath, snapshot);
+        }
+        noteLibrary->refresh(noteName);
+    }
+    statusBar()->showMessage(tr("文件已保存"), 2000);
+    // 新增：同步在等待这次保存（排队中的保存也写完后才继续）
+    if (syncAfterSave && !noteSaver->isSaving()) {
+        syncAfterSave = false;
+        checkLocalChanges();
     }
 }
 
+// 新增：后台保存失败，原文件保持不变
+void MainWindow::onNoteSaveFailed(const QString &filePath, quint64 revision, const QString &errorString)
+{
+    Q_UNUSED(revision);
+    statusBar()->clearMessage();
+    // 新增：保存失败时同步仍然继续，上传的是磁盘上原来的文件
+    if (syncAfterSave && !noteSaver->isSaving()) {
+        syncAfterSave = false;
+        checkLocalChanges();
+    }
+    QMessageBox::warning(this, tr("警告"), tr("无法保存文件 %1: %2").arg(QFileInfo(filePath).fileName(), errorString));
+}
+
 bool MainWindow::saveFileAs()
 {
     QString filePath = QFileDialog::getSaveFileName(this, tr("另存为"), "", tr("Markdown 文件 (*.md *.markdown);;所有文件 (*.*)"));
@@ -1281,6 +1941,8 @@ bool MainWindow::maybeSave()
     case QMessageBox::Cancel:
         return false;
     default:
+        // 新增：用户放弃修改，自动保存日志也一并删除
+        autosaveJournal->discard();
         break;
     }
     return true;
@@ -1294,7 +1956,16 @@ void MainWindow::updateWindowTitle()
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    if (maybeSave()) {
+    // 新增：等后台保存写完；保存失败时（已提示）不关闭窗口，避免丢失修改
+    bool saveFailed = false;
+    const QMetaObject::Connection failWatch =
+        connect(noteSaver, &NoteSaver::failed, this, [&saveFailed]() { saveFailed = true; });
+    const bool accepted = maybeSave();
+    noteSaver->waitForFinished();
+    disconnect(failWatch);
+    autosaveJournal->waitForFinished();
+
+    if (accepted && !saveFailed) {
         event->accept();
     } else {
         event->ignore();
@@ -2,6 +2,8 @@
 #define MAINWINDOW_H
 
 #include "mathrenderer.h"  // 新增
+#include "incrementalpreview.h"  // 新增：增量预览
+#include "noteindex.h"  // 新增：全文搜索（搜索结果类型）
 #include <QMainWindow>
 #include <QDebug>
 #include <QString>
@@ -11,14 +13,28 @@
 #include <QNetworkReply>  // 新增：网络回复
 #include <QSettings>  // 新增：配置存储
 #include <QDir>  // 新增：目录操作
+#include <QSet>
+#include <QModelIndex>  // 新增：笔记列表的模型下标
+#include <QElapsedTimer>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 class QMimeData;
 class QTextCursor;
 class QListWidgetItem; // 添加 QListWidgetItem 的前向声明
+class QLabel;
 QT_END_NAMESPACE
 
+class PerfOverlay;
+class NoteLoader;
+class NoteSaver;
+class AutosaveJournal;
+class NoteLibrary;
+class NoteListModel;
+class NoteCatalog;
+class QuickOpenDialog;
+struct QuickOpenItem;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -41,8 +57,10 @@ private slots:
 
     // 新增槽函数，用于响应图片拖放信号
     void onImageDropped(const QMimeData *mime, const QPoint &position);
-    // 新增：用于响应 listWidget 列表项双击信号的槽函数
-    void on_listWidget_itemDoubleClicked(QListWidgetItem *item);
+    // 新增：用于响应笔记列表双击信号的槽函数
+    void on_noteListView_doubleClicked(const QModelIndex &index);
+    // 新增：笔记列表右键菜单（排序方式）
+    void onNoteListContextMenu(const QPoint &position);
     // 新增：用于响应 listWidget_details 列表项双击信号的槽函数
     void on_listWidget_details_itemDoubleClicked(QListWidgetItem *item);
 
@@ -72,6 +90,33 @@ private slots:
     // 新增：网络请求完成槽函数
     void onNetworkReplyFinished(QNetworkReply *reply);
 
+    // 新增：预览更新完成，根据耗时调整防抖间隔
+    void onPreviewUpdated(int renderedBlocks);
+
+    // 新增：笔记流式加载的进度和完成
+    void onNoteLoadProgress(qint64 bytesLoaded, qint64 bytesTotal);
+    void onNoteLoadFinished();
+
+    // 新增：全文搜索
+    void on_searchEdit_textChanged(const QString &text);
+    void on_searchResults_itemDoubleClicked(QListWidgetItem *item);
+    void runSearch();
+    void onSearchFinished(const QString &query, const QList<NoteIndex::Hit> &hits);
+    // 新增：快速打开（Ctrl+P）
+    void openQuickOpen();
+    void rebuildQuickOpen();
+
+    // 新增：笔记库目录变化（包括程序外的修改），只更新对应的列表项
+    void onLibraryNoteAdded(const QString &noteName);
+    void onLibraryNoteRemoved(const QString &noteName);
+    void onLibraryFileAdded(const QString &noteName, const QString &fileName);
+    void onLibraryFileRemoved(const QString &noteName, const QString &fileName);
+    void onLibraryFileChanged(const QString &noteName, const QString &fileName);
+
+    // 新增：后台保存完成或失败
+    void onNoteSaved(const QString &filePath, const DocumentSnapshot &snapshot);
+    void onNoteSaveFailed(const QString &filePath, quint64 revision, const QString &errorString);
+
 private:
     void newFile();
     void openFile();
@@ -89,9 +134,19 @@ private:
 
     // 新增：根据笔记名称加载笔记文件
     void loadNote(const QString &noteName);
+    // 新增：把文件流式加载到编辑器
+    bool loadEditorFile(const QString &filePath, const QString &loadedMessage);
 
     // 新增：更新详情列表，显示当前笔记文件夹下的文档
     void updateDetailsList(const QString &noteName);
+    // 新增：启动时打开上次崩溃前未保存的笔记
+    void openAutosavedNote();
+    // 新增：文件位于 resources/<笔记>/ 下时返回笔记名称
+    QString noteNameForFile(const QString &filePath) const;
+    // 新增：在详情列表中按顺序插入一个文档
+    void addDetailsItem(const QString &fileName);
+    // 新增：打开快速打开面板中选中的笔记、文档或标题
+    void openQuickOpenItem(const QuickOpenItem &item);
 
     // 新增：打开PDF文件
     void openPdfFile(const QString &filePath);
@@ -107,16 +162,26 @@ private:
     void switchLanguage(const QString &languageCode);
     void loadLanguage(const QString &languageCode);
     void updateLanguageMenu();
+    static QString translationFilePath(const QString &fileName);  // 新增：带缓存的翻译文件查找
     void updatePreview();
+    // 新增：按需创建公式渲染器
+    MathRenderer *ensureMathRenderer();
+    // 新增：渲染单个预览块
+    QTextDocumentFragment renderPreviewBlock(const QString &source, MarkdownBlock::Kind kind);
 
     Ui::MainWindow *ui;
     QString currentFilePath;
 
     // 新增：同步相关函数
     void setupSyncSystem();
+    void ensureSyncSystem();  // 新增：第一次使用同步时再创建网络和配置对象
     void loadSyncSettings();
     void saveSyncSettings();
     void syncFiles();
+    void checkLocalChanges();        // 新增：保存写完之后校验元数据目录，再制定同步计划
+    void planSyncFromCatalog();      // 新增：按元数据目录中的哈希只上传变化的文件
+    void planSyncFromDirectories();  // 新增：没有元数据目录时上传全部文件
+    void startSync(const QSet<QString> &directoriesToCreate, int upToDateFiles);
     void uploadFile(const QString &localPath, const QString &remotePath);
     void createRemoteDirectory(const QString &remotePath);
     void listRemoteDirectory(const QString &remotePath);
@@ -133,6 +198,25 @@ private:
     // 修改LaTeX渲染器
     MathRenderer *mathRenderer;
     QTimer *previewTimer;
+    QTimer *previewMaxLatencyTimer;  // 新增：连续输入时保证预览定期刷新
+    QLabel *previewStatsLabel;       // 新增：状态栏中显示预览耗时
+    IncrementalPreview *incrementalPreview;  // 新增：按块增量更新预览
+    PerfOverlay *perfOverlay;                // 新增：性能面板
+    NoteLoader *noteLoader;                  // 新增：大文件流式加载
+    QString noteLoadedMessage;               // 新增：加载完成后在状态栏显示的消息
+    NoteSaver *noteSaver;                    // 新增：后台原子保存
+    AutosaveJournal *autosaveJournal;        // 新增：自动保存日志，崩溃后恢复
+    NoteIndex *noteIndex;                    // 新增：全文搜索索引
+    NoteLibrary *noteLibrary;                // 新增：监视笔记库目录
+    NoteListModel *noteListModel;            // 新增：笔记列表的数据模型，元数据按需读取
+    NoteCatalog *noteCatalog;                // 新增：笔记库元数据目录（SQLite）
+    QTimer *searchTimer;                     // 新增：搜索框输入防抖
+    QElapsedTimer searchClock;               // 新增：搜索耗时（含后台摘要）
+    QuickOpenDialog *quickOpenDialog = nullptr;  // 新增：快速打开面板，缓存候选
+    QTimer *quickOpenTimer;                  // 新增：笔记库变化后延迟重新生成快速打开的候选
+    int pendingJumpLine = 0;                 // 新增：文档加载完成后跳转到的行（从 1 开始）
+    quint64 savedRevision = 0;               // 新增：最近一次写入磁盘（或从磁盘加载）的编辑器内容版本
+    QString savedFilePath;                   // 新增：savedRevision 对应的文件
 
 
     // 新增：翻译器
@@ -158,6 +242,8 @@ private:
     int successfulUploads;
     int failedUploads;
     bool isSyncing;
+    bool syncPending = false;  // 新增：等待元数据目录校验完成后制定同步计划
+    bool syncAfterSave = false;  // 新增：等待后台保存写完后再检查本地文件
 };
 
 
@@ -0,0 +1,1030 @@
+// markdowndocumentbuilder.cpp
+#include "markdowndocumentbuilder.h"
+#include "mathrenderer.h"
+#include "latexparser.h"
+#include "formulaimages.h"
+#include <QTextDocument>
+#include <QTextDocumentFragment>
+#include <QTextList>
+#include <QTextListFormat>
+#include <QTextImageFormat>
+#include <QFont>
+#include <QColor>
+#include <QStringList>
+#include <QSet>
+
+namespace {
+
+// 与 Qt 自带的 Markdown 导入保持一致的缩进和段落间距
+constexpr int BlockQuoteIndent = 40;
+constexpr int ParagraphMargin = 8;
+constexpr int MaxListLevel = 8;
+// 链接文字 [...] 最多向后查找的字符数，避免 "[[[[..." 这样的输入每个 [ 都扫描到段落末尾
+constexpr qsizetype MaxLinkLabel = 1000;
+
+const QColor CodeBackground(245, 245, 245);
+const QColor LinkColor(11, 87, 208);
+
+bool isBlank(QStringView line)
+{
+    for (QChar c : line) {
+        if (!c.isSpace()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 行首空白宽度（制表符按 4 个空格计算）
+int leadingSpaces(QStringView line)
+{
+    int width = 0;
+    for (QChar c : line) {
+        if (c == u' ') {
+            ++width;
+        } else if (c == u'\t') {
+            width += 4 - width % 4;
+        } else {
+            break;
+        }
+    }
+    return width;
+}
+
+// 去掉最多 width 列的行首空白
+QStringView stripIndent(QStringView line, int width)
+{
+    qsizetype i = 0;
+    int column = 0;
+    while (i < line.size() && column < width) {
+        if (line[i] == u' ') {
+            ++column;
+        } else if (line[i] == u'\t') {
+            column += 4 - column % 4;
+        } else {
+            break;
+        }
+        ++i;
+    }
+    return line.mid(i);
+}
+
+qsizetype runLength(QStringView text, qsizetype from, QChar c)
+{
+    qsizetype end = from;
+    while (end < text.size() && text[end] == c) {
+        ++end;
+    }
+    return end - from;
+}
+
+// ATX 标题：返回级别（1-6），不是标题时返回 0
+int headingLevel(QStringView body, QStringView *content)
+{
+    const qsizetype hashes = runLength(body, 0, u'#');
+    if (hashes < 1 || hashes > 6 || (hashes < body.size() && body[hashes] != u' ' && body[hashes] != u'\t')) {
+        return 0;
+    }
+    QStringView text = body.mid(hashes).trimmed();
+    // 去掉结尾的 # 序列
+    qsizetype end = text.size();
+    while (end > 0 && text[end - 1] == u'#') {
+        --end;
+    }
+    if (end == 0 || text[end - 1] == u' ' || text[end - 1] == u'\t') {
+        text = text.first(end).trimmed();
+    }
+    *content = text;
+    return int(hashes);
+}
+
+bool isThematicBreak(QStringView body)
+{
+    QChar marker;
+    int count = 0;
+    for (QChar c : body) {
+        if (c == u' ' || c == u'\t') {
+            continue;
+        }
+        if (c != u'-' && c != u'*' && c != u'_') {
+            return false;
+        }
+        if (marker.isNull()) {
+            marker = c;
+        } else if (c != marker) {
+            return false;
+        }
+        ++count;
+    }
+    return count >= 3;
+}
+
+// 代码块起始行 ``` / ~~~
+bool fenceStart(QStringView body, QChar *fenceChar, qsizetype *fenceLength, QStringView *info)
+{
+    if (body.isEmpty() || (body[0] != u'`' && body[0] != u'~')) {
+        return false;
+    }
+    const qsizetype length = runLength(body, 0, body[0]);
+    if (length < 3) {
+        return false;
+    }
+    const QStringView rest = body.mid(length).trimmed();
+    if (body[0] == u'`' && rest.contains(u'`')) {
+        // 反引号代码块的语言标记中不能再有反引号，``` 开头的行内代码不是代码块
+        return false;
+    }
+    *fenceChar = body[0];
+    *fenceLength = length;
+    *info = rest;
+    return true;
+}
+
+bool isFenceEnd(QStringView line, QChar fenceChar, qsizetype fenceLength)
+{
+    if (leadingSpaces(line) >= 4) {
+        return false;
+    }
+    const QStringView body = stripIndent(line, 3);
+    const qsizetype length = runLength(body, 0, fenceChar);
+    return length >= fenceLength && isBlank(body.mid(length));
+}
+
+bool isQuoteLine(QStringView line)
+{
+    return leadingSpaces(line) < 4 && stripIndent(line, 3).startsWith(u'>');
+}
+
+QStringView stripQuote(QStringView line)
+{
+    QStringView body = stripIndent(line, 3).mid(1);
+    if (body.startsWith(u' ')) {
+        body = body.mid(1);
+    }
+    return body;
+}
+
+// 原始 HTML 块，交给 Qt 的 Markdown 导入处理
+bool isHtmlStart(QStringView body)
+{
+    return body.size() >= 2 && body[0] == u'<'
+           && (body[1].isLetter() || body[1] == u'/' || body[1] == u'!');
+}
+
+// 表格的分隔行，如 | --- | :---: |
+bool isTableDelimiter(QStringView line)
+{
+    const QStringView body = line.trimmed();
+    if (!body.contains(u'-')) {
+        return false;
+    }
+    bool hasPipe = false;
+    for (QChar c : body) {
+        if (c == u'|') {
+            hasPipe = true;
+        } else if (c != u'-' && c != u':' && c != u' ' && c != u'\t') {
+            return false;
+        }
+    }
+    return hasPipe;
+}
+
+bool isAsciiPunctuation(QChar c)
+{
+    const char16_t u = c.unicode();
+    return (u >= u'!' && u <= u'/') || (u >= u':' && u <= u'@')
+           || (u >= u'[' && u <= u'`') || (u >= u'{' && u <= u'~');
+}
+
+QTextCharFormat codeCharFormat(const QTextCharFormat &base)
+{
+    QTextCharFormat format = base;
+    format.setFontFamilies({QStringLiteral("Consolas"), QStringLiteral("Courier New"), QStringLiteral("monospace")});
+    format.setFontFixedPitch(true);
+    format.setBackground(CodeBackground);
+    return format;
+}
+
+QTextCharFormat mathCharFormat(const QTextCharFormat &base)
+{
+    QTextCharFormat format = base;
+    format.setFontFamilies({QStringLiteral("Cambria Math"), QStringLiteral("STIX Two Math"),
+                            QStringLiteral("Times New Roman")});
+    return format;
+}
+
+QTextCharFormat scriptFormat(const QTextCharFormat &base, QTextCharFormat::VerticalAlignment alignment)
+{
+    QTextCharFormat format = base;
+    format.setVerticalAlignment(alignment);
+    return format;
+}
+
+// 分数的分子/分母是否无需加括号
+bool isSimpleMath(const LatexNode &node)
+{
+    switch (node.type) {
+    case LatexNode::Symbol:
+    case LatexNode::Command:
+        return true;
+    case LatexNode::Text:
+        for (QChar c : node.text) {
+            if (!c.isLetterOrNumber() && c != u'.') {
+                return false;
+            }
+        }
+        return true;
+    case LatexNode::Sequence:
+        return node.children.size() == 1 && isSimpleMath(node.children.front());
+    case LatexNode::Scripts:
+        return isSimpleMath(node.children.front());
+    default:
+        return false;
+    }
+}
+
+// 找到 [ 对应的 ]，不存在时返回 -1
+qsizetype matchingBracket(const QString &text, qsizetype open, qsizetype end)
+{
+    end = qMin(end, open + MaxLinkLabel);
+    int depth = 0;
+    for (qsizetype i = open; i < end; ++i) {
+        const QChar c = text[i];
+        if (c == u'\\') {
+            ++i;
+        } else if (c == u'[') {
+            ++depth;
+        } else if (c == u']' && --depth == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 解析 (url "title")，成功时返回 ) 之后的位置，失败返回 -1
+qsizetype parseLinkDestination(const QString &text, qsizetype open, qsizetype end, QString *url)
+{
+    if (open >= end || text[open] != u'(') {
+        return -1;
+    }
+    int depth = 0;
+    for (qsizetype i = open; i < end; ++i) {
+        const QChar c = text[i];
+        if (c == u'\\') {
+            ++i;
+        } else if (c == u'\n') {
+            return -1;
+        } else if (c == u'(') {
+            ++depth;
+        } else if (c == u')' && --depth == 0) {
+            QStringView inside = QStringView(text).mid(open + 1, i - open - 1).trimmed();
+            if (inside.startsWith(u'<')) {
+                const qsizetype close = inside.indexOf(u'>');
+                inside = close < 0 ? inside.mid(1) : inside.mid(1, close - 1);
+            } else {
+                // 空白之后是标题，不属于地址
+                qsizetype space = 0;
+                while (space < inside.size() && !inside[space].isSpace()) {
+                    ++space;
+                }
+                inside = inside.first(space);
+            }
+            *url = inside.toString();
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+MarkdownDocumentBuilder::MarkdownDocumentBuilder(QTextDocument *document, FormulaImages *images)
+    : m_cursor(document)
+    , m_images(images)
+{
+    m_cursor.movePosition(QTextCursor::End);
+    m_blockUsed = !document->isEmpty();
+}
+
+void MarkdownDocumentBuilder::build(QStringView markdown)
+{
+    QList<QStringView> lines;
+    qsizetype start = 0;
+    while (start <= markdown.size()) {
+        qsizetype end = markdown.indexOf(u'\n', start);
+        if (end < 0) {
+            end = markdown.size();
+        }
+        QStringView line = markdown.mid(start, end - start);
+        if (line.endsWith(u'\r')) {
+            line.chop(1);
+        }
+        lines.append(line);
+        start = end + 1;
+    }
+
+    m_cursor.beginEditBlock();
+    buildBlocks(lines, 0);
+    m_cursor.endEditBlock();
+}
+
+// 逐行识别块结构；引用块去掉 > 之后递归处理
+void MarkdownDocumentBuilder::buildBlocks(QList<QStringView> lines, int quoteLevel)
+{
+    const qsizetype n = lines.size();
+    qsizetype i = 0;
+
+    while (i < n) {
+        const QStringView line = lines[i];
+        if (isBlank(line)) {
+            ++i;
+            continue;
+        }
+
+        const int indent = leadingSpaces(line);
+
+        // 缩进代码块（列表内的缩进属于列表内容）
+        if (indent >= 4 && m_lists.isEmpty()) {
+            QStringList code;
+            while (i < n && (isBlank(lines[i]) || leadingSpaces(lines[i]) >= 4)) {
+                code.append(stripIndent(lines[i], 4).toString());
+                ++i;
+            }
+            while (!code.isEmpty() && isBlank(code.last())) {
+                code.removeLast();
+            }
+            appendCodeBlock(code, QString(), quoteLevel);
+            continue;
+        }
+
+        if (indent < 4) {
+            const QStringView body = stripIndent(line, 3);
+
+            QChar fenceChar;
+            qsizetype fenceLength = 0;
+            QStringView info;
+            if (fenceStart(body, &fenceChar, &fenceLength, &info)) {
+                QStringList code;
+                ++i;
+                while (i < n && !isFenceEnd(lines[i], fenceChar, fenceLength)) {
+                    code.append(stripIndent(lines[i], indent).toString());
+                    ++i;
+                }
+                ++i; // 跳过结束标记（没有结束标记时代码块延续到末尾）
+                const qsizetype space = info.indexOf(u' ');
+                appendCodeBlock(code, (space < 0 ? info : info.first(space)).toString(), quoteLevel);
+                continue;
+            }
+
+            if (body.startsWith(u"$$")) {
+                // 块级公式，结束的 $$ 可以在同一行或之后的行
+                QString latex;
+                qsizetype closeLine = -1;
+                qsizetype closeColumn = -1;
+                const qsizetype sameLine = body.indexOf(u"$$", 2);
+                if (sameLine >= 0) {
+                    latex = body.mid(2, sameLine - 2).toString();
+                    closeLine = i;
+                    closeColumn = (body.data() - line.data()) + sameLine;
+                } else {
+                    latex = body.mid(2).toString();
+                    for (qsizetype j = i + 1; j < n; ++j) {
+                        const qsizetype close = lines[j].indexOf(u"$$");
+                        latex += QChar(u'\n');
+                        if (close >= 0) {
+                            latex += lines[j].first(close);
+                            closeLine = j;
+                            closeColumn = close;
+                            break;
+                        }
+                        latex += lines[j];
+                    }
+                }
+                if (closeLine >= 0) {
+                    appendMathBlock(latex.trimmed(), quoteLevel);
+                    const QStringView rest = lines[closeLine].mid(closeColumn + 2);
+                    if (isBlank(rest)) {
+                        i = closeLine + 1;
+                    } else {
+                        // 结束标记后面的文字作为新的一行继续解析
+                        lines[closeLine] = rest;
+                        i = closeLine;
+                    }
+                    continue;
+                }
+                // 没有闭合的 $$，按普通段落处理
+            }
+
+            QStringView headingText;
+            if (const int level = headingLevel(body, &headingText)) {
+                appendHeading(level, headingText.toString(), quoteLevel);
+                ++i;
+                continue;
+            }
+
+            if (isThematicBreak(body)) {
+                appendRule(quoteLevel);
+                ++i;
+                continue;
+            }
+
+            if (isQuoteLine(line)) {
+                QList<QStringView> inner;
+                while (i < n && isQuoteLine(lines[i])) {
+                    inner.append(stripQuote(lines[i]));
+                    ++i;
+                }
+                m_lists.clear();
+                if (quoteLevel < MaxQuoteDepth) {
+                    buildBlocks(inner, quoteLevel + 1);
+                } else {
+                    QStringList text;
+                    for (QStringView part : std::as_const(inner)) {
+                        text.append(part.toString());
+                    }
+                    appendParagraph(text.join(u'\n'), quoteLevel);
+                }
+                continue;
+            }
+
+            const bool table = body.contains(u'|') && i + 1 < n && isTableDelimiter(lines[i + 1]);
+            if (table || isHtmlStart(body)) {
+                // 表格和原始 HTML 交给 Qt 自带的导入器
+                QStringList block;
+                while (i < n && !isBlank(lines[i])) {
+                    block.append(lines[i].toString());
+                    ++i;
+                }
+                appendFallback(block.join(u'\n'), quoteLevel);
+                continue;
+            }
+        }
+
+        const ListMarker marker = listMarker(line);
+        if (marker.valid) {
+            QString text = line.mid(marker.contentOffset).trimmed().toString();
+            ++i;
+            // 延续行：直到空行、下一个列表项或其他块
+            while (i < n && !isBlank(lines[i]) && !listMarker(lines[i]).valid && !startsBlock(lines[i])) {
+                text += QChar(u'\n');
+                text += lines[i].trimmed();
+                ++i;
+            }
+            appendListItem(marker, text, quoteLevel);
+            continue;
+        }
+
+        // 普通段落，下一行是 === / --- 时为 Setext 标题
+        QString text = line.trimmed().toString();
+        ++i;
+        int setextLevel = 0;
+        while (i < n && !isBlank(lines[i])) {
+            const QStringView next = lines[i].trimmed();
+            if (leadingSpaces(lines[i]) < 4 && !next.isEmpty()
+                && (runLength(next, 0, u'=') == next.size() || runLength(next, 0, u'-') == next.size())) {
+                setextLevel = next[0] == u'=' ? 1 : 2;
+                ++i;
+                break;
+            }
+            if (startsBlock(lines[i]) || listMarker(lines[i]).valid) {
+                break;
+            }
+            text += QChar(u'\n');
+            // 保留行尾空白，用于识别硬换行
+            text += stripIndent(lines[i], 1000);
+            ++i;
+        }
+
+        if (setextLevel > 0) {
+            appendHeading(setextLevel, text, quoteLevel);
+        } else {
+            appendParagraph(text, quoteLevel);
+        }
+    }
+}
+
+// 能打断段落的块起始行
+bool MarkdownDocumentBuilder::startsBlock(QStringView line) const
+{
+    if (leadingSpaces(line) >= 4) {
+        return false;
+    }
+    const QStringView body = stripIndent(line, 3);
+    QChar fenceChar;
+    qsizetype fenceLength = 0;
+    QStringView info;
+    QStringView headingText;
+    return fenceStart(body, &fenceChar, &fenceLength, &info)
+           || headingLevel(body, &headingText) > 0
+           || isThematicBreak(body)
+           || body.startsWith(u'>')
+           || body.startsWith(u"$$")
+           || isHtmlStart(body);
+}
+
+MarkdownDocumentBuilder::ListMarker MarkdownDocumentBuilder::listMarker(QStringView line)
+{
+    ListMarker marker;
+    marker.indent = leadingSpaces(line);
+    const QStringView body = stripIndent(line, marker.indent);
+    const qsizetype offset = line.size() - body.size();
+
+    qsizetype markerLength = 0;
+    if (!body.isEmpty() && (body[0] == u'-' || body[0] == u'*' || body[0] == u'+')) {
+        markerLength = 1;
+    } else {
+        qsizetype digits = 0;
+        while (digits < body.size() && digits < 9 && body[digits].isDigit()) {
+            ++digits;
+        }
+        if (digits > 0 && digits < body.size() && (body[digits] == u'.' || body[digits] == u')')) {
+            markerLength = digits + 1;
+            marker.ordered = true;
+        }
+    }
+    if (markerLength == 0) {
+        return marker;
+    }
+    // 标记后面必须是空白或行尾
+    if (markerLength < body.size() && body[markerLength] != u' ' && body[markerLength] != u'\t') {
+        return marker;
+    }
+
+    marker.valid = true;
+    marker.contentOffset = qMin(offset + markerLength + 1, line.size());
+
+    const QStringView content = line.mid(marker.contentOffset);
+    if (content.size() >= 3 && content[0] == u'[' && content[2] == u']'
+        && (content.size() == 3 || content[3] == u' ')) {
+        if (content[1] == u' ') {
+            marker.task = 0;
+        } else if (content[1] == u'x' || content[1] == u'X') {
+            marker.task = 1;
+        }
+        if (marker.task >= 0) {
+            marker.contentOffset = qMin(marker.contentOffset + 4, line.size());
+        }
+    }
+    return marker;
+}
+
+void MarkdownDocumentBuilder::startBlock(const QTextBlockFormat &blockFormat, const QTextCharFormat &charFormat)
+{
+    if (m_blockUsed) {
+        m_cursor.insertBlock(blockFormat, charFormat);
+    } else {
+        // 文档开头的空块直接使用
+        m_cursor.setBlockFormat(blockFormat);
+        m_cursor.setBlockCharFormat(charFormat);
+        m_blockUsed = true;
+    }
+}
+
+QTextBlockFormat MarkdownDocumentBuilder::blockFormat(int quoteLevel) const
+{
+    QTextBlockFormat format;
+    format.setTopMargin(ParagraphMargin);
+    format.setBottomMargin(ParagraphMargin);
+    if (quoteLevel > 0) {
+        format.setProperty(QTextFormat::BlockQuoteLevel, quoteLevel);
+        format.setLeftMargin(BlockQuoteIndent * quoteLevel);
+        format.setRightMargin(BlockQuoteIndent);
+    }
+    return format;
+}
+
+void MarkdownDocumentBuilder::appendParagraph(const QString &text, int quoteLevel)
+{
+    m_lists.clear();
+    startBlock(blockFormat(quoteLevel), QTextCharFormat());
+    appendInline(text, QTextCharFormat());
+}
+
+void MarkdownDocumentBuilder::appendHeading(int level, const QString &text, int quoteLevel)
+{
+    m_lists.clear();
+    QTextBlockFormat format = blockFormat(quoteLevel);
+    format.setHeadingLevel(level);
+
+    QTextCharFormat charFormat;
+    charFormat.setFontWeight(QFont::Bold);
+    charFormat.setProperty(QTextFormat::FontSizeAdjustment, 4 - level);
+
+    startBlock(format, charFormat);
+    appendInline(text, charFormat);
+}
+
+void MarkdownDocumentBuilder::appendListItem(const ListMarker &marker, const QString &text, int quoteLevel)
+{
+    QTextBlockFormat format = blockFormat(quoteLevel);
+    format.setTopMargin(0);
+    format.setBottomMargin(0);
+    if (marker.task == 0) {
+        format.setMarker(QTextBlockFormat::MarkerType::Unchecked);
+    } else if (marker.task == 1) {
+        format.setMarker(QTextBlockFormat::MarkerType::Checked);
+    }
+    startBlock(format, QTextCharFormat());
+
+    // 每缩进两列为一层；更深层的列表到这里结束
+    const int level = qMin(marker.indent / 2, MaxListLevel);
+    if (m_lists.size() > level + 1) {
+        m_lists.resize(level + 1);
+    }
+
+    QTextListFormat::Style style = QTextListFormat::ListDecimal;
+    if (!marker.ordered) {
+        static const QTextListFormat::Style bullets[] = {
+            QTextListFormat::ListDisc, QTextListFormat::ListCircle, QTextListFormat::ListSquare
+        };
+        style = bullets[level % 3];
+    }
+
+    if (level < m_lists.size() && m_lists[level] && m_lists[level]->format().style() == style) {
+        m_lists[level]->add(m_cursor.block());
+    } else {
+        QTextListFormat listFormat;
+        listFormat.setStyle(style);
+        listFormat.setIndent(level + 1);
+        if (m_lists.size() <= level) {
+            m_lists.resize(level + 1);
+        }
+        m_lists[level] = m_cursor.createList(listFormat);
+    }
+
+    appendInline(text, QTextCharFormat());
+}
+
+void MarkdownDocumentBuilder::appendCodeBlock(const QStringList &lines, const QString &language, int quoteLevel)
+{
+    m_lists.clear();
+    QTextBlockFormat format = blockFormat(quoteLevel);
+    format.setNonBreakableLines(true);
+    format.setBackground(CodeBackground);
+    format.setProperty(QTextFormat::BlockCodeFence, QStringLiteral("`"));
+    if (!language.isEmpty()) {
+        format.setProperty(QTextFormat::BlockCodeLanguage, language);
+    }
+
+    const QTextCharFormat charFormat = codeCharFormat(QTextCharFormat());
+    startBlock(format, charFormat);
+    // 整个代码块放在同一个文本块中，用行分隔符换行，背景连成一片
+    m_cursor.insertText(lines.join(QChar(QChar::LineSeparator)), charFormat);
+}
+
+void MarkdownDocumentBuilder::appendMathBlock(const QString &latex, int quoteLevel)
+{
+    m_lists.clear();
+    QTextBlockFormat format = blockFormat(quoteLevel);
+    format.setAlignment(Qt::AlignHCenter);
+
+    QTextCharFormat charFormat;
+    charFormat.setProperty(QTextFormat::FontSizeAdjustment, 1);
+    startBlock(format, charFormat);
+    appendFormula(latex, true, charFormat);
+}
+
+void MarkdownDocumentBuilder::appendRule(int quoteLevel)
+{
+    m_lists.clear();
+    QTextBlockFormat format = blockFormat(quoteLevel);
+    format.setProperty(QTextFormat::BlockTrailingHorizontalRulerWidth,
+                       QTextLength(QTextLength::PercentageLength, 100));
+    startBlock(format, QTextCharFormat());
+}
+
+void MarkdownDocumentBuilder::appendFallback(const QString &markdown, int quoteLevel)
+{
+    m_lists.clear();
+    QTextDocument document;
+    document.setMarkdown(markdown);
+    startBlock(blockFormat(quoteLevel), QTextCharFormat());
+    m_cursor.insertFragment(QTextDocumentFragment(&document));
+}
+
+// 行内内容：先切分出公式，其余文本处理强调、代码、链接和图片
+void MarkdownDocumentBuilder::appendInline(const QString &text, const QTextCharFormat &base)
+{
+    m_base = base;
+    m_bold = false;
+    m_italic = false;
+    m_strike = false;
+    m_href.clear();
+
+    const QList<MathSpan> spans = MathRenderer::tokenize(text);
+    for (const MathSpan &span : spans) {
+        if (span.kind == MathSpan::Text) {
+            appendInlineRange(text, span.start, span.start + span.length);
+        } else {
+            const QString latex = QStringView(text).mid(span.contentStart, span.contentLength).trimmed().toString();
+            appendFormula(latex, span.kind == MathSpan::BlockMath, currentFormat());
+        }
+    }
+}
+
+void MarkdownDocumentBuilder::appendInlineRange(const QString &text, qsizetype start, qsizetype end)
+{
+    QString run;
+    auto flush = [&]() {
+        if (!run.isEmpty()) {
+            m_cursor.insertText(run, currentFormat());
+            run.clear();
+        }
+    };
+    // 强调标记只有在后面还能找到对应的结束标记时才生效
+    auto toggle = [&](bool &state, qsizetype i, QStringView delimiter) {
+        const qsizetype after = i + delimiter.size();
+        if (state) {
+            if (i > 0 && text[i - 1].isSpace()) {
+                return false;
+            }
+        } else if (after >= text.size() || text[after].isSpace()
+                   || text.indexOf(delimiter, after + 1) < 0) {
+            return false;
+        }
+        flush();
+        state = !state;
+        return true;
+    };
+
+    // 找不到闭合的反引号串长度和下一个 >，用来避免对同一段文本反复扫描
+    QSet<qsizetype> unmatchedTicks;
+    qsizetype nextAngle = start;
+
+    qsizetype i = start;
+    while (i < end) {
+        const QChar c = text[i];
+
+        if (c == u'\\' && i + 1 < end) {
+            const QChar next = text[i + 1];
+            if (next == u'\n') {
+                flush();
+                m_cursor.insertText(QString(QChar(QChar::LineSeparator)), currentFormat());
+                i += 2;
+                continue;
+            }
+            if (isAsciiPunctuation(next)) {
+                run += next;
+                i += 2;
+                continue;
+            }
+        }
+
+        if (c == u'\n') {
+            // 行尾两个以上空格为硬换行，否则是软换行
+            qsizetype spaces = 0;
+            while (spaces < run.size() && run[run.size() - 1 - spaces] == u' ') {
+                ++spaces;
+            }
+            run.chop(spaces);
+            if (spaces >= 2) {
+                flush();
+                m_cursor.insertText(QString(QChar(QChar::LineSeparator)), currentFormat());
+            } else {
+                run += QChar(u' ');
+            }
+            ++i;
+            continue;
+        }
+
+        if (c == u'`') {
+            const qsizetype ticks = runLength(text, i, u'`');
+            qsizetype close = -1;
+            for (qsizetype j = unmatchedTicks.contains(ticks) ? end : i + ticks; j < end;) {
+                if (text[j] == u'`') {
+                    const qsizetype length = runLength(text, j, u'`');
+                    if (length == ticks) {
+                        close = j;
+                        break;
+                    }
+                    j += length;
+                } else {
+                    ++j;
+                }
+            }
+            if (close < 0) {
+                unmatchedTicks.insert(ticks);
+                run += text.mid(i, ticks);
+                i += ticks;
+                continue;
+            }
+            flush();
+            QString code = text.mid(i + ticks, close - i - ticks);
+            code.replace(u'\n', u' ');
+            if (code.size() > 2 && code.startsWith(u' ') && code.endsWith(u' ')) {
+                code = code.mid(1, code.size() - 2);
+            }
+            m_cursor.insertText(code, codeCharFormat(currentFormat()));
+            i = close + ticks;
+            continue;
+        }
+
+        if (c == u'*' || c == u'_') {
+            // 单词内部的下划线不是强调
+            const bool intraword = c == u'_' && i > start && i + 1 < end
+                                   && text[i - 1].isLetterOrNumber() && text[i + 1].isLetterOrNumber();
+            if (!intraword) {
+                const QString strong(2, c);
+                if (i + 1 < end && text[i + 1] == c && toggle(m_bold, i, strong)) {
+                    i += 2;
+                    continue;
+                }
+                if (toggle(m_italic, i, QString(c))) {
+                    ++i;
+                    continue;
+                }
+            }
+        }
+
+        if (c == u'~' && i + 1 < end && text[i + 1] == u'~' && toggle(m_strike, i, u"~~")) {
+            i += 2;
+            continue;
+        }
+
+        if (c == u'[' || (c == u'!' && i + 1 < end && text[i + 1] == u'[')) {
+            const bool image = c == u'!';
+            const qsizetype open = image ? i + 1 : i;
+            const qsizetype close = matchingBracket(text, open, end);
+            QString url;
+            const qsizetype after = close < 0 ? -1 : parseLinkDestination(text, close + 1, end, &url);
+            if (after >= 0) {
+                flush();
+                if (image) {
+                    QTextImageFormat format;
+                    format.merge(currentFormat());
+                    format.setName(url);
+                    format.setToolTip(text.mid(open + 1, close - open - 1));
+                    m_cursor.insertImage(format);
+                } else if (m_href.isEmpty()) {
+                    m_href = url;
+                    appendInlineRange(text, open + 1, close);
+                    flush();
+                    m_href.clear();
+                } else {
+                    // 链接不能嵌套
+                    appendInlineRange(text, open + 1, close);
+                }
+                i = after;
+                continue;
+            }
+        }
+
+        if (c == u'<') {
+            // 自动链接 <https://...>
+            if (nextAngle >= 0 && nextAngle <= i) {
+                nextAngle = text.indexOf(u'>', i + 1);
+            }
+            const qsizetype close = nextAngle;
+            if (close > i && close < end) {
+                const QStringView inside = QStringView(text).mid(i + 1, close - i - 1);
+                if ((inside.startsWith(u"http://") || inside.startsWith(u"https://") || inside.startsWith(u"mailto:"))
+                    && !inside.contains(u' ')) {
+                    flush();
+                    const QString previous = m_href;
+                    m_href = inside.toString();
+                    m_cursor.insertText(m_href, currentFormat());
+                    m_href = previous;
+                    i = close + 1;
+                    continue;
+                }
+            }
+        }
+
+        run += c;
+        ++i;
+    }
+    flush();
+}
+
+QTextCharFormat MarkdownDocumentBuilder::currentFormat() const
+{
+    QTextCharFormat format = m_base;
+    if (m_bold) {
+        format.setFontWeight(QFont::Bold);
+    }
+    if (m_italic) {
+        format.setFontItalic(true);
+    }
+    if (m_strike) {
+        format.setFontStrikeOut(true);
+    }
+    if (!m_href.isEmpty()) {
+        format.setAnchor(true);
+        format.setAnchorHref(m_href);
+        format.setFontUnderline(true);
+        format.setForeground(LinkColor);
+    }
+    return format;
+}
+
+// 复杂公式插入图片，其余公式输出为格式化文本
+void MarkdownDocumentBuilder::appendFormula(const QString &latex, bool block, const QTextCharFormat &format)
+{
+    LatexParser parser(latex);
+    const LatexNode root = parser.parse();
+
+    if (m_images && FormulaImages::needsImage(root)) {
+        QSizeF size;
+        const QUrl url = m_images->imageFor(latex, root, block, &size);
+        if (!url.isEmpty()) {
+            QTextImageFormat image;
+            image.setName(url.toString());
+            image.setWidth(size.width());
+            image.setHeight(size.height());
+            image.setVerticalAlignment(QTextCharFormat::AlignMiddle);
+            image.setToolTip(latex);
+            m_cursor.insertImage(image);
+            return;
+        }
+    }
+    appendMath(root, mathCharFormat(format));
+}
+
+// 把公式语法树输出为格式化文本：上下标用字符的垂直对齐，根号下的内容加上划线
+void MarkdownDocumentBuilder::appendMath(const LatexNode &node, const QTextCharFormat &format)
+{
+    switch (node.type) {
+    case LatexNode::Sequence:
+        for (const LatexNode &child : node.children) {
+            appendMath(child, format);
+        }
+        break;
+
+    case LatexNode::Text:
+    case LatexNode::Symbol:
+        m_cursor.insertText(node.text, format);
+        break;
+
+    case LatexNode::Command: {
+        const QString &name = node.text;
+        if (name.size() == 1 && !name[0].isLetter()) {
+            // 单字符命令：转义字符与间距
+            const QChar c = name[0];
+            if (c == u'\\') {
+                m_cursor.insertText(QString(QChar(QChar::LineSeparator)), format);
+            } else if (c == u',' || c == u';' || c == u':' || c == u' ' || c == u'>') {
+                m_cursor.insertText(QStringLiteral(" "), format);
+            } else if (c != u'!') {
+                m_cursor.insertText(QString(c), format);
+            }
+            break;
+        }
+        // 未知命令保持原样
+        m_cursor.insertText(QStringLiteral("\\") + name, format);
+        break;
+    }
+
+    case LatexNode::Fraction: {
+        // 行内无法上下排列，复杂的分子分母加括号
+        for (int part = 0; part < 2; ++part) {
+            const LatexNode &child = node.children[part];
+            const bool simple = isSimpleMath(child);
+            if (part == 1) {
+                m_cursor.insertText(QStringLiteral("/"), format);
+            }
+            if (!simple) {
+                m_cursor.insertText(QStringLiteral("("), format);
+            }
+            appendMath(child, format);
+            if (!simple) {
+                m_cursor.insertText(QStringLiteral(")"), format);
+            }
+        }
+        break;
+    }
+
+    case LatexNode::SquareRoot: {
+        if (node.children.size() > 1) {
+            appendMath(node.children[1], scriptFormat(format, QTextCharFormat::AlignSuperScript));
+        }
+        m_cursor.insertText(QStringLiteral("√"), format);
+        QTextCharFormat radicand = format;
+        radicand.setFontOverline(true);
+        appendMath(node.children[0], radicand);
+        break;
+    }
+
+    case LatexNode::Scripts:
+        appendMath(node.children[0], format);
+        if (node.hasSubscript) {
+            appendMath(node.children[1], scriptFormat(format, QTextCharFormat::AlignSubScript));
+        }
+        if (node.hasSuperscript) {
+            appendMath(node.children[2], scriptFormat(format, QTextCharFormat::AlignSuperScript));
+        }
+        break;
+
+    case LatexNode::Styled: {
+        QTextCharFormat styled = format;
+        if (node.text == "b") {
+            styled.setFontWeight(QFont::Bold);
+        } else if (node.text == "i") {
+            styled.setFontItalic(true);
+        } else {
+            styled.setFontItalic(false);
+        }
+        appendMath(node.children[0], styled);
+        break;
+    }
+    }
+}
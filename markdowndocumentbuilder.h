@@ -0,0 +1,77 @@
+// markdowndocumentbuilder.h
+#ifndef MARKDOWNDOCUMENTBUILDER_H
+#define MARKDOWNDOCUMENTBUILDER_H
+
+#include <QString>
+#include <QStringView>
+#include <QList>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QTextBlockFormat>
+
+class QTextDocument;
+class QTextList;
+class FormulaImages;
+struct LatexNode;
+
+// 原生 Markdown 解析：逐行识别块结构，通过 QTextCursor 直接生成文档内容。
+// 简单公式按格式化文本（上下标、上划线等）输出，复杂公式插入排版好的图片，
+// 不经过 HTML 序列化再解析
+class MarkdownDocumentBuilder
+{
+public:
+    explicit MarkdownDocumentBuilder(QTextDocument *document, FormulaImages *images = nullptr);
+
+    // 把 Markdown 追加到文档末尾
+    void build(QStringView markdown);
+
+    // 引用嵌套层数上限，超过后按普通段落处理
+    static constexpr int MaxQuoteDepth = 16;
+
+private:
+    // 列表项标记：- / * / + / 1. / 1)，可带任务框 [ ] / [x]
+    struct ListMarker
+    {
+        bool valid = false;
+        bool ordered = false;
+        int indent = 0;
+        qsizetype contentOffset = 0;
+        int task = -1;  // -1 普通项，0 未完成，1 已完成
+    };
+
+    void buildBlocks(QList<QStringView> lines, int quoteLevel);
+    bool startsBlock(QStringView line) const;
+    static ListMarker listMarker(QStringView line);
+
+    // 块级输出
+    void startBlock(const QTextBlockFormat &blockFormat, const QTextCharFormat &charFormat);
+    QTextBlockFormat blockFormat(int quoteLevel) const;
+    void appendParagraph(const QString &text, int quoteLevel);
+    void appendHeading(int level, const QString &text, int quoteLevel);
+    void appendListItem(const ListMarker &marker, const QString &text, int quoteLevel);
+    void appendCodeBlock(const QStringList &lines, const QString &language, int quoteLevel);
+    void appendMathBlock(const QString &latex, int quoteLevel);
+    void appendRule(int quoteLevel);
+    void appendFallback(const QString &markdown, int quoteLevel);
+
+    // 行内输出
+    void appendInline(const QString &text, const QTextCharFormat &base);
+    void appendInlineRange(const QString &text, qsizetype start, qsizetype end);
+    void appendFormula(const QString &latex, bool block, const QTextCharFormat &format);
+    void appendMath(const LatexNode &node, const QTextCharFormat &format);
+    QTextCharFormat currentFormat() const;
+
+    QTextCursor m_cursor;
+    FormulaImages *m_images;
+    bool m_blockUsed = false;          // 光标所在的块是否已经写入内容
+    QList<QTextList *> m_lists;        // 按缩进层级记录正在输出的列表
+
+    // 行内状态
+    QTextCharFormat m_base;
+    bool m_bold = false;
+    bool m_italic = false;
+    bool m_strike = false;
+    QString m_href;
+};
+
+#endif // MARKDOWNDOCUMENTBUILDER_H
@@ -5,11 +5,69 @@
 #include <QFileInfo>
 #include <QUrl>
 #include <QDebug>
+#include <QTextDocument>
+#include <QTextCursor>
 
 MarkdownEditor::MarkdownEditor(QWidget *parent)
-    : QTextEdit(parent)
+    : QPlainTextEdit(parent)
 {
     setAcceptDrops(true);
+    connect(document(), &QTextDocument::contentsChange, this, &MarkdownEditor::onContentsChange);
+}
+
+// 把文档的一次修改同步到片段表，只读取新增的文本
+void MarkdownEditor::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved);
+    ++m_revision;
+    const qsizetype documentLength = document()->characterCount() - 1;
+
+    // 整篇替换（setPlainText、clear）时报告的数量包含文档末尾隐含的段落分隔符，
+    // 新增数量按文档长度截断，删除数量由修改前后的长度推出
+    const qsizetype added = qMin<qsizetype>(charsAdded, documentLength - position);
+    const qsizetype removed = m_buffer.size() + added - documentLength;
+    if (position < 0 || added < 0 || removed < 0 || position + removed > m_buffer.size()) {
+        qWarning() << "MarkdownEditor: 无法增量同步编辑内容，重新读取整个文档";
+        resyncBuffer();
+        return;
+    }
+
+    m_buffer.remove(position, removed);
+    QString text;
+    if (added > 0) {
+        QTextCursor cursor(document());
+        cursor.setPosition(position);
+        cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+        text = cursor.selectedText();
+        // 与 toPlainText() 的转换保持一致
+        for (QChar &c : text) {
+            if (c == QChar::ParagraphSeparator || c == QChar::LineSeparator) {
+                c = u'\n';
+            } else if (c == QChar::Nbsp) {
+                c = u' ';
+            }
+        }
+        m_buffer.insert(position, text);
+    }
+    if (removed > 0 || !text.isEmpty()) {
+        emit edited(position, removed, text);
+    }
+}
+
+DocumentSnapshot MarkdownEditor::snapshot() const
+{
+    if (m_snapshot.isNull() || m_snapshot.revision() != m_revision) {
+        m_snapshot = DocumentSnapshot(m_buffer, m_revision);
+    }
+    return m_snapshot;
+}
+
+void MarkdownEditor::resyncBuffer()
+{
+    const qsizetype oldSize = m_buffer.size();
+    const QString text = toPlainText();
+    m_buffer = PieceTable(text);
+    emit edited(0, oldSize, text);
 }
 
 // 辅助函数，判断URL是否为图片
@@ -30,7 +88,7 @@ void MarkdownEditor::dragEnterEvent(QDragEnterEvent *event)
         qDebug() << "Drag enter: Image detected";
     } else {
         // 否则，执行基类的默认行为（例如允许拖动文本）
-        QTextEdit::dragEnterEvent(event);
+        QPlainTextEdit::dragEnterEvent(event);
     }
 }
 
@@ -61,6 +119,6 @@ void MarkdownEditor::dropEvent(QDropEvent *event)
     } else {
         qDebug() << "Drop: Not an image, using default behavior";
         // 否则，执行基类的默认行为
-        QTextEdit::dropEvent(event);
+        QPlainTextEdit::dropEvent(event);
     }
 }
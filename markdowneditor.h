@@ -1,29 +1,48 @@
 #ifndef MARKDOWNEDITOR_H
 #define MARKDOWNEDITOR_H
 
-#include <QTextEdit>
+#include <QPlainTextEdit>
+#include "documentsnapshot.h"
 
 class QMimeData;
 
-class MarkdownEditor : public QTextEdit
+class MarkdownEditor : public QPlainTextEdit
 {
     Q_OBJECT
 
 public:
     explicit MarkdownEditor(QWidget *parent = nullptr);
 
+    // 与编辑器内容同步的片段表：每次编辑只更新修改的部分，复制得到的快照可以交给其他线程读取
+    const PieceTable &buffer() const { return m_buffer; }
+
+    // 内容版本号，每次修改后递增
+    quint64 revision() const { return m_revision; }
+    // 当前内容的快照；内容未变时返回同一个快照，完整文本只生成一次
+    DocumentSnapshot snapshot() const;
+
 signals:
     // 定义一个信号，当图片被拖放时发出
     // 参数是 MIME 数据和当时的光标位置
     void imageDropped(const QMimeData *mime, const QPoint &position);
+    // 内容被修改：从 position 开始删除 removed 个字符并插入 text（坐标与 buffer() 一致）
+    void edited(qsizetype position, qsizetype removed, const QString &text);
 
 protected:
     // 重写拖放事件处理函数
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dropEvent(QDropEvent *event) override;
 
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
 private:
     bool isImageUrl(const QUrl& url) const;
+    void resyncBuffer();
+
+    PieceTable m_buffer;
+    quint64 m_revision = 0;
+    mutable DocumentSnapshot m_snapshot;
 };
 
 #endif // MARKDOWNEDITOR_H
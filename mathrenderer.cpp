@@ -1,289 +1,525 @@
-// mathrenderer.cpp
-#include "mathrenderer.h"
-#include <QRegularExpression>
-#include <QTextDocument>
-#include <QStack>
-
-MathRenderer::MathRenderer(QObject *parent)
-    : QObject(parent)
-{
-    initializeSymbols();
-}
-
-void MathRenderer::initializeSymbols()
-{
-    // 基本希腊字母
-    m_symbols["\\alpha"] = "α";
-    m_symbols["\\beta"] = "β";
-    m_symbols["\\gamma"] = "γ";
-    m_symbols["\\delta"] = "δ";
-    m_symbols["\\epsilon"] = "ε";
-    m_symbols["\\zeta"] = "ζ";
-    m_symbols["\\eta"] = "η";
-    m_symbols["\\theta"] = "θ";
-    m_symbols["\\iota"] = "ι";
-    m_symbols["\\kappa"] = "κ";
-    m_symbols["\\lambda"] = "λ";
-    m_symbols["\\mu"] = "μ";
-    m_symbols["\\nu"] = "ν";
-    m_symbols["\\xi"] = "ξ";
-    m_symbols["\\pi"] = "π";
-    m_symbols["\\rho"] = "ρ";
-    m_symbols["\\sigma"] = "σ";
-    m_symbols["\\tau"] = "τ";
-    m_symbols["\\upsilon"] = "υ";
-    m_symbols["\\phi"] = "φ";
-    m_symbols["\\chi"] = "χ";
-    m_symbols["\\psi"] = "ψ";
-    m_symbols["\\omega"] = "ω";
-
-    // 大写希腊字母
-    m_symbols["\\Gamma"] = "Γ";
-    m_symbols["\\Delta"] = "Δ";
-    m_symbols["\\Theta"] = "Θ";
-    m_symbols["\\Lambda"] = "Λ";
-    m_symbols["\\Xi"] = "Ξ";
-    m_symbols["\\Pi"] = "Π";
-    m_symbols["\\Sigma"] = "Σ";
-    m_symbols["\\Upsilon"] = "Υ";
-    m_symbols["\\Phi"] = "Φ";
-    m_symbols["\\Psi"] = "Ψ";
-    m_symbols["\\Omega"] = "Ω";
-
-    // 数学符号
-    m_symbols["\\infty"] = "∞";
-    m_symbols["\\partial"] = "∂";
-    m_symbols["\\nabla"] = "∇";
-    m_symbols["\\sum"] = "∑";
-    m_symbols["\\prod"] = "∏";
-    m_symbols["\\int"] = "∫";
-    m_symbols["\\pm"] = "±";
-    m_symbols["\\mp"] = "∓";
-    m_symbols["\\times"] = "×";
-    m_symbols["\\div"] = "÷";
-    m_symbols["\\cdot"] = "·";
-    m_symbols["\\leq"] = "≤";
-    m_symbols["\\geq"] = "≥";
-    m_symbols["\\neq"] = "≠";
-    m_symbols["\\approx"] = "≈";
-    m_symbols["\\propto"] = "∝";
-    m_symbols["\\in"] = "∈";
-    m_symbols["\\notin"] = "∉";
-    m_symbols["\\subset"] = "⊂";
-    m_symbols["\\supset"] = "⊃";
-    m_symbols["\\cup"] = "∪";
-    m_symbols["\\cap"] = "∩";
-    m_symbols["\\wedge"] = "∧";
-    m_symbols["\\vee"] = "∨";
-    m_symbols["\\neg"] = "¬";
-    m_symbols["\\forall"] = "∀";
-    m_symbols["\\exists"] = "∃";
-    m_symbols["\\emptyset"] = "∅";
-
-    // 新增：分数相关符号
-    m_symbols["\\frac"] = ""; // 特殊处理
-    //新增：平方根符号
-    m_symbols["\\sqrt"] = ""; // 特殊处理
-    m_symbols["\\surd"] = "√";
-}
-
-QString MathRenderer::renderMarkdownWithMath(const QString &markdownText)
-{
-    QString result = markdownText;
-
-    // 首先渲染所有数学公式
-    // 处理块级公式 $$...$$
-    static QRegularExpression blockPattern(R"(\$\$(.*?)\$\$)");
-    QRegularExpressionMatchIterator blockIt = blockPattern.globalMatch(result);
-
-    while (blockIt.hasNext()) {
-        QRegularExpressionMatch match = blockIt.next();
-        QString latex = match.captured(1).trimmed();
-        QString rendered = renderMathBlock(latex);
-        result.replace(match.captured(0), rendered);
-    }
-
-    // 处理行内公式 $...$
-    static QRegularExpression inlinePattern(R"(\$(.*?)\$)");
-    QRegularExpressionMatchIterator inlineIt = inlinePattern.globalMatch(result);
-
-    while (inlineIt.hasNext()) {
-        QRegularExpressionMatch match = inlineIt.next();
-        QString latex = match.captured(1).trimmed();
-        QString rendered = renderMathInline(latex);
-        result.replace(match.captured(0), rendered);
-    }
-
-    // 现在将剩余的Markdown文本转换为HTML
-    QTextDocument doc;
-    doc.setMarkdown(result);
-
-    QString html = doc.toHtml();
-    /* 把样式写进 <head> */
-    html.insert(html.indexOf("<head>") + 6,
-                R"(<style>
-                 body { font-family: "Microsoft YaHei"; font-size: 14pt; color: #333; }
-               </style>)");
-    return html;
-}
-
-QString MathRenderer::convertLaTeXToUnicode(const QString &latex)
-{
-    QString result = latex;
-
-    // 先处理平方根（需要优先处理，因为平方根内可能包含其他符号）
-    result = processSquareRoots(result);
-
-    // 先处理分数（需要优先处理，因为分数可能包含其他符号）
-    result = processFractions(result);
-
-    // 替换已知符号
-    for (auto it = m_symbols.begin(); it != m_symbols.end(); ++it) {
-        if (!it.value().isEmpty()) { // 跳过需要特殊处理的命令（如\frac）
-            result.replace(it.key(), it.value());
-        }
-    }
-
-    // 处理上下标
-    // 上标
-    result.replace("^2", "²");
-    result.replace("^3", "³");
-    result.replace("^1", "¹");
-    result.replace("^0", "⁰");
-    result.replace("^n", "ⁿ");
-
-    // 下标
-    result.replace("_1", "₁");
-    result.replace("_2", "₂");
-    result.replace("_0", "₀");
-    result.replace("_n", "ₙ");
-
-    // 处理更复杂的上下标模式
-    static QRegularExpression superscriptPattern(R"(\^\{([^}]+)\})");
-    QRegularExpressionMatchIterator supIt = superscriptPattern.globalMatch(result);
-    while (supIt.hasNext()) {
-        QRegularExpressionMatch match = supIt.next();
-        QString exp = match.captured(1);
-        // 这里可以添加更多上标字符映射
-        if (exp == "2") result.replace(match.captured(0), "²");
-        else if (exp == "3") result.replace(match.captured(0), "³");
-        // 对于无法映射的情况，保持原样
-    }
-
-    static QRegularExpression subscriptPattern(R"(_\{([^}]+)\})");
-    QRegularExpressionMatchIterator subIt = subscriptPattern.globalMatch(result);
-    while (subIt.hasNext()) {
-        QRegularExpressionMatch match = subIt.next();
-        QString exp = match.captured(1);
-        // 这里可以添加更多下标字符映射
-        if (exp == "1") result.replace(match.captured(0), "₁");
-        else if (exp == "2") result.replace(match.captured(0), "₂");
-        // 对于无法映射的情况，保持原样
-    }
-
-    return result;
-}
-
-// 新增：处理平方根
-QString MathRenderer::processSquareRoots(const QString &latex)
-{
-    QString result = latex;
-
-    // 匹配 \sqrt[次数]{被开方数}
-    static QRegularExpression sqrtWithIndexPattern(R"(\\sqrt\[([^\[\]]*)\]\{([^{}]*)\})");
-    QRegularExpressionMatchIterator sqrtWithIndexIt = sqrtWithIndexPattern.globalMatch(result);
-
-    while (sqrtWithIndexIt.hasNext()) {
-        QRegularExpressionMatch match = sqrtWithIndexIt.next();
-        QString index = match.captured(1);
-        QString radicand = match.captured(2);
-
-        // 递归处理指数和被开方数中的其他LaTeX命令
-        index = convertLaTeXToUnicode(index);
-        radicand = convertLaTeXToUnicode(radicand);
-
-        // 创建带次数的根号显示
-        QString sqrtHtml = QString(
-                               "<span style=\"display: inline-block; vertical-align: middle; position: relative;\">"
-                               "<span style=\"position: absolute; top: -0.5em; left: 0.5em; font-size: 0.7em;\">%1</span>"
-                               "<span style=\"border-top: 1px solid; margin-left: 0.8em;\">%2</span>"
-                               "<span style=\"position: absolute; left: 0; top: 0; font-size: 1.2em;\">√</span>"
-                               "</span>"
-                               ).arg(index, radicand);
-
-        result.replace(match.captured(0), sqrtHtml);
-    }
-
-    // 匹配 \sqrt{被开方数}（普通平方根）
-    static QRegularExpression sqrtPattern(R"(\\sqrt\{([^{}]*)\})");
-    QRegularExpressionMatchIterator sqrtIt = sqrtPattern.globalMatch(result);
-
-    while (sqrtIt.hasNext()) {
-        QRegularExpressionMatch match = sqrtIt.next();
-        QString radicand = match.captured(1);
-
-        // 递归处理被开方数中的其他LaTeX命令
-        radicand = convertLaTeXToUnicode(radicand);
-
-        // 创建普通平方根显示
-        QString sqrtHtml = QString(
-                               "<span style=\"display: inline-block; vertical-align: middle;\">"
-                               "<span style=\"border-top: 1px solid; margin-left: 0.5em;\">%1</span>"
-                               "<span style=\"margin-left: 0.1em; font-size: 1.2em;\">√</span>"
-                               "</span>"
-                               ).arg(radicand);
-
-        result.replace(match.captured(0), sqrtHtml);
-    }
-
-    return result;
-}
-
-// 新增：处理分数
-QString MathRenderer::processFractions(const QString &latex)
-{
-    QString result = latex;
-
-    // 匹配 \frac{分子}{分母}
-    static QRegularExpression fracPattern(R"(\\frac\{([^{}]*)\}\{([^{}]*)\})");
-    QRegularExpressionMatchIterator fracIt = fracPattern.globalMatch(result);
-
-    while (fracIt.hasNext()) {
-        QRegularExpressionMatch match = fracIt.next();
-        QString numerator = match.captured(1);
-        QString denominator = match.captured(2);
-
-        // 递归处理分子和分母中的其他LaTeX命令
-        numerator = convertLaTeXToUnicode(numerator);
-        denominator = convertLaTeXToUnicode(denominator);
-
-        // 创建分数显示（使用HTML表格模拟分数布局）
-        QString fractionHtml = QString(
-                                   "<span style=\"display: inline-block; text-align: center; vertical-align: middle; margin: 0 0.1em;\">"
-                                   "<span style=\"display: block; padding: 0 0.1em; border-bottom: 1px solid; font-size: 0.8em;\">%1/</span>"
-                                   "<span style=\"display: block; padding: 0 0.1em; font-size: 0.8em;\">%2</span>"
-                                   "</span>"
-                                   ).arg(numerator, denominator);
-
-        result.replace(match.captured(0), fractionHtml);
-    }
-
-    return result;
-}
-
-QString MathRenderer::renderMathBlock(const QString &latex)
-{
-    QString converted = convertLaTeXToUnicode(latex);
-    return QString("<div style=\"text-align: center; margin: 1em 0; padding: 0.5em; "
-                   "border: 1px solid #ccc; background: #f9f9f9; font-family: 'Microsoft YaHei', '微软雅黑', sans-serif; font-size: 14px; line-height: 1.5;\">"
-                   "%1</div>").arg(converted);
-}
-
-QString MathRenderer::renderMathInline(const QString &latex)
-{
-    QString converted = convertLaTeXToUnicode(latex);
-    return QString("<span style=\"font-family: 'Microsoft YaHei', '微软雅黑', sans-serif !important; "
-                   "background: #f0f0f0 !important; padding: 0.1em 0.3em !important; border-radius: 3px !important; "
-                   "font-size: 14px !important; line-height: 1.5 !important;\">"
-                   "%1</span>").arg(converted);
-}
+// mathrenderer.cpp
+#include "mathrenderer.h"
+#include "latexparser.h"
+#include "markdowndocumentbuilder.h"
+#include "perftrace.h"
+#include <QTextDocument>
+#include <QTextDocumentFragment>
+#include <QSet>
+
+namespace {
+
+// 能用 Unicode 上下标字符表示的字符，无法表示时返回空 QChar
+QChar scriptChar(QChar c, bool superscript)
+{
+    if (superscript) {
+        switch (c.unicode()) {
+        case u'0': return QChar(0x2070);
+        case u'1': return QChar(0x00B9);
+        case u'2': return QChar(0x00B2);
+        case u'3': return QChar(0x00B3);
+        case u'4': return QChar(0x2074);
+        case u'5': return QChar(0x2075);
+        case u'6': return QChar(0x2076);
+        case u'7': return QChar(0x2077);
+        case u'8': return QChar(0x2078);
+        case u'9': return QChar(0x2079);
+        case u'+': return QChar(0x207A);
+        case u'-': return QChar(0x207B);
+        case u'=': return QChar(0x207C);
+        case u'(': return QChar(0x207D);
+        case u')': return QChar(0x207E);
+        case u'i': return QChar(0x2071);
+        case u'n': return QChar(0x207F);
+        default: return QChar();
+        }
+    }
+
+    switch (c.unicode()) {
+    case u'0': return QChar(0x2080);
+    case u'1': return QChar(0x2081);
+    case u'2': return QChar(0x2082);
+    case u'3': return QChar(0x2083);
+    case u'4': return QChar(0x2084);
+    case u'5': return QChar(0x2085);
+    case u'6': return QChar(0x2086);
+    case u'7': return QChar(0x2087);
+    case u'8': return QChar(0x2088);
+    case u'9': return QChar(0x2089);
+    case u'+': return QChar(0x208A);
+    case u'-': return QChar(0x208B);
+    case u'=': return QChar(0x208C);
+    case u'(': return QChar(0x208D);
+    case u')': return QChar(0x208E);
+    case u'a': return QChar(0x2090);
+    case u'e': return QChar(0x2091);
+    case u'o': return QChar(0x2092);
+    case u'x': return QChar(0x2093);
+    case u'h': return QChar(0x2095);
+    case u'k': return QChar(0x2096);
+    case u'l': return QChar(0x2097);
+    case u'm': return QChar(0x2098);
+    case u'n': return QChar(0x2099);
+    case u'p': return QChar(0x209A);
+    case u's': return QChar(0x209B);
+    case u't': return QChar(0x209C);
+    case u'i': return QChar(0x1D62);
+    case u'j': return QChar(0x2C7C);
+    case u'r': return QChar(0x1D63);
+    case u'u': return QChar(0x1D64);
+    case u'v': return QChar(0x1D65);
+    default: return QChar();
+    }
+}
+
+// 如果节点只包含普通字符，则收集到 text 中
+bool collectPlainText(const LatexNode &node, QString &text)
+{
+    if (node.type == LatexNode::Text) {
+        text += node.text;
+        return true;
+    }
+    if (node.type != LatexNode::Sequence) {
+        return false;
+    }
+    for (const LatexNode &child : node.children) {
+        if (!collectPlainText(child, text)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+MathRenderer::MathRenderer(QObject *parent)
+    : QObject(parent)
+    , m_cache(2048)
+{
+}
+
+void MathRenderer::setCacheCapacity(int formulas)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.setMaxCost(formulas);
+}
+
+void MathRenderer::clearCache()
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.clear();
+    m_cacheHits = 0;
+    m_cacheMisses = 0;
+}
+
+quint64 MathRenderer::cacheHits() const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return m_cacheHits;
+}
+
+quint64 MathRenderer::cacheMisses() const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return m_cacheMisses;
+}
+
+// 新增：带缓存的公式渲染，未修改的公式直接复用上次的结果
+QString MathRenderer::renderCached(const QString &latex, bool block)
+{
+    const FormulaKey key(latex, block);
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const QString *cached = m_cache.object(key)) {
+            ++m_cacheHits;
+            return *cached;
+        }
+        ++m_cacheMisses;
+    }
+
+    // 渲染本身不持锁，多个线程可以同时渲染不同的公式
+    const QString rendered = block ? renderMathBlock(latex) : renderMathInline(latex);
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.insert(key, new QString(rendered));
+    return rendered;
+}
+
+QList<MathSpan> MathRenderer::tokenize(QStringView text)
+{
+    QList<MathSpan> spans;
+    const qsizetype n = text.size();
+    qsizetype textStart = 0;
+    qsizetype i = 0;
+    QSet<qsizetype> unmatchedTicks;
+
+    auto flushText = [&](qsizetype end) {
+        if (end > textStart) {
+            MathSpan span;
+            span.kind = MathSpan::Text;
+            span.start = textStart;
+            span.length = end - textStart;
+            spans.append(span);
+        }
+    };
+    auto runLength = [&](qsizetype from, QChar c) {
+        qsizetype end = from;
+        while (end < n && text[end] == c) {
+            ++end;
+        }
+        return end - from;
+    };
+    auto lineEnd = [&](qsizetype from) {
+        const qsizetype end = text.indexOf(u'\n', from);
+        return end < 0 ? n : end;
+    };
+
+    while (i < n) {
+        const QChar c = text[i];
+
+        // 行首的代码块 ``` / ~~~：整块跳过，其中的 $ 不是公式
+        if ((c == u'`' || c == u'~') && (i == 0 || text[i - 1] == u'\n')) {
+            const qsizetype fence = runLength(i, c);
+            if (fence >= 3) {
+                qsizetype line = lineEnd(i) + 1;
+                i = n;
+                while (line < n) {
+                    if (runLength(line, c) >= fence) {
+                        i = lineEnd(line);
+                        break;
+                    }
+                    line = lineEnd(line) + 1;
+                }
+                continue;
+            }
+        }
+
+        // 行内代码 `...`：找到长度相同的反引号串才算闭合
+        if (c == u'`') {
+            const qsizetype ticks = runLength(i, c);
+            qsizetype j = i + ticks;
+            qsizetype close = -1;
+            // 某个长度的反引号串向后找不到闭合时，后面同样长度的也不可能闭合，
+            // 记下来避免 "` `` ``` ..." 这样的输入反复扫描到文末
+            if (unmatchedTicks.contains(ticks)) {
+                j = n;
+            }
+            while (j < n) {
+                if (text[j] == u'`') {
+                    const qsizetype run = runLength(j, u'`');
+                    if (run == ticks) {
+                        close = j;
+                        break;
+                    }
+                    j += run;
+                } else {
+                    ++j;
+                }
+            }
+            if (close < 0) {
+                unmatchedTicks.insert(ticks);
+            }
+            i = close < 0 ? i + ticks : close + ticks;
+            continue;
+        }
+
+        // 转义的 \$ 保留给 Markdown 处理
+        if (c == u'\\') {
+            i += 2;
+            continue;
+        }
+
+        if (c != u'$') {
+            ++i;
+            continue;
+        }
+
+        if (i + 1 < n && text[i + 1] == u'$') {
+            // 块级公式 $$...$$，允许跨行
+            const qsizetype close = text.indexOf(u"$$", i + 2);
+            if (close < 0) {
+                // 没有闭合的 $$，按普通文本处理
+                i += 2;
+                continue;
+            }
+            flushText(i);
+            MathSpan span;
+            span.kind = MathSpan::BlockMath;
+            span.start = i;
+            span.length = close + 2 - i;
+            span.contentStart = i + 2;
+            span.contentLength = close - (i + 2);
+            spans.append(span);
+            i = close + 2;
+            textStart = i;
+            continue;
+        }
+
+        // 行内公式 $...$，不跨行。开头的 $ 后面不能是空白，结尾的 $ 前面不能是空白、
+        // 后面不能紧跟数字，这样 "价格 $5 和 $10" 之类的普通文本不会被当成公式
+        qsizetype close = -1;
+        if (i + 1 < n && !text[i + 1].isSpace()) {
+            for (qsizetype j = i + 1; j < n; ++j) {
+                const QChar d = text[j];
+                if (d == u'\n') {
+                    break;
+                }
+                if (d == u'\\') {
+                    ++j;
+                    continue;
+                }
+                if (d == u'$') {
+                    if (!text[j - 1].isSpace() && (j + 1 >= n || !text[j + 1].isDigit())) {
+                        close = j;
+                    }
+                    break;
+                }
+            }
+        }
+        if (close < 0) {
+            ++i;
+            continue;
+        }
+        flushText(i);
+        MathSpan span;
+        span.kind = MathSpan::InlineMath;
+        span.start = i;
+        span.length = close + 1 - i;
+        span.contentStart = i + 1;
+        span.contentLength = close - (i + 1);
+        spans.append(span);
+        i = close + 1;
+        textStart = i;
+    }
+
+    flushText(n);
+    return spans;
+}
+
+bool MathRenderer::hasMath(const QList<MathSpan> &spans)
+{
+    for (const MathSpan &span : spans) {
+        if (span.kind != MathSpan::Text) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 把公式片段替换为渲染结果，普通文本原样保留，一次性拼接到预分配的缓冲区
+QString MathRenderer::substituteMath(const QString &markdownText, const QList<MathSpan> &spans)
+{
+    const QStringView source(markdownText);
+
+    QString result;
+    result.reserve(markdownText.size() * 2);
+
+    for (const MathSpan &span : spans) {
+        switch (span.kind) {
+        case MathSpan::Text:
+            result.append(source.mid(span.start, span.length));
+            break;
+        case MathSpan::BlockMath:
+            result.append(renderCached(source.mid(span.contentStart, span.contentLength).trimmed().toString(), true));
+            break;
+        case MathSpan::InlineMath:
+            result.append(renderCached(source.mid(span.contentStart, span.contentLength).trimmed().toString(), false));
+            break;
+        }
+    }
+    return result;
+}
+
+QString MathRenderer::renderMarkdownWithMath(const QString &markdownText)
+{
+    PERF_SCOPE("MathRenderer::renderMarkdownWithMath");
+    const QList<MathSpan> spans = tokenize(markdownText);
+
+    // 现在将剩余的Markdown文本转换为HTML
+    QTextDocument doc;
+    doc.setMarkdown(hasMath(spans) ? substituteMath(markdownText, spans) : markdownText);
+
+    QString html = doc.toHtml();
+    /* 把样式写进 <head> */
+    html.insert(html.indexOf("<head>") + 6,
+                R"(<style>
+                 body { font-family: "Microsoft YaHei"; font-size: 14pt; color: #333; }
+               </style>)");
+    return html;
+}
+
+// 新增：统一的预览渲染路径。由 MarkdownDocumentBuilder 直接通过 QTextCursor 生成文档，
+// 公式在词法分析时识别（排除代码和 \$），简单公式输出格式化文本，复杂公式插入图片
+QTextDocumentFragment MathRenderer::renderMarkdownFragment(const QString &markdownText)
+{
+    PERF_SCOPE("MathRenderer::renderMarkdownFragment");
+    QTextDocument doc;
+    MarkdownDocumentBuilder builder(&doc, &m_formulaImages);
+    builder.build(markdownText);
+    return QTextDocumentFragment(&doc);
+}
+
+QString MathRenderer::convertLaTeXToUnicode(const QString &latex)
+{
+    // 先解析为语法树，再一遍输出，嵌套的分数、根号和上下标都能正确处理
+    LatexParser parser(latex);
+    const LatexNode root = parser.parse();
+
+    QString result;
+    result.reserve(latex.size() * 2);
+    emitNode(root, result);
+    return result;
+}
+
+void MathRenderer::emitNode(const LatexNode &node, QString &out) const
+{
+    switch (node.type) {
+    case LatexNode::Sequence:
+        for (const LatexNode &child : node.children) {
+            emitNode(child, out);
+        }
+        break;
+
+    case LatexNode::Text:
+        out += node.text.toHtmlEscaped();
+        break;
+
+    case LatexNode::Command: {
+        const QString &name = node.text;
+        if (name.size() == 1 && !name[0].isLetter()) {
+            // 单字符命令：转义字符与间距
+            const QChar c = name[0];
+            if (c == u'\\') {
+                out += QStringLiteral("<br>");
+            } else if (c == u',' || c == u';' || c == u':' || c == u' ' || c == u'>') {
+                out += QChar(u' ');
+            } else if (c != u'!') {
+                out += QString(c).toHtmlEscaped();
+            }
+            break;
+        }
+        // 未知命令保持原样
+        out += QChar(u'\\');
+        out += name;
+        break;
+    }
+
+    case LatexNode::Symbol:
+        out += node.text.toHtmlEscaped();
+        break;
+
+    case LatexNode::Fraction: {
+        QString numerator;
+        QString denominator;
+        emitNode(node.children[0], numerator);
+        emitNode(node.children[1], denominator);
+
+        // 创建分数显示
+        out += QString(
+                   "<span style=\"display: inline-block; text-align: center; vertical-align: middle; margin: 0 0.1em;\">"
+                   "<span style=\"display: block; padding: 0 0.1em; border-bottom: 1px solid; font-size: 0.8em;\">%1/</span>"
+                   "<span style=\"display: block; padding: 0 0.1em; font-size: 0.8em;\">%2</span>"
+                   "</span>"
+                   ).arg(numerator, denominator);
+        break;
+    }
+
+    case LatexNode::SquareRoot: {
+        QString radicand;
+        emitNode(node.children[0], radicand);
+
+        if (node.children.size() > 1) {
+            QString index;
+            emitNode(node.children[1], index);
+
+            // 创建带次数的根号显示
+            out += QString(
+                       "<span style=\"display: inline-block; vertical-align: middle; position: relative;\">"
+                       "<span style=\"position: absolute; top: -0.5em; left: 0.5em; font-size: 0.7em;\">%1</span>"
+                       "<span style=\"border-top: 1px solid; margin-left: 0.8em;\">%2</span>"
+                       "<span style=\"position: absolute; left: 0; top: 0; font-size: 1.2em;\">√</span>"
+                       "</span>"
+                       ).arg(index, radicand);
+        } else {
+            // 创建普通平方根显示
+            out += QString(
+                       "<span style=\"display: inline-block; vertical-align: middle;\">"
+                       "<span style=\"border-top: 1px solid; margin-left: 0.5em;\">%1</span>"
+                       "<span style=\"margin-left: 0.1em; font-size: 1.2em;\">√</span>"
+                       "</span>"
+                       ).arg(radicand);
+        }
+        break;
+    }
+
+    case LatexNode::Scripts:
+        emitNode(node.children[0], out);
+        if (node.hasSubscript) {
+            emitScript(node.children[1], false, out);
+        }
+        if (node.hasSuperscript) {
+            emitScript(node.children[2], true, out);
+        }
+        break;
+
+    case LatexNode::Styled:
+        if (node.text == "b") {
+            out += QStringLiteral("<b>");
+            emitNode(node.children[0], out);
+            out += QStringLiteral("</b>");
+        } else if (node.text == "i") {
+            out += QStringLiteral("<i>");
+            emitNode(node.children[0], out);
+            out += QStringLiteral("</i>");
+        } else {
+            emitNode(node.children[0], out);
+        }
+        break;
+    }
+}
+
+// 上下标：能用 Unicode 字符表示时直接输出（如 x²），否则使用 <sup>/<sub>
+void MathRenderer::emitScript(const LatexNode &node, bool superscript, QString &out) const
+{
+    QString plain;
+    if (collectPlainText(node, plain)) {
+        if (plain.isEmpty()) {
+            return;
+        }
+        QString mapped;
+        mapped.reserve(plain.size());
+        bool allMapped = true;
+        for (QChar c : std::as_const(plain)) {
+            const QChar m = scriptChar(c, superscript);
+            if (m.isNull()) {
+                allMapped = false;
+                break;
+            }
+            mapped += m;
+        }
+        if (allMapped) {
+            out += mapped;
+            return;
+        }
+    }
+
+    out += superscript ? QStringLiteral("<sup>") : QStringLiteral("<sub>");
+    emitNode(node, out);
+    out += superscript ? QStringLiteral("</sup>") : QStringLiteral("</sub>");
+}
+
+QString MathRenderer::renderMathBlock(const QString &latex)
+{
+    QString converted = convertLaTeXToUnicode(latex);
+    return QString("<div style=\"text-align: center; margin: 1em 0; padding: 0.5em; "
+                   "border: 1px solid #ccc; background: #f9f9f9; font-family: 'Microsoft YaHei', '微软雅黑', sans-serif; font-size: 14px; line-height: 1.5;\">"
+                   "%1</div>").arg(converted);
+}
+
+QString MathRenderer::renderMathInline(const QString &latex)
+{
+    QString converted = convertLaTeXToUnicode(latex);
+    return QString("<span style=\"font-family: 'Microsoft YaHei', '微软雅黑', sans-serif !important; "
+                   "background: #f0f0f0 !important; padding: 0.1em 0.3em !important; border-radius: 3px !important; "
+                   "font-size: 14px !important; line-height: 1.5 !important;\">"
+                   "%1</span>").arg(converted);
+}
@@ -1,29 +1,94 @@
-// mathrenderer.h
-#ifndef MATHRENDERER_H
-#define MATHRENDERER_H
-
-#include <QObject>
-#include <QString>
-#include <QMap>
-#include <QTextDocument>
-
-class MathRenderer : public QObject
-{
-    Q_OBJECT
-
-public:
-    explicit MathRenderer(QObject *parent = nullptr);
-    QString renderMarkdownWithMath(const QString &markdownText);
-
-private:
-    void initializeSymbols();
-    QString convertLaTeXToUnicode(const QString &latex);
-    QString processFractions(const QString &latex);  // 新增：处理分数
-    QString processSquareRoots(const QString &latex);  // 新增：处理平方根
-    QString renderMathBlock(const QString &latex);
-    QString renderMathInline(const QString &latex);
-
-    QMap<QString, QString> m_symbols;
-};
-
-#endif // MATHRENDERER_H
+// mathrenderer.h
+#ifndef MATHRENDERER_H
+#define MATHRENDERER_H
+
+#include <QObject>
+#include <QString>
+#include <QTextDocument>
+#include <QTextDocumentFragment>
+#include <QList>
+#include <QStringView>
+#include <QCache>
+#include <QMutex>
+#include <QHashFunctions>
+#include "formulaimages.h"
+
+struct LatexNode;
+
+// 新增：词法分析得到的文档片段（普通文本 / 行内公式 / 块级公式）
+struct MathSpan
+{
+    enum Kind { Text, InlineMath, BlockMath };
+
+    Kind kind = Text;
+    qsizetype start = 0;          // 片段在原文中的起始偏移（含定界符）
+    qsizetype length = 0;         // 片段长度（含定界符）
+    qsizetype contentStart = 0;   // 公式内容的起始偏移（不含 $）
+    qsizetype contentLength = 0;  // 公式内容长度
+};
+
+// 新增：公式缓存的键，哈希值在构造时计算一次
+struct FormulaKey
+{
+    FormulaKey(const QString &latex, bool block)
+        : latex(latex), block(block), hash(qHash(latex, block ? 1u : 0u)) {}
+
+    QString latex;  // 去除首尾空白后的 LaTeX 源码，用于在哈希冲突时比较
+    bool block;     // 块级公式 / 行内公式
+    size_t hash;
+
+    friend bool operator==(const FormulaKey &a, const FormulaKey &b)
+    {
+        return a.hash == b.hash && a.block == b.block && a.latex == b.latex;
+    }
+    friend size_t qHash(const FormulaKey &key, size_t seed = 0) noexcept
+    {
+        return key.hash ^ seed;
+    }
+};
+
+class MathRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MathRenderer(QObject *parent = nullptr);
+    QString renderMarkdownWithMath(const QString &markdownText);
+
+    // 新增：渲染一段 Markdown 为文档片段，只有真正包含公式的部分才走公式渲染
+    QTextDocumentFragment renderMarkdownFragment(const QString &markdownText);
+
+    // 新增：复杂公式的图片缓存
+    FormulaImages *formulaImages() { return &m_formulaImages; }
+
+    // 新增：单遍扫描，把文档切分为文本 / 行内公式 / 块级公式片段；
+    // 代码块、行内代码和转义的 \$ 不会被识别为公式
+    static QList<MathSpan> tokenize(QStringView text);
+    static bool hasMath(const QList<MathSpan> &spans);
+
+    // 新增：公式渲染缓存（LRU），按公式数量计算容量。
+    // 预览在后台线程渲染，缓存由互斥锁保护
+    void setCacheCapacity(int formulas);
+    void clearCache();
+    quint64 cacheHits() const;
+    quint64 cacheMisses() const;
+
+private:
+    QString convertLaTeXToUnicode(const QString &latex);
+    // 新增：遍历 LaTeX 语法树，一次性输出 HTML
+    void emitNode(const LatexNode &node, QString &out) const;
+    void emitScript(const LatexNode &node, bool superscript, QString &out) const;
+    QString renderMathBlock(const QString &latex);
+    QString renderMathInline(const QString &latex);
+    QString renderCached(const QString &latex, bool block);
+    QString substituteMath(const QString &markdownText, const QList<MathSpan> &spans);
+
+    mutable QMutex m_cacheMutex;
+    QCache<FormulaKey, QString> m_cache;
+    quint64 m_cacheHits = 0;
+    quint64 m_cacheMisses = 0;
+
+    FormulaImages m_formulaImages;
+};
+
+#endif // MATHRENDERER_H
@@ -0,0 +1,625 @@
+// notecatalog.cpp
+#include "notecatalog.h"
+#include "perftrace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSet>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+#include <utility>
+
+namespace {
+
+QSqlDatabase openDatabase(const QString &connection, const QString &databasePath)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+    db.setDatabaseName(databasePath);
+    // 后台校验和主线程的更新可能同时写入，等待对方释放写锁
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (!db.open()) {
+        qWarning() << "无法打开笔记目录数据库:" << databasePath << db.lastError().text();
+        return db;
+    }
+    // WAL 模式下读取不会被写入阻塞
+    QSqlQuery(db).exec("PRAGMA journal_mode=WAL");
+    QSqlQuery(db).exec("PRAGMA synchronous=NORMAL");
+    return db;
+}
+
+bool exec(QSqlQuery &query)
+{
+    if (!query.exec()) {
+        qWarning() << "笔记目录数据库查询失败:" << query.lastQuery() << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool exec(const QSqlDatabase &db, const QString &statement)
+{
+    QSqlQuery query(db);
+    if (!query.exec(statement)) {
+        qWarning() << "笔记目录数据库查询失败:" << statement << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// 提取 ATX 标题和链接目标，跳过代码块
+void parseMarkdown(const QString &text, QString *title, QList<NoteCatalog::HeadingRecord> *headings,
+                   QStringList *links)
+{
+    static const QRegularExpression headingPattern("^(#{1,6})\\s+(.*?)\\s*#*\\s*$");
+    static const QRegularExpression linkPattern("!?\\[[^\\]]*\\]\\(\\s*<?([^)\\s>]+)");
+
+    const QStringList lines = text.split('\n');
+    QString fence;
+    for (int i = 0; i < lines.size(); ++i) {
+        const QString line = lines[i].trimmed();
+        if (line.startsWith("```") || line.startsWith("~~~")) {
+            const QString marker = line.left(3);
+            if (fence.isEmpty()) {
+                fence = marker;
+            } else if (fence == marker) {
+                fence.clear();
+            }
+            continue;
+        }
+        if (!fence.isEmpty()) {
+            continue;
+        }
+
+        const QRegularExpressionMatch heading = headingPattern.match(line);
+        if (heading.hasMatch()) {
+            const int level = int(heading.capturedLength(1));
+            const QString headingText = heading.captured(2);
+            NoteCatalog::HeadingRecord record;
+            record.line = i + 1;
+            record.level = level;
+            record.text = headingText;
+            headings->append(record);
+            if (title->isEmpty() && level == 1) {
+                *title = headingText;
+            }
+        }
+        QRegularExpressionMatchIterator it = linkPattern.globalMatch(line);
+        while (it.hasNext()) {
+            links->append(it.next().captured(1));
+        }
+    }
+}
+
+} // namespace
+
+NoteCatalog::NoteCatalog(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<void>(this))
+    , m_updateWatcher(new QFutureWatcher<void>(this))
+{
+    connect(m_watcher, &QFutureWatcherBase::finished, this, &NoteCatalog::onValidated);
+    connect(m_updateWatcher, &QFutureWatcherBase::finished, this, &NoteCatalog::onNoteUpdated);
+}
+
+NoteCatalog::~NoteCatalog()
+{
+    m_cancelled = true;
+    m_watcher->waitForFinished();
+    m_updateWatcher->waitForFinished();
+    if (isOpen()) {
+        QSqlDatabase::database(m_connection, false).close();
+        QSqlDatabase::removeDatabase(m_connection);
+    }
+}
+
+bool NoteCatalog::open(const QString &resourcesPath)
+{
+    PERF_SCOPE("NoteCatalog::open");
+    if (isOpen()) {
+        return true;
+    }
+    m_resourcesPath = resourcesPath;
+    m_databasePath = resourcesPath + "/.catalog.sqlite";
+    const QString connection = QString("notecatalog-%1").arg(quintptr(this), 0, 16);
+    bool ok = false;
+    {
+        QSqlDatabase db = openDatabase(connection, m_databasePath);
+        ok = db.isOpen() && createSchema(connection);
+        if (!ok) {
+            db.close();
+        }
+    }
+    if (!ok) {
+        QSqlDatabase::removeDatabase(connection);
+        return false;
+    }
+    m_connection = connection;
+    return true;
+}
+
+bool NoteCatalog::createSchema(const QString &connection)
+{
+    const QSqlDatabase db = QSqlDatabase::database(connection, false);
+    QSqlQuery version(db);
+    if (version.exec("PRAGMA user_version") && version.next() && version.value(0).toInt() == SchemaVersion) {
+        return true;
+    }
+
+    // 旧版本的目录只是缓存，直接重建
+    const QStringList statements = {
+        "DROP TABLE IF EXISTS folders",
+        "DROP TABLE IF EXISTS files",
+        "DROP TABLE IF EXISTS headings",
+        "DROP TABLE IF EXISTS links",
+        "DROP TABLE IF EXISTS uploads",
+        "CREATE TABLE folders (name TEXT PRIMARY KEY)",
+        "CREATE TABLE files (note TEXT NOT NULL, path TEXT NOT NULL, size INTEGER NOT NULL, "
+        "modified INTEGER NOT NULL, hash BLOB, title TEXT, PRIMARY KEY (note, path))",
+        "CREATE TABLE headings (note TEXT NOT NULL, path TEXT NOT NULL, line INTEGER NOT NULL, "
+        "level INTEGER NOT NULL, text TEXT NOT NULL)",
+        "CREATE INDEX headings_file ON headings (note, path)",
+        "CREATE TABLE links (note TEXT NOT NULL, path TEXT NOT NULL, target TEXT NOT NULL)",
+        "CREATE INDEX links_file ON links (note, path)",
+        "CREATE INDEX links_target ON links (target)",
+        "CREATE TABLE uploads (target TEXT NOT NULL, note TEXT NOT NULL, path TEXT NOT NULL, "
+        "hash BLOB NOT NULL, PRIMARY KEY (target, note, path))",
+        QString("PRAGMA user_version = %1").arg(SchemaVersion),
+    };
+    for (const QString &statement : statements) {
+        if (!exec(db, statement)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 列出笔记目录和它的 assets/，大小或修改时间变化的文件重新计算哈希、提取标题和链接。
+// 只读取数据库，不写入：计算哈希可能很慢，不能占着写锁
+NoteCatalog::NoteScan NoteCatalog::scanNote(const QString &connection, const QString &resourcesPath,
+                                            const QString &noteName)
+{
+    NoteScan scan;
+    scan.note = noteName;
+    const QSqlDatabase db = QSqlDatabase::database(connection, false);
+    const QString notePath = resourcesPath + "/" + noteName;
+
+    QList<QPair<QString, QFileInfo>> onDisk;
+    const QFileInfoList infos = QDir(notePath).entryInfoList(QDir::Files);
+    for (const QFileInfo &info : infos) {
+        onDisk.append({info.fileName(), info});
+    }
+    const QFileInfoList assets = QDir(notePath + "/assets").entryInfoList(QDir::Files);
+    for (const QFileInfo &info : assets) {
+        onDisk.append({"assets/" + info.fileName(), info});
+    }
+
+    QHash<QString, FileRecord> known;
+    QSqlQuery select(db);
+    select.prepare("SELECT path, size, modified, hash, title FROM files WHERE note = ?");
+    select.addBindValue(noteName);
+    if (exec(select)) {
+        while (select.next()) {
+            FileRecord record;
+            record.note = noteName;
+            record.path = select.value(0).toString();
+            record.size = select.value(1).toLongLong();
+            record.modified = select.value(2).toLongLong();
+            record.hash = select.value(3).toByteArray();
+            record.title = select.value(4).toString();
+            known.insert(record.path, record);
+        }
+    }
+
+    for (const auto &[path, info] : std::as_const(onDisk)) {
+        FileRecord record = known.take(path);
+        const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+        if (!record.path.isEmpty() && record.size == info.size() && record.modified == modified) {
+            scan.records.append(record);
+            continue;
+        }
+
+        ParsedFile parsed;
+        record.note = noteName;
+        record.path = path;
+        record.size = info.size();
+        record.modified = modified;
+        record.hash.clear();
+        record.title.clear();
+
+        QFile file(info.absoluteFilePath());
+        if (file.open(QIODevice::ReadOnly)) {
+            const QString suffix = info.suffix().toLower();
+            if (suffix == "md" || suffix == "markdown") {
+                const QByteArray bytes = file.readAll();
+                record.hash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+                parseMarkdown(QString::fromUtf8(bytes), &record.title, &parsed.headings, &parsed.links);
+            } else {
+                // 图片和 PDF 只计算哈希，分块读取
+                QCryptographicHash hash(QCryptographicHash::Sha1);
+                hash.addData(&file);
+                record.hash = hash.result();
+            }
+        }
+        parsed.record = record;
+        scan.changed.append(parsed);
+        scan.records.append(record);
+    }
+
+    // 磁盘上已经不存在的文件
+    scan.removed = known.keys();
+    return scan;
+}
+
+// 把 scanNote() 的结果写入数据库，调用者负责事务
+void NoteCatalog::writeNote(const QString &connection, const NoteScan &scan)
+{
+    const QSqlDatabase db = QSqlDatabase::database(connection, false);
+    const QString &noteName = scan.note;
+
+    for (const ParsedFile &parsed : scan.changed) {
+        const FileRecord &record = parsed.record;
+        QSqlQuery upsert(db);
+        upsert.prepare("INSERT OR REPLACE INTO files (note, path, size, modified, hash, title) "
+                       "VALUES (?, ?, ?, ?, ?, ?)");
+        upsert.addBindValue(noteName);
+        upsert.addBindValue(record.path);
+        upsert.addBindValue(record.size);
+        upsert.addBindValue(record.modified);
+        upsert.addBindValue(record.hash);
+        upsert.addBindValue(record.title);
+        exec(upsert);
+
+        for (const QString &table : {QStringLiteral("headings"), QStringLiteral("links")}) {
+            QSqlQuery clear(db);
+            clear.prepare("DELETE FROM " + table + " WHERE note = ? AND path = ?");
+            clear.addBindValue(noteName);
+            clear.addBindValue(record.path);
+            exec(clear);
+        }
+        for (const HeadingRecord &heading : parsed.headings) {
+            QSqlQuery insert(db);
+            insert.prepare("INSERT INTO headings (note, path, line, level, text) VALUES (?, ?, ?, ?, ?)");
+            insert.addBindValue(noteName);
+            insert.addBindValue(record.path);
+            insert.addBindValue(heading.line);
+            insert.addBindValue(heading.level);
+            insert.addBindValue(heading.text);
+            exec(insert);
+        }
+        for (const QString &target : parsed.links) {
+            QSqlQuery insert(db);
+            insert.prepare("INSERT INTO links (note, path, target) VALUES (?, ?, ?)");
+            insert.addBindValue(noteName);
+            insert.addBindValue(record.path);
+            insert.addBindValue(target);
+            exec(insert);
+        }
+    }
+
+    for (const QString &path : scan.removed) {
+        for (const QString &table : {QStringLiteral("files"), QStringLiteral("headings"), QStringLiteral("links")}) {
+            QSqlQuery remove(db);
+            remove.prepare("DELETE FROM " + table + " WHERE note = ? AND path = ?");
+            remove.addBindValue(noteName);
+            remove.addBindValue(path);
+            exec(remove);
+        }
+    }
+
+    QSqlQuery folder(db);
+    folder.prepare("INSERT OR IGNORE INTO folders (name) VALUES (?)");
+    folder.addBindValue(noteName);
+    exec(folder);
+}
+
+void NoteCatalog::deleteNote(const QString &connection, const QString &noteName)
+{
+    const QSqlDatabase db = QSqlDatabase::database(connection, false);
+    for (const QString &table : {QStringLiteral("files"), QStringLiteral("headings"), QStringLiteral("links")}) {
+        QSqlQuery remove(db);
+        remove.prepare("DELETE FROM " + table + " WHERE note = ?");
+        remove.addBindValue(noteName);
+        exec(remove);
+    }
+    QSqlQuery folder(db);
+    folder.prepare("DELETE FROM folders WHERE name = ?");
+    folder.addBindValue(noteName);
+    exec(folder);
+}
+
+// 后台线程：使用自己的数据库连接。哈希在事务之外计算，
+// 有变化的笔记攒够 CommitInterval 毫秒后在一个短事务中写入，主线程的更新最多等待一次写入
+void NoteCatalog::runValidation(const QString &databasePath, const QString &resourcesPath,
+                                const std::atomic<bool> *cancelled)
+{
+    PERF_SCOPE("NoteCatalog::validate");
+    const QString connection = QString("notecatalog-validate-%1").arg(quintptr(QThread::currentThreadId()), 0, 16);
+    {
+        QSqlDatabase db = openDatabase(connection, databasePath);
+        if (db.isOpen()) {
+            QSet<QString> known;
+            QSqlQuery folders(db);
+            if (folders.exec("SELECT name FROM folders")) {
+                while (folders.next()) {
+                    known.insert(folders.value(0).toString());
+                }
+            }
+
+            const QStringList names = QDir(resourcesPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Unsorted);
+            QSet<QString> removed = known;
+            for (const QString &noteName : names) {
+                removed.remove(noteName);
+            }
+            db.transaction();
+            for (const QString &noteName : std::as_const(removed)) {
+                deleteNote(connection, noteName);
+            }
+            db.commit();
+
+            QList<NoteScan> pending;
+            QElapsedTimer batch;
+            auto flush = [&]() {
+                if (pending.isEmpty()) {
+                    return;
+                }
+                db.transaction();
+                for (const NoteScan &scan : std::as_const(pending)) {
+                    writeNote(connection, scan);
+                }
+                db.commit();
+                pending.clear();
+            };
+
+            int scanned = 0;
+            for (const QString &noteName : names) {
+                if (cancelled->load()) {
+                    break;
+                }
+                NoteScan scan = scanNote(connection, resourcesPath, noteName);
+                ++scanned;
+                if (scan.changed.isEmpty() && scan.removed.isEmpty() && known.contains(noteName)) {
+                    continue;
+                }
+                if (pending.isEmpty()) {
+                    batch.start();
+                }
+                pending.append(std::move(scan));
+                if (batch.elapsed() >= CommitInterval) {
+                    flush();
+                }
+            }
+            flush();
+            qDebug() << "笔记目录校验完成:" << scanned << "篇笔记";
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection);
+}
+
+void NoteCatalog::validate()
+{
+    if (!isOpen()) {
+        return;
+    }
+    if (m_watcher->isRunning()) {
+        // 正在进行的这一遍可能已经错过了刚才的修改
+        m_revalidate = true;
+        return;
+    }
+    m_cancelled = false;
+    m_watcher->setFuture(QtConcurrent::run(&NoteCatalog::runValidation, m_databasePath, m_resourcesPath,
+                                           &m_cancelled));
+}
+
+void NoteCatalog::onValidated()
+{
+    if (m_cancelled) {
+        return;
+    }
+    m_valid = true;
+    if (m_revalidate) {
+        m_revalidate = false;
+        validate();
+        return;
+    }
+    emit validated();
+}
+
+// 后台线程：使用自己的数据库连接，哈希在事务之外计算，只有写入在事务中
+void NoteCatalog::runUpdate(const QString &databasePath, const QString &resourcesPath, const QString &noteName)
+{
+    PERF_SCOPE("NoteCatalog::updateNote");
+    const QString connection = QString("notecatalog-update-%1").arg(quintptr(QThread::currentThreadId()), 0, 16);
+    {
+        QSqlDatabase db = openDatabase(connection, databasePath);
+        if (db.isOpen()) {
+            const NoteScan scan = scanNote(connection, resourcesPath, noteName);
+            db.transaction();
+            writeNote(connection, scan);
+            db.commit();
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection);
+}
+
+void NoteCatalog::updateNote(const QString &noteName)
+{
+    if (!isOpen() || m_pendingUpdates.contains(noteName)) {
+        return;
+    }
+    m_pendingUpdates.append(noteName);
+    if (!m_updateWatcher->isRunning()) {
+        startNextUpdate();
+    }
+}
+
+void NoteCatalog::startNextUpdate()
+{
+    if (m_pendingUpdates.isEmpty()) {
+        return;
+    }
+    m_updatingNote = m_pendingUpdates.takeFirst();
+    m_removeUpdated = false;
+    m_updateWatcher->setFuture(QtConcurrent::run(&NoteCatalog::runUpdate, m_databasePath, m_resourcesPath,
+                                                 m_updatingNote));
+}
+
+void NoteCatalog::onNoteUpdated()
+{
+    const QString noteName = std::exchange(m_updatingNote, QString());
+    if (m_cancelled) {
+        return;
+    }
+    if (m_removeUpdated) {
+        // 更新期间目录被删除，后台写入的记录已经过时
+        m_removeUpdated = false;
+        removeNote(noteName);
+    } else {
+        emit noteUpdated(noteName);
+    }
+    startNextUpdate();
+}
+
+void NoteCatalog::removeNote(const QString &noteName)
+{
+    if (!isOpen()) {
+        return;
+    }
+    m_pendingUpdates.removeAll(noteName);
+    if (noteName == m_updatingNote) {
+        m_removeUpdated = true;
+    }
+    QSqlDatabase db = QSqlDatabase::database(m_connection, false);
+    db.transaction();
+    deleteNote(m_connection, noteName);
+    db.commit();
+}
+
+QList<NoteCatalog::FileRecord> NoteCatalog::selectFiles(const QString &connection, const QString &where,
+                                                        const QString &value)
+{
+    QList<FileRecord> records;
+    QSqlQuery query(QSqlDatabase::database(connection, false));
+    query.setForwardOnly(true);
+    query.prepare("SELECT note, path, size, modified, hash, title FROM files " + where);
+    if (!value.isNull()) {
+        query.addBindValue(value);
+    }
+    if (!exec(query)) {
+        return records;
+    }
+    while (query.next()) {
+        FileRecord record;
+        record.note = query.value(0).toString();
+        record.path = query.value(1).toString();
+        record.size = query.value(2).toLongLong();
+        record.modified = query.value(3).toLongLong();
+        record.hash = query.value(4).toByteArray();
+        record.title = query.value(5).toString();
+        records.append(record);
+    }
+    return records;
+}
+
+QList<NoteCatalog::FileRecord> NoteCatalog::files(const QString &noteName) const
+{
+    if (!isOpen()) {
+        return QList<FileRecord>();
+    }
+    return selectFiles(m_connection, "WHERE note = ?", noteName);
+}
+
+QList<NoteCatalog::FileRecord> NoteCatalog::allFiles() const
+{
+    if (!isOpen()) {
+        return QList<FileRecord>();
+    }
+    return selectFiles(m_connection, QString(), QString());
+}
+
+QHash<QString, NoteCatalog::FileRecord> NoteCatalog::mainFiles() const
+{
+    QHash<QString, FileRecord> result;
+    if (!isOpen()) {
+        return result;
+    }
+    const QList<FileRecord> records = selectFiles(m_connection, "WHERE path = note || '.md'", QString());
+    for (const FileRecord &record : records) {
+        result.insert(record.note, record);
+    }
+    return result;
+}
+
+bool NoteCatalog::readListing(const QString &databasePath, QList<FileRecord> *files,
+                              QList<HeadingRecord> *headings)
+{
+    PERF_SCOPE("NoteCatalog::readListing");
+    const QString connection = QString("notecatalog-read-%1").arg(quintptr(QThread::currentThreadId()), 0, 16);
+    bool ok = false;
+    {
+        QSqlDatabase db = openDatabase(connection, databasePath);
+        if (db.isOpen()) {
+            *files = selectFiles(connection, QString(), QString());
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            ok = query.exec("SELECT note, path, line, level, text FROM headings");
+            if (!ok) {
+                qWarning() << "笔记目录数据库查询失败:" << query.lastError().text();
+            }
+            while (ok && query.next()) {
+                HeadingRecord record;
+                record.note = query.value(0).toString();
+                record.path = query.value(1).toString();
+                record.line = query.value(2).toInt();
+                record.level = query.value(3).toInt();
+                record.text = query.value(4).toString();
+                headings->append(record);
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection);
+    return ok;
+}
+
+QHash<QString, QByteArray> NoteCatalog::uploadedHashes(const QString &target) const
+{
+    QHash<QString, QByteArray> hashes;
+    if (!isOpen()) {
+        return hashes;
+    }
+    QSqlQuery query(QSqlDatabase::database(m_connection, false));
+    query.setForwardOnly(true);
+    query.prepare("SELECT note, path, hash FROM uploads WHERE target = ?");
+    query.addBindValue(target);
+    if (exec(query)) {
+        while (query.next()) {
+            hashes.insert(query.value(0).toString() + "/" + query.value(1).toString(), query.value(2).toByteArray());
+        }
+    }
+    return hashes;
+}
+
+void NoteCatalog::setUploaded(const QString &target, const QString &note, const QString &path, const QByteArray &hash)
+{
+    if (!isOpen()) {
+        return;
+    }
+    QSqlQuery query(QSqlDatabase::database(m_connection, false));
+    query.prepare("INSERT OR REPLACE INTO uploads (target, note, path, hash) VALUES (?, ?, ?, ?)");
+    query.addBindValue(target);
+    query.addBindValue(note);
+    query.addBindValue(path);
+    query.addBindValue(hash);
+    exec(query);
+}
@@ -0,0 +1,126 @@
+// notecatalog.h
+#ifndef NOTECATALOG_H
+#define NOTECATALOG_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <atomic>
+
+// 笔记库的元数据目录，保存在 resources/.catalog.sqlite（SQLite）。
+// 记录每个笔记目录（含 assets/）中的文件、大小、修改时间、内容的 SHA-1，
+// 以及 Markdown 文档的标题、各级标题和链接；另外记录每个文件最近一次上传到同步服务器时的内容哈希。
+// 启动时在后台按修改时间和大小校验一遍，只重新读取变化的文件；
+// 之后由 NoteLibrary 在笔记目录变化时在后台更新对应的笔记，同步前再校验一遍。
+// 列出文档、按修改时间排序和同步计划都读这里，不再逐个扫描目录
+class NoteCatalog : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct FileRecord
+    {
+        QString note;     // 笔记名称（目录名）
+        QString path;     // 相对笔记目录的路径，例如 a.md 或 assets/b.png
+        qint64 size = 0;
+        qint64 modified = 0;  // 毫秒时间戳
+        QByteArray hash;  // SHA-1
+        QString title;    // Markdown 文档的第一个一级标题
+    };
+
+    struct HeadingRecord
+    {
+        QString note;
+        QString path;
+        int line = 0;     // 从 1 开始
+        int level = 0;
+        QString text;
+    };
+
+    explicit NoteCatalog(QObject *parent = nullptr);
+    ~NoteCatalog();
+
+    // 数据库结构版本，不一致时重建
+    static constexpr int SchemaVersion = 1;
+    // 校验时有变化的笔记攒够这么长时间（毫秒）后一起写入，写入事务本身很短
+    static constexpr int CommitInterval = 50;
+
+    // 打开（必要时创建）resourcesPath 下的目录数据库
+    bool open(const QString &resourcesPath);
+    bool isOpen() const { return !m_connection.isEmpty(); }
+
+    // 在后台校验整个笔记库，完成后发出 validated()。正在校验时，这一遍结束后再校验一遍
+    void validate();
+    // 至少完成过一次校验，查询结果与磁盘一致
+    bool isValid() const { return m_valid; }
+
+    // 在后台重新读取一个笔记目录中变化的文件并写入，完成后发出 noteUpdated()。
+    // 同一时间只更新一篇笔记，其余的按请求顺序排队，已经在排队的笔记不重复加入
+    void updateNote(const QString &noteName);
+    void removeNote(const QString &noteName);
+
+    QList<FileRecord> files(const QString &noteName) const;
+    QList<FileRecord> allFiles() const;
+    // 每篇笔记的正文 <笔记>/<笔记>.md 的记录，按笔记名称索引
+    QHash<QString, FileRecord> mainFiles() const;
+    // 在任意线程读取所有文件和 Markdown 标题，使用单独的连接（例如后台生成快速打开的候选）
+    static bool readListing(const QString &databasePath, QList<FileRecord> *files, QList<HeadingRecord> *headings);
+    QString databasePath() const { return m_databasePath; }
+
+    // 同步：target 是服务器地址和远程目录，键是 <笔记>/<路径>
+    QHash<QString, QByteArray> uploadedHashes(const QString &target) const;
+    void setUploaded(const QString &target, const QString &note, const QString &path, const QByteArray &hash);
+
+signals:
+    void validated();
+    void noteUpdated(const QString &noteName);
+
+private slots:
+    void onValidated();
+    void onNoteUpdated();
+
+private:
+    struct ParsedFile
+    {
+        FileRecord record;
+        QList<HeadingRecord> headings;
+        QStringList links;
+    };
+
+    // 一个笔记目录与数据库比较的结果
+    struct NoteScan
+    {
+        QString note;
+        QList<FileRecord> records;  // 目录中当前的全部文件
+        QList<ParsedFile> changed;  // 新增或修改的文件
+        QStringList removed;        // 已经不存在的文件
+    };
+
+    static bool createSchema(const QString &connection);
+    static NoteScan scanNote(const QString &connection, const QString &resourcesPath, const QString &noteName);
+    static void writeNote(const QString &connection, const NoteScan &scan);
+    static void deleteNote(const QString &connection, const QString &noteName);
+    static void runValidation(const QString &databasePath, const QString &resourcesPath,
+                              const std::atomic<bool> *cancelled);
+    static void runUpdate(const QString &databasePath, const QString &resourcesPath, const QString &noteName);
+    void startNextUpdate();
+    static QList<FileRecord> selectFiles(const QString &connection, const QString &where, const QString &value);
+
+    QString m_resourcesPath;
+    QString m_databasePath;
+    QString m_connection;  // 主线程使用的连接名
+    QFutureWatcher<void> *m_watcher;
+    std::atomic<bool> m_cancelled{false};
+    bool m_valid = false;
+    bool m_revalidate = false;  // 校验期间又请求了校验
+    QFutureWatcher<void> *m_updateWatcher;
+    QStringList m_pendingUpdates;  // 等待更新的笔记
+    QString m_updatingNote;        // 正在后台更新的笔记
+    bool m_removeUpdated = false;  // 更新期间笔记被删除，完成后再删除一次
+};
+
+#endif // NOTECATALOG_H
@@ -0,0 +1,680 @@
+// noteindex.cpp
+#include "noteindex.h"
+#include "perftrace.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr quint32 IndexMagic = 0x4D4E4958;  // "MNIX"
+constexpr quint32 IndexVersion = 1;
+
+// BM25 参数
+constexpr double K1 = 1.2;
+constexpr double B = 0.75;
+
+enum CharClass { Separator, WordChar, CjkChar, TibetanChar };
+
+CharClass classify(char32_t c)
+{
+    if (c >= 0x0F00 && c <= 0x0FFF) {
+        // 藏文字母、元音符号、下加字、数字和附加符号属于音节；音节点（་ ༌）、分句符（། ༎ …）等标点是分隔符
+        if ((c >= 0x0F40 && c <= 0x0FBC) || (c >= 0x0F20 && c <= 0x0F33) || c == 0x0F00
+            || c == 0x0F35 || c == 0x0F37 || c == 0x0F39 || c == 0x0F3E || c == 0x0F3F) {
+            return TibetanChar;
+        }
+        return Separator;
+    }
+    // 汉字（含扩展区和兼容区）、平假名、片假名、韩文音节
+    if ((c >= 0x4E00 && c <= 0x9FFF) || (c >= 0x3400 && c <= 0x4DBF) || (c >= 0xF900 && c <= 0xFAFF)
+        || (c >= 0x20000 && c <= 0x2FFFF) || (c >= 0x3040 && c <= 0x30FF) || (c >= 0xAC00 && c <= 0xD7AF)) {
+        return CjkChar;
+    }
+    if (QChar::isLetterOrNumber(c) || QChar::isMark(c)) {
+        return WordChar;
+    }
+    return Separator;
+}
+
+} // namespace
+
+NoteIndex::NoteIndex(QObject *parent)
+    : QObject(parent)
+    , m_data(std::make_shared<const Data>())
+    , m_openWatcher(new QFutureWatcher<Data>(this))
+    , m_updateWatcher(new QFutureWatcher<Batch>(this))
+    , m_saveWatcher(new QFutureWatcher<bool>(this))
+    , m_searchWatcher(new QFutureWatcher<SearchResult>(this))
+{
+    connect(m_openWatcher, &QFutureWatcherBase::finished, this, &NoteIndex::onOpened);
+    connect(m_updateWatcher, &QFutureWatcherBase::finished, this, &NoteIndex::onUpdated);
+    connect(m_searchWatcher, &QFutureWatcherBase::finished, this, &NoteIndex::onSearched);
+    // 后台保存失败时留到下一次（或退出时）再写
+    connect(m_saveWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        if (!m_saveWatcher->result()) {
+            m_dirty = true;
+        }
+        if (m_saveAgain) {
+            m_saveAgain = false;
+            startSave();
+        }
+    });
+}
+
+NoteIndex::~NoteIndex()
+{
+    m_searchWatcher->waitForFinished();
+    save();
+}
+
+QList<NoteIndex::Token> NoteIndex::tokenize(QStringView text, bool query)
+{
+    QList<Token> tokens;
+    QString word;
+    QStringList cjk;  // 当前连续的中日韩字符（代理对算一个字符）
+    CharClass run = Separator;
+
+    auto flush = [&]() {
+        if (run == WordChar || run == TibetanChar) {
+            if (!word.isEmpty() && word.size() <= MaxTermLength) {
+                if (run == WordChar) {
+                    tokens.append({word.toLower(), Token::Word});
+                } else {
+                    tokens.append({word, Token::Tibetan});
+                }
+            }
+        } else if (run == CjkChar) {
+            const bool bigramsOnly = query && cjk.size() > 1;
+            for (qsizetype i = 0; i < cjk.size(); ++i) {
+                if (!bigramsOnly) {
+                    tokens.append({cjk[i], Token::Cjk});
+                }
+                if (i + 1 < cjk.size()) {
+                    tokens.append({cjk[i] + cjk[i + 1], Token::Cjk});
+                }
+            }
+        }
+        word.clear();
+        cjk.clear();
+    };
+
+    const qsizetype n = text.size();
+    qsizetype i = 0;
+    while (i < n) {
+        char32_t c = text[i].unicode();
+        qsizetype length = 1;
+        if (text[i].isHighSurrogate() && i + 1 < n && text[i + 1].isLowSurrogate()) {
+            c = QChar::surrogateToUcs4(text[i], text[i + 1]);
+            length = 2;
+        }
+
+        const CharClass cls = classify(c);
+        if (cls != run) {
+            flush();
+            run = cls;
+        }
+        if (cls == CjkChar) {
+            cjk.append(text.mid(i, length).toString());
+        } else if (cls != Separator) {
+            word.append(text.mid(i, length));
+        }
+        i += length;
+    }
+    flush();
+    return tokens;
+}
+
+NoteIndex::TermCounts NoteIndex::countTerms(QStringView text)
+{
+    TermCounts counts;
+    const QList<Token> tokens = tokenize(text);
+    for (const Token &token : tokens) {
+        ++counts[token.term];
+    }
+    return counts;
+}
+
+NoteIndex::Update NoteIndex::readFile(const QString &filePath)
+{
+    Update update;
+    const QFileInfo info(filePath);
+    update.filePath = info.absoluteFilePath();
+    update.modified = info.lastModified().toMSecsSinceEpoch();
+    update.size = info.size();
+
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        update.counts = countTerms(QString::fromUtf8(file.readAll()));
+    }
+    return update;
+}
+
+void NoteIndex::Data::add(const QString &filePath, qint64 modified, qint64 size, const TermCounts &counts)
+{
+    remove(filePath);
+
+    Document document;
+    document.filePath = filePath;
+    document.modified = modified;
+    document.size = size;
+    const quint32 id = quint32(documents.size());
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        postings[it.key()].append({id, it.value()});
+        document.length += it.value();
+    }
+    documents.append(document);
+    documentIds.insert(filePath, id);
+    totalLength += document.length;
+    ++aliveCount;
+}
+
+// 只做标记，倒排表中的旧条目在搜索时跳过，整理（compact）时清理
+void NoteIndex::Data::remove(const QString &filePath)
+{
+    const auto it = documentIds.constFind(filePath);
+    if (it == documentIds.cend()) {
+        return;
+    }
+    Document &document = documents[it.value()];
+    document.removed = true;
+    totalLength -= document.length;
+    --aliveCount;
+    ++removedCount;
+    documentIds.erase(it);
+}
+
+void NoteIndex::Data::compact()
+{
+    if (removedCount == 0) {
+        return;
+    }
+    PERF_SCOPE("NoteIndex::compact");
+
+    QList<quint32> remap(documents.size(), 0);
+    QList<Document> kept;
+    kept.reserve(aliveCount);
+    documentIds.clear();
+    for (qsizetype i = 0; i < documents.size(); ++i) {
+        if (!documents[i].removed) {
+            remap[i] = quint32(kept.size());
+            documentIds.insert(documents[i].filePath, quint32(kept.size()));
+            kept.append(documents[i]);
+        }
+    }
+
+    for (auto it = postings.begin(); it != postings.end();) {
+        QList<Posting> &list = it.value();
+        QList<Posting> alive;
+        alive.reserve(list.size());
+        for (const Posting &posting : std::as_const(list)) {
+            if (!documents[posting.document].removed) {
+                alive.append({remap[posting.document], posting.count});
+            }
+        }
+        if (alive.isEmpty()) {
+            it = postings.erase(it);
+        } else {
+            list = std::move(alive);
+            ++it;
+        }
+    }
+
+    documents = std::move(kept);
+    removedCount = 0;
+}
+
+bool NoteIndex::Data::load(const QString &indexFile)
+{
+    QFile file(indexFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 documentCount = 0;
+    in >> magic >> version >> documentCount;
+    if (in.status() != QDataStream::Ok || magic != IndexMagic || version != IndexVersion) {
+        return false;
+    }
+
+    Data data;
+    data.documents.reserve(qMin<quint32>(documentCount, 1u << 20));
+    for (quint32 i = 0; i < documentCount && in.status() == QDataStream::Ok; ++i) {
+        Document document;
+        in >> document.filePath >> document.modified >> document.size >> document.length;
+        data.documentIds.insert(document.filePath, i);
+        data.totalLength += document.length;
+        data.documents.append(document);
+    }
+    data.aliveCount = int(data.documents.size());
+
+    quint32 termCount = 0;
+    in >> termCount;
+    for (quint32 t = 0; t < termCount && in.status() == QDataStream::Ok; ++t) {
+        QString term;
+        quint32 postingCount = 0;
+        in >> term >> postingCount;
+        QList<Posting> list;
+        list.reserve(qMin<quint32>(postingCount, documentCount));
+        for (quint32 p = 0; p < postingCount && in.status() == QDataStream::Ok; ++p) {
+            Posting posting;
+            in >> posting.document >> posting.count;
+            if (posting.document >= documentCount) {
+                return false;
+            }
+            list.append(posting);
+        }
+        data.postings.insert(term, list);
+    }
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    *this = std::move(data);
+    return true;
+}
+
+// 调用前需要 compact()，文档下标连续
+bool NoteIndex::Data::save(const QString &indexFile) const
+{
+    PERF_SCOPE("NoteIndex::save");
+    QDir().mkpath(QFileInfo(indexFile).absolutePath());
+    QSaveFile file(indexFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入搜索索引:" << indexFile << file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << IndexMagic << IndexVersion << quint32(documents.size());
+    for (const Document &document : documents) {
+        out << document.filePath << document.modified << document.size << document.length;
+    }
+    out << quint32(postings.size());
+    for (auto it = postings.cbegin(); it != postings.cend(); ++it) {
+        out << it.key() << quint32(it.value().size());
+        for (const Posting &posting : it.value()) {
+            out << posting.document << posting.count;
+        }
+    }
+    return file.commit();
+}
+
+// 后台线程：加载磁盘上的索引，只重新索引新增或修改过的笔记
+NoteIndex::Data NoteIndex::build(const QString &indexFile, const QString &resourcesPath)
+{
+    PERF_SCOPE("NoteIndex::build");
+    Data data;
+    if (!data.load(indexFile)) {
+        data = Data();
+    }
+
+    QHash<QString, QFileInfo> files;
+    QDirIterator it(resourcesPath, {"*.md", "*.markdown"}, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        files.insert(info.absoluteFilePath(), info);
+    }
+
+    const QStringList indexed = data.documentIds.keys();
+    for (const QString &filePath : indexed) {
+        if (!files.contains(filePath)) {
+            data.remove(filePath);
+        }
+    }
+
+    QStringList changed;
+    for (auto file = files.cbegin(); file != files.cend(); ++file) {
+        const auto id = data.documentIds.constFind(file.key());
+        if (id == data.documentIds.cend()
+            || data.documents[id.value()].modified != file.value().lastModified().toMSecsSinceEpoch()
+            || data.documents[id.value()].size != file.value().size()) {
+            changed.append(file.key());
+        }
+    }
+
+    // 分词是主要开销，并行处理；合并到索引按顺序进行
+    const QList<Update> updates = QtConcurrent::blockingMapped<QList<Update>>(changed, &NoteIndex::readFile);
+    for (const Update &update : updates) {
+        data.add(update.filePath, update.modified, update.size, update.counts);
+    }
+
+    if (!changed.isEmpty() || data.removedCount > 0) {
+        data.compact();
+        data.save(indexFile);
+    }
+    qDebug() << "搜索索引:" << data.aliveCount << "篇笔记，重新索引" << changed.size() << "篇";
+    return data;
+}
+
+void NoteIndex::open(const QString &indexFile, const QString &resourcesPath)
+{
+    m_indexFile = indexFile;
+    m_ready = false;
+    m_openWatcher->setFuture(QtConcurrent::run([indexFile, resourcesPath]() {
+        return build(indexFile, resourcesPath);
+    }));
+}
+
+void NoteIndex::onOpened()
+{
+    if (m_ready || m_indexFile.isEmpty() || !m_openWatcher->isFinished()) {
+        return;
+    }
+    m_data = std::make_shared<const Data>(m_openWatcher->result());
+    m_ready = true;
+    startNextUpdate();
+    emit ready();
+}
+
+void NoteIndex::updateFile(const QString &filePath, const DocumentSnapshot &snapshot)
+{
+    m_queue.append({QFileInfo(filePath).absoluteFilePath(), Pending::Snapshot, snapshot});
+    startNextUpdate();
+}
+
+void NoteIndex::removeFile(const QString &filePath)
+{
+    m_queue.append({QFileInfo(filePath).absoluteFilePath(), Pending::Remove, DocumentSnapshot()});
+    startNextUpdate();
+}
+
+void NoteIndex::refreshFile(const QString &filePath)
+{
+    m_queue.append({QFileInfo(filePath).absoluteFilePath(), Pending::Reload, DocumentSnapshot()});
+    startNextUpdate();
+}
+
+void NoteIndex::startNextUpdate()
+{
+    if (!m_ready || m_updating || m_queue.isEmpty()) {
+        return;
+    }
+    // 排队的修改一起交给后台，在当前索引的基础上生成新的索引
+    const QList<Pending> pending = std::exchange(m_queue, QList<Pending>());
+    const DataPtr base = m_data;
+    m_updating = true;
+    m_updateWatcher->setFuture(QtConcurrent::run([base, pending]() {
+        return applyUpdates(base, pending);
+    }));
+}
+
+// 后台线程：复制索引（第一次修改时才真正复制）并依次应用修改。
+// 每次保存都会留下一个标记为删除的旧文档，累积得多了就整理，由主线程在后台写回磁盘，
+// 程序异常退出时不会丢掉这段时间的索引
+NoteIndex::Batch NoteIndex::applyUpdates(const DataPtr &base, const QList<Pending> &pending)
+{
+    PERF_SCOPE("NoteIndex::update");
+    Data data = *base;
+    for (const Pending &item : pending) {
+        const QString &filePath = item.filePath;
+        if (item.action == Pending::Remove) {
+            data.remove(filePath);
+            continue;
+        }
+
+        if (item.action == Pending::Reload) {
+            const QFileInfo info(filePath);
+            if (!info.exists()) {
+                data.remove(filePath);
+                continue;
+            }
+            // 程序自己保存的文件已经按快照更新过
+            const auto id = data.documentIds.constFind(filePath);
+            if (id != data.documentIds.cend()
+                && data.documents[id.value()].modified == info.lastModified().toMSecsSinceEpoch()
+                && data.documents[id.value()].size == info.size()) {
+                continue;
+            }
+            const Update update = readFile(filePath);
+            data.add(update.filePath, update.modified, update.size, update.counts);
+            continue;
+        }
+
+        const QFileInfo info(filePath);
+        data.add(filePath, info.lastModified().toMSecsSinceEpoch(), info.size(), countTerms(item.snapshot.text()));
+    }
+
+    Batch batch;
+    if (data.removedCount >= data.aliveCount / CompactRatio + CompactSlack) {
+        data.compact();
+        batch.compacted = true;
+    }
+    batch.data = std::make_shared<const Data>(std::move(data));
+    return batch;
+}
+
+void NoteIndex::startSave()
+{
+    if (m_saveWatcher->isRunning()) {
+        m_saveAgain = true;
+        return;
+    }
+    const DataPtr data = m_data;
+    const QString indexFile = m_indexFile;
+    m_dirty = false;
+    m_saveWatcher->setFuture(QtConcurrent::run([data, indexFile]() {
+        return data->save(indexFile);
+    }));
+}
+
+void NoteIndex::onUpdated()
+{
+    if (!m_updating) {
+        return;
+    }
+    m_updating = false;
+    const Batch batch = m_updateWatcher->result();
+    m_data = batch.data;
+    m_dirty = true;
+    if (batch.compacted) {
+        startSave();
+    }
+    startNextUpdate();
+}
+
+void NoteIndex::startSearch(const QString &query, int limit)
+{
+    if (!m_ready) {
+        return;
+    }
+    if (m_searchWatcher->isRunning()) {
+        m_pendingQuery = query;
+        m_pendingLimit = limit;
+        m_hasPendingSearch = true;
+        return;
+    }
+    launchSearch(query, limit);
+}
+
+void NoteIndex::launchSearch(const QString &query, int limit)
+{
+    // 搜索期间完成的更新替换的是 m_data 指针，不影响这里持有的索引
+    const DataPtr data = m_data;
+    m_searchWatcher->setFuture(QtConcurrent::run([data, query, limit]() {
+        SearchResult result;
+        result.query = query;
+        result.hits = search(*data, query, limit);
+        for (Hit &hit : result.hits) {
+            hit.snippet = snippet(hit.filePath, query);
+        }
+        return result;
+    }));
+}
+
+void NoteIndex::onSearched()
+{
+    // 搜索期间又输入了新的查询时，这次的结果已经过时
+    if (m_hasPendingSearch) {
+        m_hasPendingSearch = false;
+        launchSearch(m_pendingQuery, m_pendingLimit);
+        return;
+    }
+    const SearchResult result = m_searchWatcher->result();
+    emit searchFinished(result.query, result.hits);
+}
+
+QList<NoteIndex::Hit> NoteIndex::search(const Data &data, const QString &query, int limit)
+{
+    PERF_SCOPE("NoteIndex::search");
+    QList<Hit> hits;
+    if (data.aliveCount == 0) {
+        return hits;
+    }
+
+    QList<Token> tokens = tokenize(query, true);
+    // 去掉重复的词
+    QStringList seen;
+    tokens.removeIf([&seen](const Token &token) {
+        if (seen.contains(token.term)) {
+            return true;
+        }
+        seen.append(token.term);
+        return false;
+    });
+    if (tokens.isEmpty()) {
+        return hits;
+    }
+
+    const double documentCount = data.aliveCount;
+    const double averageLength = qMax(1.0, double(data.totalLength) / documentCount);
+
+    auto scorePostings = [&](const QList<Posting> &list, QHash<quint32, double> &scores) {
+        // 文档频率只计有效文档，标记为删除的旧版本不算
+        qsizetype frequency = 0;
+        for (const Posting &posting : list) {
+            frequency += !data.documents[posting.document].removed;
+        }
+        const double idf = std::log(1.0 + (documentCount - frequency + 0.5) / (frequency + 0.5));
+        for (const Posting &posting : list) {
+            const Document &document = data.documents[posting.document];
+            if (document.removed) {
+                continue;
+            }
+            const double tf = posting.count;
+            const double norm = K1 * (1.0 - B + B * document.length / averageLength);
+            scores[posting.document] += qMax(idf, 0.01) * tf * (K1 + 1.0) / (tf + norm);
+        }
+    };
+
+    QHash<quint32, double> scores;
+    for (qsizetype t = 0; t < tokens.size(); ++t) {
+        const Token &token = tokens[t];
+        QHash<quint32, double> termScores;
+        const bool prefix = t == tokens.size() - 1 && token.kind != Token::Cjk;
+        if (prefix) {
+            int expanded = 0;
+            for (auto it = data.postings.lowerBound(token.term);
+                 it != data.postings.cend() && it.key().startsWith(token.term) && expanded < MaxPrefixExpansion;
+                 ++it, ++expanded) {
+                scorePostings(it.value(), termScores);
+            }
+        } else {
+            const auto it = data.postings.constFind(token.term);
+            if (it != data.postings.cend()) {
+                scorePostings(it.value(), termScores);
+            }
+        }
+
+        // 所有词都必须出现
+        if (t == 0) {
+            scores = std::move(termScores);
+        } else {
+            QHash<quint32, double> both;
+            for (auto it = scores.cbegin(); it != scores.cend(); ++it) {
+                const auto match = termScores.constFind(it.key());
+                if (match != termScores.cend()) {
+                    both.insert(it.key(), it.value() + match.value());
+                }
+            }
+            scores = std::move(both);
+        }
+        if (scores.isEmpty()) {
+            return hits;
+        }
+    }
+
+    hits.reserve(scores.size());
+    for (auto it = scores.cbegin(); it != scores.cend(); ++it) {
+        hits.append({data.documents[it.key()].filePath, it.value(), QString()});
+    }
+    const qsizetype count = qMin<qsizetype>(limit, hits.size());
+    std::partial_sort(hits.begin(), hits.begin() + count, hits.end(), [](const Hit &a, const Hit &b) {
+        return a.score > b.score;
+    });
+    hits.resize(count);
+    return hits;
+}
+
+QString NoteIndex::snippet(const QString &filePath, const QString &query, int context)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
+    }
+    // 只看文件开头的一部分，足够找到摘要
+    const QString text = QString::fromUtf8(file.read(1024 * 1024));
+
+    qsizetype position = -1;
+    qsizetype length = 0;
+    const QList<Token> tokens = tokenize(query, true);
+    for (const Token &token : tokens) {
+        const qsizetype found = text.indexOf(token.term, 0, Qt::CaseInsensitive);
+        if (found >= 0 && (position < 0 || found < position)) {
+            position = found;
+            length = token.term.size();
+        }
+    }
+    if (position < 0) {
+        position = 0;
+    }
+
+    const qsizetype start = qMax<qsizetype>(0, position - context);
+    const qsizetype end = qMin(text.size(), position + length + 2 * context);
+    QString result = text.mid(start, end - start).simplified();
+    if (start > 0) {
+        result.prepend(QStringLiteral("…"));
+    }
+    if (end < text.size()) {
+        result.append(QStringLiteral("…"));
+    }
+    return result;
+}
+
+void NoteIndex::save()
+{
+    m_openWatcher->waitForFinished();
+    onOpened();
+    while (m_updating) {
+        m_updateWatcher->waitForFinished();
+        onUpdated();
+    }
+    // 更新完成时可能又开始了后台保存，等它写完再写最新的索引
+    m_saveWatcher->waitForFinished();
+    m_saveAgain = false;
+    if (!m_dirty || m_indexFile.isEmpty()) {
+        return;
+    }
+    Data data = *m_data;
+    data.compact();
+    if (data.save(m_indexFile)) {
+        m_dirty = false;
+    }
+}
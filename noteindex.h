@@ -0,0 +1,175 @@
+// noteindex.h
+#ifndef NOTEINDEX_H
+#define NOTEINDEX_H
+
+#include "documentsnapshot.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringView>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QFutureWatcher>
+#include <memory>
+
+// 笔记库的全文倒排索引。
+// 分词：拉丁字母、数字按单词切分并转为小写；中日韩文字没有空格，同时索引单字和相邻两字（bigram），
+// 查询“中文搜索”会变成“中文”“文搜”“搜索”三个词；藏文按音节点（tsheg ་）和分句符切分为音节。
+// 查询的所有词都必须出现，按 BM25 排序；最后一个拉丁/藏文词按前缀匹配，边输入边搜索。
+// 索引保存在磁盘上，启动时在后台加载，并根据文件的修改时间和大小只重新索引变化的笔记；
+// 保存笔记后只更新该笔记的条目，删除的条目累积到一定数量时整理索引并在后台写回磁盘。
+// 索引生成后只读，由 shared_ptr 共享：更新和整理在后台线程生成新的索引，完成后在主线程替换指针；
+// 搜索、摘要和写回磁盘持有当时的指针，主线程不复制索引
+class NoteIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Token
+    {
+        enum Kind { Word, Cjk, Tibetan };
+        QString term;
+        Kind kind = Word;
+    };
+
+    struct Hit
+    {
+        QString filePath;
+        double score = 0;
+        QString snippet;  // 第一个匹配词附近的一段文字
+    };
+
+    explicit NoteIndex(QObject *parent = nullptr);
+    ~NoteIndex();
+
+    // 单个词的最大长度，更长的（例如内嵌的 base64 数据）不索引
+    static constexpr int MaxTermLength = 64;
+    // 前缀匹配最多展开的词数
+    static constexpr int MaxPrefixExpansion = 256;
+    // 删除（含保存时替换）的文档超过有效文档的 1/CompactRatio 再加 CompactSlack 时整理并保存索引
+    static constexpr int CompactRatio = 4;
+    static constexpr int CompactSlack = 32;
+
+    // 分词；query 为 true 时，两个字以上的中日韩文字只取 bigram（单字太常见，不增加区分度）
+    static QList<Token> tokenize(QStringView text, bool query = false);
+
+    // 后台加载 indexFile 并与 resourcesPath 下的 .md 文件同步，完成后发出 ready()
+    void open(const QString &indexFile, const QString &resourcesPath);
+    bool isReady() const { return m_ready; }
+
+    // 笔记保存后更新索引（分词在后台进行）
+    void updateFile(const QString &filePath, const DocumentSnapshot &snapshot);
+    void removeFile(const QString &filePath);
+    // 文件在程序外被修改或新增时从磁盘重新读取；修改时间和大小与索引一致时跳过
+    void refreshFile(const QString &filePath);
+
+    // 在后台按相关度查找最多 limit 个结果并生成摘要，完成后发出 searchFinished()。
+    // 上一次搜索未完成时只保留最新的查询
+    void startSearch(const QString &query, int limit);
+
+    int documentCount() const { return m_data->aliveCount; }
+
+    // 等待后台任务结束，把修改过的索引写回磁盘
+    void save();
+
+signals:
+    void ready();
+    void searchFinished(const QString &query, const QList<NoteIndex::Hit> &hits);
+
+private:
+    struct Posting
+    {
+        quint32 document = 0;
+        quint32 count = 0;
+    };
+
+    struct Document
+    {
+        QString filePath;
+        qint64 modified = 0;  // 毫秒时间戳
+        qint64 size = 0;
+        quint32 length = 0;   // 词数
+        bool removed = false;
+    };
+
+    using TermCounts = QHash<QString, quint32>;
+
+    struct Data
+    {
+        QList<Document> documents;
+        QHash<QString, quint32> documentIds;  // 有效文档的路径 → 下标
+        QMap<QString, QList<Posting>> postings;  // 有序，用于前缀匹配
+        qint64 totalLength = 0;
+        int aliveCount = 0;
+        int removedCount = 0;
+
+        void add(const QString &filePath, qint64 modified, qint64 size, const TermCounts &counts);
+        void remove(const QString &filePath);
+        void compact();
+        bool load(const QString &indexFile);
+        bool save(const QString &indexFile) const;
+    };
+
+    using DataPtr = std::shared_ptr<const Data>;
+
+    struct Update
+    {
+        QString filePath;
+        qint64 modified = 0;
+        qint64 size = 0;
+        TermCounts counts;
+    };
+
+    struct SearchResult
+    {
+        QString query;
+        QList<Hit> hits;
+    };
+
+    struct Pending
+    {
+        enum Action { Snapshot, Reload, Remove };
+        QString filePath;
+        Action action = Snapshot;
+        DocumentSnapshot snapshot;
+    };
+
+    // 一批修改应用之后的新索引
+    struct Batch
+    {
+        DataPtr data;
+        bool compacted = false;  // 已经整理，需要写回磁盘
+    };
+
+    static TermCounts countTerms(QStringView text);
+    static Update readFile(const QString &filePath);
+    static Data build(const QString &indexFile, const QString &resourcesPath);
+    static Batch applyUpdates(const DataPtr &base, const QList<Pending> &pending);
+    static QList<Hit> search(const Data &data, const QString &query, int limit);
+    static QString snippet(const QString &filePath, const QString &query, int context = 24);
+    void onOpened();
+    void onUpdated();
+    void onSearched();
+    void startNextUpdate();
+    void startSave();
+    void launchSearch(const QString &query, int limit);
+
+    DataPtr m_data;
+    QString m_indexFile;
+    bool m_ready = false;
+    bool m_dirty = false;
+    QFutureWatcher<Data> *m_openWatcher;
+    QFutureWatcher<Batch> *m_updateWatcher;
+    QFutureWatcher<bool> *m_saveWatcher;
+    bool m_saveAgain = false;  // 后台保存期间又整理过一次
+    QFutureWatcher<SearchResult> *m_searchWatcher;
+    bool m_updating = false;
+    QString m_pendingQuery;
+    int m_pendingLimit = 0;
+    bool m_hasPendingSearch = false;
+    // 加载完成前或上一批更新未完成时排队的修改
+    QList<Pending> m_queue;
+};
+
+#endif // NOTEINDEX_H
@@ -0,0 +1,231 @@
+// notelibrary.cpp
+#include "notelibrary.h"
+#include "notecatalog.h"
+#include "perftrace.h"
+
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include <utility>
+
+NoteLibrary::NoteLibrary(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_settleTimer(new QTimer(this))
+{
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(SettleDelay);
+    connect(m_settleTimer, &QTimer::timeout, this, &NoteLibrary::processChanges);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &NoteLibrary::onDirectoryChanged);
+}
+
+bool NoteLibrary::open(const QString &path)
+{
+    PERF_SCOPE("NoteLibrary::open");
+    QDir dir(path);
+    if (!dir.exists() && !dir.mkpath(".")) {
+        return false;
+    }
+
+    if (!m_watcher->directories().isEmpty()) {
+        m_watcher->removePaths(m_watcher->directories());
+    }
+    m_path = dir.absolutePath();
+    m_notes.clear();
+    m_activeNote.clear();
+    m_changedNotes.clear();
+    m_rootChanged = false;
+
+    // 第一次扫描不发信号，调用者用 notes() / files() 填充列表。
+    // 只列出和监视 resources/，几万篇笔记时也不需要逐个打开笔记目录
+    const QStringList names = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Unsorted);
+    for (const QString &name : names) {
+        m_notes.insert(name, Note());
+    }
+    if (!m_watcher->addPath(m_path)) {
+        qWarning() << "无法监视笔记库目录，新增和删除的笔记不会自动显示:" << m_path;
+    }
+    return true;
+}
+
+void NoteLibrary::setActiveNote(const QString &noteName)
+{
+    if (noteName == m_activeNote) {
+        return;
+    }
+    if (!m_activeNote.isEmpty()) {
+        m_watcher->removePath(m_path + "/" + m_activeNote);
+        m_activeNote.clear();
+    }
+    const auto note = m_notes.constFind(noteName);
+    if (note == m_notes.cend()) {
+        return;
+    }
+    m_activeNote = noteName;
+    if (!m_watcher->addPath(m_path + "/" + noteName)) {
+        qWarning() << "无法监视笔记目录，外部修改不会自动显示:" << noteName;
+    }
+    if (note->listed) {
+        m_changedNotes.remove(noteName);
+        scanNote(noteName);
+    }
+}
+
+QStringList NoteLibrary::files(const QString &noteName)
+{
+    const auto note = m_notes.find(noteName);
+    if (note == m_notes.end()) {
+        return QStringList();
+    }
+    if (!note->listed) {
+        if (m_catalog && m_catalog->isValid()) {
+            // 目录数据库已经与磁盘校验过，不需要访问文件系统
+            const QList<NoteCatalog::FileRecord> records = m_catalog->files(noteName);
+            for (const NoteCatalog::FileRecord &record : records) {
+                if (isListed(record.path)) {
+                    note->files.insert(record.path, {record.modified, record.size});
+                }
+            }
+        } else {
+            note->files = listFiles(noteName);
+        }
+        note->listed = true;
+    }
+
+    QStringList names = note->files.keys();
+    std::sort(names.begin(), names.end(), [](const QString &a, const QString &b) {
+        return QString::localeAwareCompare(a, b) < 0;
+    });
+    return names;
+}
+
+// 详情列表中显示的文档：笔记目录下（不含子目录）的 Markdown 和 PDF
+bool NoteLibrary::isListed(const QString &fileName)
+{
+    if (fileName.contains('/')) {
+        return false;
+    }
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    return suffix == "md" || suffix == "markdown" || suffix == "pdf";
+}
+
+// 列出笔记目录；有目录数据库时同时请求在后台更新数据库中这篇笔记的记录（需要计算哈希，不能在这里等待）
+NoteLibrary::Files NoteLibrary::listFiles(const QString &noteName)
+{
+    if (m_catalog) {
+        m_catalog->updateNote(noteName);
+    }
+
+    Files files;
+    const QFileInfoList infos = QDir(m_path + "/" + noteName).entryInfoList({"*.md", "*.markdown", "*.pdf"}, QDir::Files);
+    for (const QFileInfo &info : infos) {
+        files.insert(info.fileName(), {info.lastModified().toMSecsSinceEpoch(), info.size()});
+    }
+    return files;
+}
+
+void NoteLibrary::onDirectoryChanged(const QString &path)
+{
+    if (path == m_path) {
+        m_rootChanged = true;
+    } else {
+        m_changedNotes.insert(QFileInfo(path).fileName());
+    }
+    // 不重新计时：持续变化时也按固定间隔处理
+    if (!m_settleTimer->isActive()) {
+        m_settleTimer->start();
+    }
+}
+
+void NoteLibrary::processChanges()
+{
+    PERF_SCOPE("NoteLibrary::processChanges");
+    m_settleTimer->stop();
+    if (m_rootChanged) {
+        m_rootChanged = false;
+        scanRoot();
+    }
+    const QSet<QString> changed = std::exchange(m_changedNotes, {});
+    for (const QString &noteName : changed) {
+        if (m_notes.contains(noteName)) {
+            scanNote(noteName);
+        }
+    }
+}
+
+void NoteLibrary::refresh(const QString &noteName)
+{
+    if (m_path.isEmpty()) {
+        return;
+    }
+    if (m_notes.contains(noteName)) {
+        m_changedNotes.remove(noteName);
+        scanNote(noteName);
+    } else {
+        m_rootChanged = false;
+        scanRoot();
+    }
+}
+
+// 重新列出 resources/ 的子目录，处理新增和删除的笔记
+void NoteLibrary::scanRoot()
+{
+    const QStringList names = QDir(m_path).entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Unsorted);
+    const QSet<QString> current(names.cbegin(), names.cend());
+
+    const QStringList known = m_notes.keys();
+    for (const QString &noteName : known) {
+        if (current.contains(noteName)) {
+            continue;
+        }
+        const Files files = m_notes.take(noteName).files;
+        m_changedNotes.remove(noteName);
+        if (noteName == m_activeNote) {
+            m_watcher->removePath(m_path + "/" + noteName);
+            m_activeNote.clear();
+        }
+        if (m_catalog) {
+            m_catalog->removeNote(noteName);
+        }
+        for (auto it = files.cbegin(); it != files.cend(); ++it) {
+            emit fileRemoved(noteName, it.key());
+        }
+        emit noteRemoved(noteName);
+    }
+
+    for (const QString &noteName : names) {
+        if (m_notes.contains(noteName)) {
+            continue;
+        }
+        m_notes.insert(noteName, Note());
+        emit noteAdded(noteName);
+        scanNote(noteName);
+    }
+}
+
+// 重新列出一个笔记目录，与上次的结果比较
+void NoteLibrary::scanNote(const QString &noteName)
+{
+    Note &note = m_notes[noteName];
+    const Files current = listFiles(noteName);
+    const Files previous = std::exchange(note.files, current);
+    note.listed = true;
+
+    for (auto it = previous.cbegin(); it != previous.cend(); ++it) {
+        if (!current.contains(it.key())) {
+            emit fileRemoved(noteName, it.key());
+        }
+    }
+    for (auto it = current.cbegin(); it != current.cend(); ++it) {
+        const auto old = previous.constFind(it.key());
+        if (old == previous.cend()) {
+            emit fileAdded(noteName, it.key());
+        } else if (old.value().modified != it.value().modified || old.value().size != it.value().size) {
+            emit fileChanged(noteName, it.key());
+        }
+    }
+}
@@ -0,0 +1,93 @@
+// notelibrary.h
+#ifndef NOTELIBRARY_H
+#define NOTELIBRARY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QSet>
+
+class QFileSystemWatcher;
+class QTimer;
+class NoteCatalog;
+
+// 笔记库：resources/ 下每个子目录是一篇笔记，目录中的 .md/.markdown/.pdf 是它的文档。
+// 启动时只列出 resources/，笔记目录第一次用到时才列出。QFileSystemWatcher 只监视 resources/
+// 和当前打开的笔记目录（每个监视的目录都要占用一个系统句柄，几万篇笔记时不能逐个监视），
+// 目录变化时只重新列出这个目录，与上次的结果比较后发出增加、删除、修改的信号。
+// 其他笔记目录在程序外的修改由目录数据库启动时的校验发现，切换到这篇笔记时也会重新列出。
+// 重命名表现为一次删除加一次增加。短时间内的大量变化（例如 git pull）合并后一起处理。
+// 还没有列出过的目录发生变化时，其中的文件都按新增处理。
+// 设置了 NoteCatalog 时，第一次列出的目录优先从目录数据库读取；目录变化时在这里直接列出目录，
+// 同时请求目录数据库在后台更新这篇笔记
+class NoteLibrary : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NoteLibrary(QObject *parent = nullptr);
+
+    // 目录变化后等待多久再处理（毫秒）
+    static constexpr int SettleDelay = 200;
+
+    // 打开笔记库，目录不存在时创建；失败时返回 false
+    bool open(const QString &path);
+    QString path() const { return m_path; }
+    void setCatalog(NoteCatalog *catalog) { m_catalog = catalog; }
+
+    // 所有笔记（不排序，显示顺序由 NoteListModel 决定）
+    QStringList notes() const { return m_notes.keys(); }
+    // 按名称排序的某篇笔记的文档，第一次调用时列出目录
+    QStringList files(const QString &noteName);
+    bool contains(const QString &noteName) const { return m_notes.contains(noteName); }
+
+    // 改为监视这篇笔记的目录；已经列出过时重新列出，补上没有监视期间的变化
+    void setActiveNote(const QString &noteName);
+
+    // 立即重新列出某篇笔记的目录（例如刚保存之后），不等待文件系统通知；
+    // 笔记还不存在时重新列出 resources/
+    void refresh(const QString &noteName);
+
+signals:
+    void noteAdded(const QString &noteName);
+    void noteRemoved(const QString &noteName);
+    void fileAdded(const QString &noteName, const QString &fileName);
+    void fileRemoved(const QString &noteName, const QString &fileName);
+    // 文档的修改时间或大小变化（包括在程序外被修改）
+    void fileChanged(const QString &noteName, const QString &fileName);
+
+private slots:
+    void onDirectoryChanged(const QString &path);
+    void processChanges();
+
+private:
+    struct Entry
+    {
+        qint64 modified = 0;
+        qint64 size = 0;
+    };
+    using Files = QMap<QString, Entry>;
+
+    struct Note
+    {
+        Files files;
+        bool listed = false;
+    };
+
+    Files listFiles(const QString &noteName);
+    static bool isListed(const QString &fileName);
+    void scanRoot();
+    void scanNote(const QString &noteName);
+
+    QString m_path;
+    QFileSystemWatcher *m_watcher;
+    NoteCatalog *m_catalog = nullptr;
+    QTimer *m_settleTimer;
+    QMap<QString, Note> m_notes;
+    QString m_activeNote;          // 正在监视的笔记目录
+    QSet<QString> m_changedNotes;  // 等待处理的笔记目录
+    bool m_rootChanged = false;    // resources/ 本身有变化
+};
+
+#endif // NOTELIBRARY_H
@@ -0,0 +1,375 @@
+// notelistmodel.cpp
+#include "notelistmodel.h"
+#include "notecatalog.h"
+#include "perftrace.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QLocale>
+#include <algorithm>
+
+NoteListModel::NoteListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    m_collator.setNumericMode(true);
+}
+
+void NoteListModel::setLibraryPath(const QString &path)
+{
+    m_path = path;
+}
+
+void NoteListModel::setNotes(const QStringList &names)
+{
+    PERF_SCOPE("NoteListModel::setNotes");
+    // 先为每个名称计算一次排序键，排序时只比较字节串
+    QList<QPair<QCollatorSortKey, QString>> keyed;
+    keyed.reserve(names.size());
+    for (const QString &name : names) {
+        keyed.append({m_collator.sortKey(name), name});
+    }
+    std::sort(keyed.begin(), keyed.end(), [](const auto &a, const auto &b) {
+        return a.first.compare(b.first) < 0;
+    });
+
+    beginResetModel();
+    m_records.clear();
+    m_records.reserve(keyed.size());
+    for (const auto &entry : std::as_const(keyed)) {
+        Record record;
+        record.name = entry.second;
+        m_records.append(record);
+    }
+    rebuildRows();
+    endResetModel();
+}
+
+// 按名称排序时 name 应在的记录下标
+int NoteListModel::recordPosition(const QString &name) const
+{
+    const auto it = std::lower_bound(m_records.cbegin(), m_records.cend(), name,
+                                     [this](const Record &record, const QString &value) {
+                                         return m_collator.compare(record.name, value) < 0;
+                                     });
+    return int(it - m_records.cbegin());
+}
+
+int NoteListModel::findRecord(const QString &name) const
+{
+    // 排序规则认为相等但写法不同的名称（例如只有大小写不同）相邻存放，只在这一段中查找
+    for (int i = recordPosition(name); i < m_records.size(); ++i) {
+        if (m_records[i].name == name) {
+            return i;
+        }
+        if (m_collator.compare(m_records[i].name, name) != 0) {
+            break;
+        }
+    }
+    return -1;
+}
+
+void NoteListModel::addNote(const QString &name)
+{
+    if (findRecord(name) >= 0) {
+        return;
+    }
+    const int index = recordPosition(name);
+    Record record;
+    record.name = name;
+    m_records.insert(index, record);
+    for (int &row : m_rows) {
+        if (row >= index) {
+            ++row;
+        }
+    }
+
+    if (!accepts(m_records[index])) {
+        return;
+    }
+    const int row = rowPosition(index);
+    beginInsertRows(QModelIndex(), row, row);
+    m_rows.insert(row, index);
+    endInsertRows();
+}
+
+void NoteListModel::removeNote(const QString &name)
+{
+    const int index = findRecord(name);
+    if (index < 0) {
+        return;
+    }
+    const int row = rowOf(index);
+    if (row >= 0) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_rows.removeAt(row);
+        endRemoveRows();
+    }
+    m_records.removeAt(index);
+    for (int &other : m_rows) {
+        if (other > index) {
+            --other;
+        }
+    }
+}
+
+void NoteListModel::invalidate(const QString &name)
+{
+    const int index = findRecord(name);
+    if (index < 0) {
+        return;
+    }
+    // 先按原来的修改时间找到这一行，再清除元数据
+    const int row = rowOf(index);
+    m_records[index].loaded = 0;
+    if (row < 0) {
+        return;
+    }
+
+    if (m_sortMode == SortByModified) {
+        // 修改时间变了，把这一行移到新的位置
+        beginRemoveRows(QModelIndex(), row, row);
+        m_rows.removeAt(row);
+        endRemoveRows();
+        const int position = rowPosition(index);
+        beginInsertRows(QModelIndex(), position, position);
+        m_rows.insert(position, index);
+        endInsertRows();
+    } else {
+        const QModelIndex changed = createIndex(row, 0);
+        emit dataChanged(changed, changed);
+    }
+}
+
+void NoteListModel::setSortMode(SortMode mode)
+{
+    if (mode == m_sortMode) {
+        return;
+    }
+    m_sortMode = mode;
+    beginResetModel();
+    rebuildRows();
+    endResetModel();
+}
+
+void NoteListModel::setFilterText(const QString &text)
+{
+    if (text == m_filterText) {
+        return;
+    }
+    m_filterText = text;
+    beginResetModel();
+    rebuildRows();
+    endResetModel();
+}
+
+bool NoteListModel::accepts(const Record &record) const
+{
+    return m_filterText.isEmpty() || record.name.contains(m_filterText, Qt::CaseInsensitive);
+}
+
+// 记录已按名称排序，名称相同的比较只需要比较下标
+bool NoteListModel::lessThan(int a, int b) const
+{
+    if (m_sortMode == SortByModified) {
+        Record &left = m_records[a];
+        Record &right = m_records[b];
+        loadStat(left);
+        loadStat(right);
+        if (left.modified != right.modified) {
+            return left.modified > right.modified;  // 最近修改的在前
+        }
+    }
+    return a < b;
+}
+
+// 记录 record 在显示的行中应在的位置
+int NoteListModel::rowPosition(int record) const
+{
+    const auto it = std::lower_bound(m_rows.cbegin(), m_rows.cend(), record, [this](int row, int value) {
+        return lessThan(row, value);
+    });
+    return int(it - m_rows.cbegin());
+}
+
+// 记录 record 当前所在的行，没有显示时返回 -1。行按 lessThan 有序，二分查找
+int NoteListModel::rowOf(int record) const
+{
+    const int position = rowPosition(record);
+    return position < m_rows.size() && m_rows[position] == record ? position : -1;
+}
+
+void NoteListModel::rebuildRows()
+{
+    PERF_SCOPE("NoteListModel::rebuildRows");
+    m_rows.clear();
+    m_rows.reserve(m_records.size());
+    for (int i = 0; i < m_records.size(); ++i) {
+        if (accepts(m_records[i])) {
+            m_rows.append(i);
+        }
+    }
+    if (m_sortMode == SortByModified && m_catalog && m_catalog->isValid()) {
+        const QHash<QString, NoteCatalog::FileRecord> mainFiles = m_catalog->mainFiles();
+        for (Record &record : m_records) {
+            const auto file = mainFiles.constFind(record.name);
+            if (!(record.loaded & StatLoaded) && file != mainFiles.cend()) {
+                record.modified = file->modified;
+                record.size = file->size;
+                record.loaded |= StatLoaded;
+            }
+        }
+    }
+    if (m_sortMode != SortByName) {
+        std::stable_sort(m_rows.begin(), m_rows.end(), [this](int a, int b) {
+            return lessThan(a, b);
+        });
+    }
+}
+
+void NoteListModel::loadStat(Record &record) const
+{
+    if (record.loaded & StatLoaded) {
+        return;
+    }
+    record.loaded |= StatLoaded;
+    QFileInfo info(m_path + "/" + record.name + "/" + record.name + ".md");
+    if (!info.exists()) {
+        // 没有同名正文的笔记用目录的修改时间
+        info = QFileInfo(m_path + "/" + record.name);
+    }
+    record.modified = info.lastModified().toMSecsSinceEpoch();
+    record.size = info.isFile() ? info.size() : 0;
+}
+
+// 读取正文开头：YAML front matter 中的 title / tags，否则用第一个一级标题
+void NoteListModel::loadHeader(Record &record) const
+{
+    if (record.loaded & HeaderLoaded) {
+        return;
+    }
+    record.loaded |= HeaderLoaded;
+    record.title.clear();
+    record.tags = 0;
+
+    QFile file(m_path + "/" + record.name + "/" + record.name + ".md");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QString header = QString::fromUtf8(file.read(HeaderBytes));
+    const QStringList lines = header.split('\n');
+
+    int i = 0;
+    if (!lines.isEmpty() && lines.first().trimmed() == "---") {
+        for (i = 1; i < lines.size(); ++i) {
+            const QString line = lines[i].trimmed();
+            if (line == "---") {
+                ++i;
+                break;
+            }
+            if (line.startsWith("title:")) {
+                record.title = line.mid(6).trimmed().remove('"');
+            } else if (line.startsWith("tags:")) {
+                QString value = line.mid(5).trimmed();
+                value.remove('[').remove(']');
+                const QStringList tags = value.split(',', Qt::SkipEmptyParts);
+                for (const QString &tag : tags) {
+                    const QString name = tag.trimmed().remove('"');
+                    if (name.isEmpty()) {
+                        continue;
+                    }
+                    int bit = int(m_tagNames.indexOf(name));
+                    if (bit < 0 && m_tagNames.size() < MaxTags) {
+                        bit = int(m_tagNames.size());
+                        m_tagNames.append(name);
+                    }
+                    if (bit >= 0) {
+                        record.tags |= 1u << bit;
+                    }
+                }
+            }
+        }
+    }
+    for (; record.title.isEmpty() && i < lines.size(); ++i) {
+        if (lines[i].startsWith("# ")) {
+            record.title = lines[i].mid(2).trimmed();
+        }
+    }
+}
+
+QStringList NoteListModel::tagNames(quint32 tags) const
+{
+    QStringList names;
+    for (int bit = 0; bit < m_tagNames.size(); ++bit) {
+        if (tags & (1u << bit)) {
+            names.append(m_tagNames[bit]);
+        }
+    }
+    return names;
+}
+
+QString NoteListModel::noteName(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QString();
+    }
+    return m_records[m_rows[index.row()]].name;
+}
+
+QModelIndex NoteListModel::indexOf(const QString &name) const
+{
+    const int index = findRecord(name);
+    const int row = index >= 0 ? rowOf(index) : -1;
+    return row >= 0 ? createIndex(row, 0) : QModelIndex();
+}
+
+int NoteListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_rows.size());
+}
+
+QVariant NoteListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+    Record &record = m_records[m_rows[index.row()]];
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return record.name;
+    case TitleRole:
+        loadHeader(record);
+        return record.title;
+    case ModifiedRole:
+        loadStat(record);
+        return QDateTime::fromMSecsSinceEpoch(record.modified);
+    case SizeRole:
+        loadStat(record);
+        return record.size;
+    case TagsRole:
+        loadHeader(record);
+        return record.tags;
+    case Qt::ToolTipRole: {
+        // 鼠标停留时才读取元数据
+        loadStat(record);
+        loadHeader(record);
+        QStringList lines;
+        if (!record.title.isEmpty() && record.title != record.name) {
+            lines << record.title;
+        }
+        const QLocale locale;
+        lines << tr("修改时间：%1").arg(locale.toString(QDateTime::fromMSecsSinceEpoch(record.modified),
+                                                       QLocale::ShortFormat))
+              << tr("大小：%1").arg(locale.formattedDataSize(record.size));
+        const QStringList tags = tagNames(record.tags);
+        if (!tags.isEmpty()) {
+            lines << tr("标签：%1").arg(tags.join(", "));
+        }
+        return lines.join('\n');
+    }
+    default:
+        return QVariant();
+    }
+}
@@ -0,0 +1,98 @@
+// notelistmodel.h
+#ifndef NOTELISTMODEL_H
+#define NOTELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QCollator>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class NoteCatalog;
+
+// 笔记列表的数据模型。每篇笔记一条记录，记录按名称排序存放在连续的数组中；
+// 显示的行是记录下标的数组，排序和筛选只重排这个下标数组，不创建任何列表项。
+// 名称之外的元数据（修改时间、大小、标题、标签）在第一次用到时才读取：
+// 视图只查询可见的行，打开包含几万篇笔记的笔记库不需要读取任何笔记文件
+class NoteListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        TitleRole,
+        ModifiedRole,
+        SizeRole,
+        TagsRole  // 标签位，名称见 tagNames()
+    };
+
+    enum SortMode { SortByName, SortByModified };
+
+    // 读取标题和标签时最多读取的字节数
+    static constexpr int HeaderBytes = 4096;
+    // 可以用位表示的标签数，之后出现的标签不记录
+    static constexpr int MaxTags = 32;
+
+    explicit NoteListModel(QObject *parent = nullptr);
+
+    // 笔记库目录；笔记 <名称> 的正文是 <目录>/<名称>/<名称>.md
+    void setLibraryPath(const QString &path);
+    // 按修改时间排序时从目录数据库一次读取全部笔记的修改时间和大小，不逐个访问文件
+    void setCatalog(const NoteCatalog *catalog) { m_catalog = catalog; }
+    // 替换全部笔记（顺序无关）
+    void setNotes(const QStringList &names);
+    void addNote(const QString &name);
+    void removeNote(const QString &name);
+    // 笔记目录中的文件有变化，元数据下次用到时重新读取
+    void invalidate(const QString &name);
+
+    void setSortMode(SortMode mode);
+    SortMode sortMode() const { return m_sortMode; }
+    // 只显示名称包含 text 的笔记（不区分大小写）；空字符串显示全部
+    void setFilterText(const QString &text);
+
+    QString noteName(const QModelIndex &index) const;
+    QModelIndex indexOf(const QString &name) const;
+    QStringList tagNames(quint32 tags) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    enum LoadFlag : quint8 {
+        StatLoaded = 0x1,    // 修改时间和大小
+        HeaderLoaded = 0x2   // 标题和标签
+    };
+
+    struct Record
+    {
+        QString name;
+        QString title;
+        qint64 modified = 0;  // 毫秒时间戳
+        qint64 size = 0;
+        quint32 tags = 0;
+        quint8 loaded = 0;
+    };
+
+    int findRecord(const QString &name) const;
+    int recordPosition(const QString &name) const;
+    void loadStat(Record &record) const;
+    void loadHeader(Record &record) const;
+    bool accepts(const Record &record) const;
+    bool lessThan(int a, int b) const;
+    int rowPosition(int record) const;
+    int rowOf(int record) const;
+    void rebuildRows();
+
+    QString m_path;
+    const NoteCatalog *m_catalog = nullptr;
+    QCollator m_collator;
+    mutable QList<Record> m_records;  // 按名称排序
+    QList<int> m_rows;                // 显示的行 → 记录下标
+    SortMode m_sortMode = SortByName;
+    QString m_filterText;
+    mutable QStringList m_tagNames;   // 标签位 → 标签名
+};
+
+#endif // NOTELISTMODEL_H
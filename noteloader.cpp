@@ -0,0 +1,148 @@
+// noteloader.cpp
+#include "noteloader.h"
+#include "perftrace.h"
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArrayView>
+
+NoteLoader::NoteLoader(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    m_timer->setInterval(0);
+    connect(m_timer, &QTimer::timeout, this, &NoteLoader::loadNextSlice);
+}
+
+NoteLoader::~NoteLoader()
+{
+    cancel();
+}
+
+bool NoteLoader::load(const QString &filePath, QTextDocument *document)
+{
+    PERF_SCOPE("NoteLoader::load");
+    cancel();
+    m_error.clear();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    m_document = document;
+    m_size = m_file.size();
+    m_offset = 0;
+    m_pendingCarriageReturn = false;
+    m_decoder = QStringDecoder(QStringDecoder::Utf8);
+    // 映射失败（例如某些网络文件系统）时退回逐块读取
+    m_data = m_size > 0 ? m_file.map(0, m_size) : nullptr;
+    m_loading = true;
+
+    // 加载过程中不记录撤销操作，加载完成后撤销栈为空，与 setPlainText 一致
+    document->clear();
+    document->setUndoRedoEnabled(false);
+
+    if (m_size <= ChunkSize) {
+        // 小文件直接加载完
+        while (appendChunk()) {
+        }
+        finish();
+    } else {
+        m_timer->start();
+    }
+    return true;
+}
+
+void NoteLoader::cancel()
+{
+    if (!m_loading) {
+        return;
+    }
+    m_timer->stop();
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_loading = false;
+    if (m_document) {
+        m_document->setUndoRedoEnabled(true);
+    }
+}
+
+bool NoteLoader::isLoading() const
+{
+    return m_loading;
+}
+
+QString NoteLoader::errorString() const
+{
+    return m_error;
+}
+
+void NoteLoader::loadNextSlice()
+{
+    if (!m_document) {
+        // 文档已被销毁
+        cancel();
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+    while (appendChunk()) {
+        if (slice.elapsed() >= SliceBudget) {
+            return;
+        }
+    }
+    finish();
+}
+
+// 解码并追加下一块，返回是否还有剩余内容
+bool NoteLoader::appendChunk()
+{
+    PERF_SCOPE("NoteLoader::appendChunk");
+    qint64 length = qMin(ChunkSize, m_size - m_offset);
+    QString text;
+    if (m_data) {
+        text = m_decoder.decode(QByteArrayView(m_data + m_offset, length));
+    } else {
+        const QByteArray bytes = m_file.read(length);
+        if (bytes.isEmpty()) {
+            // 文件在加载过程中变短了
+            m_offset = m_size;
+            return false;
+        }
+        length = bytes.size();
+        text = m_decoder.decode(bytes);
+    }
+    m_offset += length;
+
+    // 与 QIODevice::Text 一样把 \r\n 换成 \n；\r\n 可能正好被块边界分开
+    if (m_pendingCarriageReturn) {
+        text.prepend(u'\r');
+        m_pendingCarriageReturn = false;
+    }
+    if (m_offset < m_size && text.endsWith(u'\r')) {
+        text.chop(1);
+        m_pendingCarriageReturn = true;
+    }
+    text.replace(u"\r\n", u"\n");
+
+    QTextCursor cursor(m_document);
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+
+    emit progress(m_offset, m_size);
+    return m_offset < m_size;
+}
+
+void NoteLoader::finish()
+{
+    cancel();
+    emit finished();
+}
@@ -0,0 +1,61 @@
+// noteloader.h
+#ifndef NOTELOADER_H
+#define NOTELOADER_H
+
+#include <QObject>
+#include <QFile>
+#include <QString>
+#include <QStringDecoder>
+#include <QPointer>
+
+class QTextDocument;
+class QTimer;
+
+// 大文件的流式加载：用 QFile::map 映射文件，按块增量解码 UTF-8，
+// 分批追加到编辑器文档末尾，每批之间回到事件循环，加载几十 MB 的笔记时界面仍然可以响应。
+// 任何时刻只有一块解码后的文本在内存中，峰值内存接近文件本身和文档的大小
+class NoteLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NoteLoader(QObject *parent = nullptr);
+    ~NoteLoader();
+
+    // 每块读取的字节数；不超过一块的文件在 load() 中同步加载完毕
+    static constexpr qint64 ChunkSize = 256 * 1024;
+    // 每次事件循环中最多用于插入文本的时间（毫秒）
+    static constexpr int SliceBudget = 16;
+
+    // 开始把文件加载到 document（先清空文档）。无法打开文件时返回 false，错误信息见 errorString()。
+    // 正在进行的加载会被取消
+    bool load(const QString &filePath, QTextDocument *document);
+    void cancel();
+
+    bool isLoading() const;
+    QString errorString() const;
+
+signals:
+    void progress(qint64 bytesLoaded, qint64 bytesTotal);
+    void finished();
+
+private slots:
+    void loadNextSlice();
+
+private:
+    bool appendChunk();
+    void finish();
+
+    QFile m_file;
+    QPointer<QTextDocument> m_document;
+    QStringDecoder m_decoder;
+    QTimer *m_timer;
+    uchar *m_data = nullptr;  // 映射的文件内容，映射失败时为空，改为逐块读取
+    qint64 m_size = 0;
+    qint64 m_offset = 0;
+    bool m_pendingCarriageReturn = false;  // 上一块以 \r 结尾，需要看下一块是否以 \n 开头
+    bool m_loading = false;
+    QString m_error;
+};
+
+#endif // NOTELOADER_H
@@ -0,0 +1,106 @@
+// notesaver.cpp
+#include "notesaver.h"
+#include "perftrace.h"
+
+#include <QSaveFile>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+NoteSaver::NoteSaver(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<QString>(this))
+{
+    connect(m_watcher, &QFutureWatcherBase::finished, this, &NoteSaver::onWriteFinished);
+}
+
+NoteSaver::~NoteSaver()
+{
+    // 不能丢下写了一半的临时文件，也不能丢掉排队中的保存
+    waitForFinished();
+}
+
+void NoteSaver::save(const QString &filePath, const DocumentSnapshot &snapshot)
+{
+    const Request request{filePath, snapshot};
+    if (!m_busy) {
+        start(request);
+        return;
+    }
+
+    // 正在写入：同一文件的旧请求被新的快照替换
+    for (Request &pending : m_pending) {
+        if (pending.filePath == filePath) {
+            pending = request;
+            return;
+        }
+    }
+    m_pending.append(request);
+}
+
+bool NoteSaver::isSaving() const
+{
+    return m_busy;
+}
+
+void NoteSaver::waitForFinished()
+{
+    while (m_busy) {
+        m_watcher->waitForFinished();
+        // finished 信号尚未送达，直接处理；之后送达的信号会因为 m_busy 为 false 被忽略
+        onWriteFinished();
+    }
+}
+
+void NoteSaver::start(const Request &request)
+{
+    m_busy = true;
+    m_running = request;
+    m_watcher->setFuture(QtConcurrent::run([request]() {
+        return write(request);
+    }));
+}
+
+QString NoteSaver::write(const Request &request)
+{
+    PERF_SCOPE("NoteSaver::write");
+    // 完整文本可能已经被预览生成过，这里直接共享
+    const QByteArray bytes = request.snapshot.text().toUtf8();
+
+    QSaveFile file(request.filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return file.errorString();
+    }
+    if (file.write(bytes) != bytes.size()) {
+        const QString error = file.errorString();
+        file.cancelWriting();
+        return error;
+    }
+    if (!file.commit()) {
+        return file.errorString();
+    }
+    return QString();
+}
+
+void NoteSaver::onWriteFinished()
+{
+    if (!m_busy) {
+        return;
+    }
+    m_busy = false;
+
+    const QString error = m_watcher->result();
+    const Request finished = std::move(m_running);
+    m_running = Request();
+
+    // 先开始下一项，信号处理函数中再次提交的保存会正确排队
+    if (!m_pending.isEmpty()) {
+        start(m_pending.takeFirst());
+    }
+
+    if (error.isEmpty()) {
+        emit saved(finished.filePath, finished.snapshot);
+    } else {
+        qWarning() << "保存失败:" << finished.filePath << error;
+        emit failed(finished.filePath, finished.snapshot.revision(), error);
+    }
+}
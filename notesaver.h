@@ -0,0 +1,55 @@
+// notesaver.h
+#ifndef NOTESAVER_H
+#define NOTESAVER_H
+
+#include "documentsnapshot.h"
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QFutureWatcher>
+
+// 后台保存笔记：在工作线程中把内容快照写入 QSaveFile，写完后原子替换目标文件，
+// 保存过程中程序崩溃或断电不会留下写了一半的笔记。
+// 同一时间只有一个写入任务；写入期间对同一文件的多次保存只保留最新的快照（write-behind）
+class NoteSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NoteSaver(QObject *parent = nullptr);
+    ~NoteSaver();
+
+    // 提交保存，立即返回；结果通过 saved / failed 信号通知
+    void save(const QString &filePath, const DocumentSnapshot &snapshot);
+
+    bool isSaving() const;
+
+    // 阻塞等待所有已提交的保存完成（包括排队中的），信号在返回前发出。用于退出前
+    void waitForFinished();
+
+signals:
+    void saved(const QString &filePath, const DocumentSnapshot &snapshot);
+    void failed(const QString &filePath, quint64 revision, const QString &errorString);
+
+private slots:
+    void onWriteFinished();
+
+private:
+    struct Request
+    {
+        QString filePath;
+        DocumentSnapshot snapshot;
+    };
+
+    // 工作线程：写入并提交，成功时返回空字符串，失败时返回错误信息
+    static QString write(const Request &request);
+    void start(const Request &request);
+
+    QFutureWatcher<QString> *m_watcher;
+    Request m_running;
+    bool m_busy = false;
+    QList<Request> m_pending;  // 每个文件最多一项
+};
+
+#endif // NOTESAVER_H
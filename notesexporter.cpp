@@ -0,0 +1,219 @@
+// notesexporter.cpp
+#include "notesexporter.h"
+#include "formulaimages.h"
+#include "markdowndocumentbuilder.h"
+#include "perftrace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextDocument>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QPageLayout>
+#include <QMarginsF>
+#include <QUrl>
+#include <QThreadPool>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace {
+
+const char FormulaFolder[] = "_formulas";
+
+// 与预览使用相同的字体设置
+const char ExportStyle[] = R"(<style>
+ body { font-family: "Microsoft YaHei"; font-size: 14pt; color: #333; }
+ img { max-width: 100%; }
+</style>)";
+
+QMutex outputMutex;
+
+void printLine(const QString &line)
+{
+    QMutexLocker locker(&outputMutex);
+    QTextStream out(stdout);
+    out << line << '\n';
+}
+
+bool writeText(const QString &path, const QString &text, QString *error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(text.toUtf8()) < 0 || !file.commit()) {
+        *error = QString("无法写入 %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+NotesExporter::NotesExporter(const QString &resourcesDir, const QString &outputDir)
+    : m_resourcesDir(QDir(resourcesDir).absolutePath())
+    , m_outputDir(QDir(outputDir).absolutePath())
+{
+}
+
+void NotesExporter::setPdfEnabled(bool enabled)
+{
+    m_pdf = enabled;
+}
+
+void NotesExporter::setThreadCount(int threads)
+{
+    m_threads = threads;
+}
+
+QStringList NotesExporter::findNotes(const QString &resourcesDir)
+{
+    QDir dir(resourcesDir);
+    dir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
+    QStringList notes;
+    const QStringList folders = dir.entryList();
+    for (const QString &folder : folders) {
+        // 笔记文件与文件夹同名，没有笔记文件的文件夹跳过
+        if (QFileInfo::exists(dir.filePath(folder + "/" + folder + ".md"))) {
+            notes.append(folder);
+        }
+    }
+    return notes;
+}
+
+QString NotesExporter::formulaDirectory() const
+{
+    return m_outputDir + "/" + FormulaFolder;
+}
+
+int NotesExporter::run()
+{
+    const QStringList notes = findNotes(m_resourcesDir);
+    if (notes.isEmpty()) {
+        printLine(QString("没有找到笔记: %1").arg(m_resourcesDir));
+        return 0;
+    }
+    if (!QDir().mkpath(formulaDirectory())) {
+        printLine(QString("无法创建输出目录: %1").arg(m_outputDir));
+        return int(notes.size());
+    }
+
+    // 所有线程共用一个公式图片缓存，相同的公式只排版和写入一次
+    FormulaImages images;
+    images.setCacheDirectory(formulaDirectory());
+
+    QThreadPool pool;
+    if (m_threads > 0) {
+        pool.setMaxThreadCount(m_threads);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    printLine(QString("导出 %1 篇笔记，%2 个线程").arg(notes.size()).arg(pool.maxThreadCount()));
+
+    QFuture<Result> future = QtConcurrent::mapped(&pool, notes, [this, &images](const QString &note) {
+        return exportNote(note, &images);
+    });
+    future.waitForFinished();
+
+    int failures = 0;
+    int copied = 0;
+    const QList<Result> results = future.results();
+    for (const Result &result : results) {
+        copied += result.copiedAssets;
+        if (!result.error.isEmpty()) {
+            ++failures;
+        }
+    }
+    printLine(QString("完成：%1 篇成功，%2 篇失败，复制 %3 个图片，用时 %4 秒")
+                  .arg(results.size() - failures)
+                  .arg(failures)
+                  .arg(copied)
+                  .arg(timer.elapsed() / 1000.0, 0, 'f', 1));
+    return failures;
+}
+
+NotesExporter::Result NotesExporter::exportNote(const QString &noteName, FormulaImages *images) const
+{
+    PERF_SCOPE("NotesExporter::exportNote");
+    Result result;
+    result.note = noteName;
+
+    const QString noteDir = m_resourcesDir + "/" + noteName;
+    const QString outDir = m_outputDir + "/" + noteName;
+    QFile file(noteDir + "/" + noteName + ".md");
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = QString("无法读取笔记: %1").arg(file.errorString());
+    } else if (!QDir().mkpath(outDir)) {
+        result.error = QString("无法创建目录: %1").arg(outDir);
+    }
+    if (!result.error.isEmpty()) {
+        printLine(QString("[失败] %1: %2").arg(noteName, result.error));
+        return result;
+    }
+
+    result.copiedAssets = copyAssets(noteName, &result.error);
+
+    // 与预览相同的原生渲染路径；图片的相对路径按笔记所在目录解析
+    QTextDocument document;
+    document.setBaseUrl(QUrl::fromLocalFile(noteDir + "/"));
+    document.setMetaInformation(QTextDocument::DocumentTitle, noteName);
+    MarkdownDocumentBuilder builder(&document, images);
+    builder.build(QString::fromUtf8(file.readAll()));
+    images->registerResources(&document);
+
+    // 公式图片地址改为相对于笔记输出目录的路径，导出目录整体移动后仍然有效
+    QString html = document.toHtml();
+    html.replace(QUrl::fromLocalFile(formulaDirectory()).toString() + "/", QString("../%1/").arg(FormulaFolder));
+    html.insert(html.indexOf("<head>") + 6, ExportStyle);
+    if (!writeText(outDir + "/" + noteName + ".html", html, &result.error)) {
+        printLine(QString("[失败] %1: %2").arg(noteName, result.error));
+        return result;
+    }
+
+    if (m_pdf) {
+        QPdfWriter writer(outDir + "/" + noteName + ".pdf");
+        writer.setTitle(noteName);
+        writer.setPageSize(QPageSize(QPageSize::A4));
+        writer.setPageMargins(QMarginsF(15, 15, 15, 15), QPageLayout::Millimeter);
+        document.print(&writer);
+    }
+
+    printLine(result.error.isEmpty() ? QString("[完成] %1").arg(noteName)
+                                     : QString("[警告] %1: %2").arg(noteName, result.error));
+    // 图片复制失败只作为警告，不影响笔记本身的导出
+    result.error.clear();
+    return result;
+}
+
+// 复制 assets 目录中的图片，目标文件已是最新时跳过；返回实际复制的文件数
+int NotesExporter::copyAssets(const QString &noteName, QString *error) const
+{
+    const QDir source(m_resourcesDir + "/" + noteName + "/assets");
+    if (!source.exists()) {
+        return 0;
+    }
+    const QString target = m_outputDir + "/" + noteName + "/assets";
+    if (!QDir().mkpath(target)) {
+        *error = QString("无法创建目录: %1").arg(target);
+        return 0;
+    }
+
+    int copied = 0;
+    const QFileInfoList files = source.entryInfoList(QDir::Files);
+    for (const QFileInfo &info : files) {
+        const QString destination = target + "/" + info.fileName();
+        const QFileInfo existing(destination);
+        if (existing.exists() && existing.size() == info.size() && existing.lastModified() >= info.lastModified()) {
+            continue;
+        }
+        QFile::remove(destination);
+        if (QFile::copy(info.filePath(), destination)) {
+            ++copied;
+        } else {
+            *error = QString("无法复制图片: %1").arg(info.fileName());
+        }
+    }
+    return copied;
+}
@@ -0,0 +1,50 @@
+// notesexporter.h
+#ifndef NOTESEXPORTER_H
+#define NOTESEXPORTER_H
+
+#include <QString>
+#include <QStringList>
+
+class FormulaImages;
+
+// 无界面批量导出：把笔记库中的每篇笔记（resources/笔记名/笔记名.md）渲染为 HTML，
+// 可选同时输出 PDF。笔记在线程池中并行渲染；
+// assets 中的图片只在有变化时复制，所有笔记共用一份公式图片目录，相同公式只生成一次。
+// 输出目录结构：
+//   out/笔记名/笔记名.html (.pdf)
+//   out/笔记名/assets/...
+//   out/_formulas/<哈希>.png
+class NotesExporter
+{
+public:
+    NotesExporter(const QString &resourcesDir, const QString &outputDir);
+
+    void setPdfEnabled(bool enabled);
+    // 并行导出的线程数，0 表示使用 CPU 核数
+    void setThreadCount(int threads);
+
+    // 与 MainWindow::setupResourcesAndLoadNotes 相同：resources 下的每个子目录是一篇笔记
+    static QStringList findNotes(const QString &resourcesDir);
+
+    // 导出全部笔记，返回失败的笔记数
+    int run();
+
+private:
+    struct Result
+    {
+        QString note;
+        QString error;    // 为空表示成功
+        int copiedAssets = 0;
+    };
+
+    Result exportNote(const QString &noteName, FormulaImages *images) const;
+    int copyAssets(const QString &noteName, QString *error) const;
+    QString formulaDirectory() const;
+
+    QString m_resourcesDir;
+    QString m_outputDir;
+    bool m_pdf = false;
+    int m_threads = 0;
+};
+
+#endif // NOTESEXPORTER_H
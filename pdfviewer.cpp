@@ -1,4 +1,5 @@
 #include "pdfviewer.h"
+#include "perftrace.h"
 #include <QVBoxLayout>
 #include <QToolBar>
 #include <QAction>
@@ -110,6 +111,7 @@ void PdfViewer::setupStatusBar()
 
 bool PdfViewer::loadPdf(const QString &filePath)
 {
+    PERF_SCOPE("PdfViewer::loadPdf");
     if (!QFileInfo::exists(filePath)) {
         QMessageBox::warning(this, tr("错误"), tr("文件不存在: %1").arg(filePath));
         return false;
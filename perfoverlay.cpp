@@ -0,0 +1,171 @@
+// perfoverlay.cpp
+#include "perfoverlay.h"
+#include "perftrace.h"
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QListWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTimer>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDateTime>
+#include <QHash>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int RefreshInterval = 500;  // 面板刷新间隔（毫秒）
+constexpr int MaxSlowEvents = 50;
+
+struct ZoneStats
+{
+    QString name;
+    int count = 0;
+    double lastMs = 0;
+    double totalMs = 0;
+    double maxMs = 0;
+};
+
+QTableWidgetItem *numberItem(double value)
+{
+    QTableWidgetItem *item = new QTableWidgetItem(QString::number(value, 'f', 2));
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+} // namespace
+
+PerfOverlay::PerfOverlay(QWidget *parent)
+    : QDockWidget(tr("性能"), parent)
+    , m_zones(new QTableWidget(this))
+    , m_slowEvents(new QListWidget(this))
+    , m_summary(new QLabel(this))
+    , m_refreshTimer(new QTimer(this))
+{
+    setObjectName("perfOverlay");
+
+    m_zones->setColumnCount(5);
+    m_zones->setHorizontalHeaderLabels({tr("区域"), tr("次数"), tr("最近 ms"), tr("平均 ms"), tr("最长 ms")});
+    m_zones->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_zones->verticalHeader()->hide();
+    m_zones->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_zones->setSelectionMode(QAbstractItemView::NoSelection);
+
+    QPushButton *exportButton = new QPushButton(tr("导出跟踪..."), this);
+    QPushButton *clearButton = new QPushButton(tr("清空"), this);
+    connect(exportButton, &QPushButton::clicked, this, &PerfOverlay::exportTrace);
+    connect(clearButton, &QPushButton::clicked, this, &PerfOverlay::clearTrace);
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    buttons->addWidget(m_summary, 1);
+    buttons->addWidget(clearButton);
+    buttons->addWidget(exportButton);
+
+    QWidget *content = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(content);
+    layout->setContentsMargins(4, 4, 4, 4);
+    layout->addWidget(m_zones, 3);
+    layout->addWidget(new QLabel(tr("慢操作（超过 %1 ms）").arg(SlowThresholdMs), this));
+    layout->addWidget(m_slowEvents, 2);
+    layout->addLayout(buttons);
+    setWidget(content);
+
+    m_refreshTimer->setInterval(RefreshInterval);
+    connect(m_refreshTimer, &QTimer::timeout, this, &PerfOverlay::refresh);
+}
+
+void PerfOverlay::refresh()
+{
+    const QList<PerfTrace::Event> events = PerfTrace::events();
+
+    // 按区域汇总；事件按时间顺序排列，最后一次出现的就是最近一次
+    QHash<QString, ZoneStats> zones;
+    QList<PerfTrace::Event> slow;
+    for (const PerfTrace::Event &event : events) {
+        const double ms = event.durationNs / 1e6;
+        ZoneStats &stats = zones[QString::fromLatin1(event.name)];
+        ++stats.count;
+        stats.lastMs = ms;
+        stats.totalMs += ms;
+        stats.maxMs = qMax(stats.maxMs, ms);
+        if (ms >= SlowThresholdMs) {
+            slow.append(event);
+        }
+    }
+
+    QList<ZoneStats> sorted;
+    for (auto it = zones.cbegin(); it != zones.cend(); ++it) {
+        ZoneStats stats = it.value();
+        stats.name = it.key();
+        sorted.append(stats);
+    }
+    // 总耗时多的排在前面
+    std::sort(sorted.begin(), sorted.end(), [](const ZoneStats &a, const ZoneStats &b) {
+        return a.totalMs > b.totalMs;
+    });
+
+    m_zones->setRowCount(int(sorted.size()));
+    for (int row = 0; row < sorted.size(); ++row) {
+        const ZoneStats &stats = sorted[row];
+        m_zones->setItem(row, 0, new QTableWidgetItem(stats.name));
+        QTableWidgetItem *count = new QTableWidgetItem(QString::number(stats.count));
+        count->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        m_zones->setItem(row, 1, count);
+        m_zones->setItem(row, 2, numberItem(stats.lastMs));
+        m_zones->setItem(row, 3, numberItem(stats.totalMs / stats.count));
+        m_zones->setItem(row, 4, numberItem(stats.maxMs));
+    }
+
+    // 最近的慢操作在最上面
+    m_slowEvents->clear();
+    const QDateTime started = QDateTime::currentDateTime().addMSecs(-PerfTrace::now() / 1000000);
+    for (qsizetype i = slow.size() - 1; i >= 0 && m_slowEvents->count() < MaxSlowEvents; --i) {
+        const PerfTrace::Event &event = slow[i];
+        const QString time = started.addMSecs(event.startNs / 1000000).toString("HH:mm:ss.zzz");
+        m_slowEvents->addItem(QString("%1  %2  %3 ms")
+                                  .arg(time, QString::fromLatin1(event.name))
+                                  .arg(event.durationNs / 1e6, 0, 'f', 1));
+    }
+
+    const double spanSeconds = events.isEmpty() ? 0.0
+                                                : (PerfTrace::now() - events.first().startNs) / 1e9;
+    m_summary->setText(tr("最近 %1 个事件，%2 秒").arg(events.size()).arg(spanSeconds, 0, 'f', 1));
+}
+
+void PerfOverlay::showEvent(QShowEvent *event)
+{
+    QDockWidget::showEvent(event);
+    refresh();
+    m_refreshTimer->start();
+}
+
+void PerfOverlay::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer->stop();
+    QDockWidget::hideEvent(event);
+}
+
+void PerfOverlay::exportTrace()
+{
+    const QString defaultName = QString("markdownnotes-trace-%1.json")
+                                    .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+    const QString path = QFileDialog::getSaveFileName(this, tr("导出性能跟踪"), defaultName,
+                                                      tr("Chrome 跟踪文件 (*.json)"));
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!PerfTrace::writeChromeTrace(path)) {
+        QMessageBox::warning(this, tr("导出失败"), tr("无法写入文件：%1").arg(path));
+    }
+}
+
+void PerfOverlay::clearTrace()
+{
+    PerfTrace::clear();
+    refresh();
+}
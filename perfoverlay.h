@@ -0,0 +1,43 @@
+// perfoverlay.h
+#ifndef PERFOVERLAY_H
+#define PERFOVERLAY_H
+
+#include <QDockWidget>
+
+class QTableWidget;
+class QListWidget;
+class QLabel;
+class QTimer;
+
+// 性能面板：按区域汇总环形缓冲区中的计时（次数、最近一次、平均、最长），
+// 并列出最近的慢操作；可以把完整跟踪导出为 Chrome 跟踪文件。
+// 面板可见时定期刷新，隐藏时不占用时间
+class PerfOverlay : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PerfOverlay(QWidget *parent = nullptr);
+
+    // 超过这个耗时（毫秒）的事件列入慢操作列表
+    static constexpr double SlowThresholdMs = 50.0;
+
+public slots:
+    void refresh();
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void exportTrace();
+    void clearTrace();
+
+private:
+    QTableWidget *m_zones;
+    QListWidget *m_slowEvents;
+    QLabel *m_summary;
+    QTimer *m_refreshTimer;
+};
+
+#endif // PERFOVERLAY_H
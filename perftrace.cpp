@@ -0,0 +1,162 @@
+// perftrace.cpp
+#include "perftrace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QDebug>
+
+#include <atomic>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> enabled{true};
+std::atomic<int> threadCounter{0};
+
+// 环形缓冲区：next 指向下一条要写入的位置，写满后从头覆盖
+struct Ring
+{
+    QMutex mutex;
+    std::vector<PerfTrace::Event> events = std::vector<PerfTrace::Event>(PerfTrace::Capacity);
+    int next = 0;
+    bool wrapped = false;
+};
+
+Ring &ring()
+{
+    static Ring instance;
+    return instance;
+}
+
+const QElapsedTimer &traceClock()
+{
+    static const QElapsedTimer timer = [] {
+        QElapsedTimer started;
+        started.start();
+        return started;
+    }();
+    return timer;
+}
+
+int currentThreadNumber()
+{
+    thread_local int number = -1;
+    if (number < 0) {
+        const QCoreApplication *app = QCoreApplication::instance();
+        const bool gui = app && QThread::currentThread() == app->thread();
+        number = gui ? 0 : ++threadCounter;
+    }
+    return number;
+}
+
+} // namespace
+
+void PerfTrace::setEnabled(bool on)
+{
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+bool PerfTrace::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+qint64 PerfTrace::now()
+{
+    return traceClock().nsecsElapsed();
+}
+
+void PerfTrace::record(const char *name, qint64 startNs, qint64 durationNs)
+{
+    Event event;
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = durationNs;
+    event.thread = currentThreadNumber();
+
+    Ring &buffer = ring();
+    QMutexLocker locker(&buffer.mutex);
+    buffer.events[buffer.next] = event;
+    if (++buffer.next == Capacity) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+QList<PerfTrace::Event> PerfTrace::events()
+{
+    Ring &buffer = ring();
+    QMutexLocker locker(&buffer.mutex);
+    QList<Event> result;
+    if (buffer.wrapped) {
+        result.reserve(Capacity);
+        result.append(QList<Event>(buffer.events.begin() + buffer.next, buffer.events.end()));
+    } else {
+        result.reserve(buffer.next);
+    }
+    result.append(QList<Event>(buffer.events.begin(), buffer.events.begin() + buffer.next));
+    return result;
+}
+
+void PerfTrace::clear()
+{
+    Ring &buffer = ring();
+    QMutexLocker locker(&buffer.mutex);
+    buffer.next = 0;
+    buffer.wrapped = false;
+}
+
+QByteArray PerfTrace::toChromeJson()
+{
+    const QList<Event> recorded = events();
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+    QSet<int> threads;
+    for (const Event &event : recorded) {
+        // "X" 为完整事件，时间单位是微秒
+        QJsonObject object;
+        object["name"] = QString::fromLatin1(event.name);
+        object["cat"] = "app";
+        object["ph"] = "X";
+        object["ts"] = event.startNs / 1000.0;
+        object["dur"] = event.durationNs / 1000.0;
+        object["pid"] = pid;
+        object["tid"] = event.thread;
+        traceEvents.append(object);
+        threads.insert(event.thread);
+    }
+    // 线程名元数据，让跟踪查看器显示 GUI 线程和后台线程
+    for (int thread : std::as_const(threads)) {
+        QJsonObject object;
+        object["name"] = "thread_name";
+        object["ph"] = "M";
+        object["pid"] = pid;
+        object["tid"] = thread;
+        object["args"] = QJsonObject{{"name", thread == 0 ? QStringLiteral("GUI") : QString("worker %1").arg(thread)}};
+        traceEvents.append(object);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool PerfTrace::writeChromeTrace(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "无法写入性能跟踪文件:" << path;
+        return false;
+    }
+    file.write(toChromeJson());
+    return true;
+}
@@ -0,0 +1,68 @@
+// perftrace.h
+#ifndef PERFTRACE_H
+#define PERFTRACE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// 轻量的性能跟踪：在热点路径上用 PERF_SCOPE("区域名") 计时，
+// 结果写入固定大小的环形缓冲区（旧记录被覆盖），可以导出为 Chrome 跟踪格式
+// （chrome://tracing 或 https://ui.perfetto.dev 打开），也可以在性能面板中实时查看。
+// 可以在任意线程中使用
+class PerfTrace
+{
+public:
+    struct Event
+    {
+        const char *name = nullptr;  // 区域名，必须是字符串字面量
+        qint64 startNs = 0;          // 开始时间，相对于跟踪时钟的起点
+        qint64 durationNs = 0;
+        int thread = 0;              // 线程编号，GUI 线程为 0
+    };
+
+    // 环形缓冲区容量（事件数）
+    static constexpr int Capacity = 8192;
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // 跟踪时钟的当前值（纳秒），时钟在第一次使用时启动
+    static qint64 now();
+    static void record(const char *name, qint64 startNs, qint64 durationNs);
+
+    // 按时间顺序返回缓冲区中的事件
+    static QList<Event> events();
+    static void clear();
+
+    // Chrome 跟踪格式（Trace Event Format）的 JSON
+    static QByteArray toChromeJson();
+    static bool writeChromeTrace(const QString &path);
+};
+
+// 作用域计时器：构造时记录开始时间，析构时写入一条事件
+class PerfScope
+{
+public:
+    explicit PerfScope(const char *name)
+        : m_name(name), m_start(PerfTrace::isEnabled() ? PerfTrace::now() : -1) {}
+    ~PerfScope()
+    {
+        if (m_start >= 0) {
+            PerfTrace::record(m_name, m_start, PerfTrace::now() - m_start);
+        }
+    }
+
+    PerfScope(const PerfScope &) = delete;
+    PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+    const char *m_name;
+    qint64 m_start;
+};
+
+#define PERF_SCOPE_CONCAT_(a, b) a##b
+#define PERF_SCOPE_CONCAT(a, b) PERF_SCOPE_CONCAT_(a, b)
+#define PERF_SCOPE(name) PerfScope PERF_SCOPE_CONCAT(perfScope_, __LINE__)(name)
+
+#endif // PERFTRACE_H
@@ -0,0 +1,376 @@
+// piecetable.cpp
+#include "piecetable.h"
+
+#include <utility>
+#include <vector>
+
+// 只读缓冲区。编辑缓冲区预先分配好容量，追加时不会重新分配，
+// 已经被片段引用的字符地址保持不变，其他线程读取快照时不受追加影响
+struct PieceTable::Buffer
+{
+    explicit Buffer(const QString &text)
+        : storage(text), data(storage.constData()), capacity(text.size()) {}
+    explicit Buffer(qsizetype reserve)
+        : capacity(reserve)
+    {
+        storage.reserve(reserve);
+        data = storage.constData();
+    }
+
+    qsizetype used() const { return storage.size(); }
+    qsizetype room() const { return capacity - storage.size(); }
+
+    QString storage;            // 只由编辑线程访问
+    const QChar *data = nullptr;
+    qsizetype capacity = 0;
+};
+
+struct PieceTable::Node
+{
+    std::shared_ptr<const Buffer> buffer;
+    qsizetype offset = 0;
+    qsizetype length = 0;
+    qsizetype newlines = 0;
+    quint32 priority = 0;
+    NodePtr left;
+    NodePtr right;
+    qsizetype totalLength = 0;    // 子树的字符数
+    qsizetype totalNewlines = 0;  // 子树的换行数
+
+    QStringView view() const { return QStringView(buffer->data + offset, length); }
+};
+
+namespace {
+
+qsizetype countNewlines(QStringView text)
+{
+    qsizetype count = 0;
+    for (QChar c : text) {
+        if (c == u'\n') {
+            ++count;
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+PieceTable::PieceTable() = default;
+
+PieceTable::PieceTable(const QString &text)
+{
+    if (!text.isEmpty()) {
+        m_root = buildLeaves(std::make_shared<const Buffer>(text), 0, text.size());
+    }
+}
+
+qsizetype PieceTable::lengthOf(const NodePtr &node)
+{
+    return node ? node->totalLength : 0;
+}
+
+qsizetype PieceTable::newlinesOf(const NodePtr &node)
+{
+    return node ? node->totalNewlines : 0;
+}
+
+qsizetype PieceTable::size() const
+{
+    return lengthOf(m_root);
+}
+
+qsizetype PieceTable::lineCount() const
+{
+    return newlinesOf(m_root) + 1;
+}
+
+quint32 PieceTable::nextPriority()
+{
+    // xorshift32，只需要分布均匀
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+PieceTable::NodePtr PieceTable::makeNode(const Node &piece, NodePtr left, NodePtr right)
+{
+    auto node = std::make_shared<Node>(piece);
+    node->left = std::move(left);
+    node->right = std::move(right);
+    node->totalLength = lengthOf(node->left) + node->length + lengthOf(node->right);
+    node->totalNewlines = newlinesOf(node->left) + node->newlines + newlinesOf(node->right);
+    return node;
+}
+
+PieceTable::NodePtr PieceTable::makeLeaf(const std::shared_ptr<const Buffer> &buffer, qsizetype offset,
+                                         qsizetype length, qsizetype newlines)
+{
+    Node piece;
+    piece.buffer = buffer;
+    piece.offset = offset;
+    piece.length = length;
+    piece.newlines = newlines;
+    piece.priority = nextPriority();
+    return makeNode(piece, nullptr, nullptr);
+}
+
+PieceTable::NodePtr PieceTable::makeLeaf(const std::shared_ptr<const Buffer> &buffer, qsizetype offset, qsizetype length)
+{
+    return makeLeaf(buffer, offset, length, countNewlines(QStringView(buffer->data + offset, length)));
+}
+
+// 把一段缓冲区按 MaxPieceLength 切成多个片段
+PieceTable::NodePtr PieceTable::buildLeaves(const std::shared_ptr<const Buffer> &buffer, qsizetype offset, qsizetype length)
+{
+    NodePtr result;
+    while (length > 0) {
+        const qsizetype piece = qMin(length, MaxPieceLength);
+        result = merge(result, makeLeaf(buffer, offset, piece));
+        offset += piece;
+        length -= piece;
+    }
+    return result;
+}
+
+// 按字符位置拆成 [0, position) 和 [position, size)，必要时把一个片段拆成两个
+std::pair<PieceTable::NodePtr, PieceTable::NodePtr> PieceTable::split(const NodePtr &node, qsizetype position)
+{
+    if (!node) {
+        return {};
+    }
+    const qsizetype leftLength = lengthOf(node->left);
+    if (position <= leftLength) {
+        auto [a, b] = split(node->left, position);
+        return {a, makeNode(*node, b, node->right)};
+    }
+    if (position >= leftLength + node->length) {
+        auto [a, b] = split(node->right, position - leftLength - node->length);
+        return {makeNode(*node, node->left, a), b};
+    }
+
+    // 位置落在这个片段内部：只统计较短一侧的换行数
+    const qsizetype cut = position - leftLength;
+    const QStringView text = node->view();
+    qsizetype headNewlines;
+    if (cut <= node->length - cut) {
+        headNewlines = countNewlines(text.first(cut));
+    } else {
+        headNewlines = node->newlines - countNewlines(text.sliced(cut));
+    }
+    NodePtr head = makeLeaf(node->buffer, node->offset, cut, headNewlines);
+    NodePtr tail = makeLeaf(node->buffer, node->offset + cut, node->length - cut, node->newlines - headNewlines);
+    return {merge(node->left, head), merge(tail, node->right)};
+}
+
+PieceTable::NodePtr PieceTable::merge(const NodePtr &left, const NodePtr &right)
+{
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+    if (left->priority > right->priority) {
+        return makeNode(*left, left->left, merge(left->right, right));
+    }
+    return makeNode(*right, merge(left, right->left), right->right);
+}
+
+const PieceTable::Node *PieceTable::rightmost(const NodePtr &node)
+{
+    const Node *current = node.get();
+    while (current && current->right) {
+        current = current->right.get();
+    }
+    return current;
+}
+
+PieceTable::NodePtr PieceTable::extendRightmost(const NodePtr &node, qsizetype extra, qsizetype extraNewlines)
+{
+    if (node->right) {
+        return makeNode(*node, node->left, extendRightmost(node->right, extra, extraNewlines));
+    }
+    Node piece = *node;
+    piece.length += extra;
+    piece.newlines += extraNewlines;
+    return makeNode(piece, node->left, nullptr);
+}
+
+void PieceTable::insert(qsizetype position, QStringView text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+    position = qBound<qsizetype>(0, position, size());
+
+    // 追加到编辑缓冲区；剩余空间不够时换一块新的，大段粘贴单独占一块
+    if (!m_add || m_add->room() < text.size()) {
+        m_add = std::make_shared<Buffer>(qMax(AddChunkCapacity, text.size()));
+    }
+    const qsizetype offset = m_add->used();
+    m_add->storage.append(text);
+
+    auto [left, right] = split(m_root, position);
+
+    // 连续输入时，新字符紧接在上一个片段之后，直接延长该片段
+    const Node *last = rightmost(left);
+    if (last && last->buffer == m_add && last->offset + last->length == offset
+        && last->length + text.size() <= MaxPieceLength) {
+        left = extendRightmost(left, text.size(), countNewlines(text));
+    } else {
+        left = merge(left, buildLeaves(m_add, offset, text.size()));
+    }
+    m_root = merge(left, right);
+}
+
+void PieceTable::remove(qsizetype position, qsizetype length)
+{
+    position = qBound<qsizetype>(0, position, size());
+    length = qBound<qsizetype>(0, length, size() - position);
+    if (length == 0) {
+        return;
+    }
+    auto [left, rest] = split(m_root, position);
+    auto [removed, right] = split(rest, length);
+    Q_UNUSED(removed);
+    m_root = merge(left, right);
+}
+
+void PieceTable::clear()
+{
+    m_root.reset();
+}
+
+QChar PieceTable::at(qsizetype position) const
+{
+    const Node *node = m_root.get();
+    while (node) {
+        const qsizetype leftLength = lengthOf(node->left);
+        if (position < leftLength) {
+            node = node->left.get();
+        } else if (position < leftLength + node->length) {
+            return node->buffer->data[node->offset + position - leftLength];
+        } else {
+            position -= leftLength + node->length;
+            node = node->right.get();
+        }
+    }
+    return QChar();
+}
+
+// 按顺序把与 [from, to) 相交的片段追加到 out，坐标相对于 node 子树
+void PieceTable::collect(const NodePtr &node, qsizetype from, qsizetype to, QString &out)
+{
+    if (!node || from >= to) {
+        return;
+    }
+    const qsizetype leftLength = lengthOf(node->left);
+    if (from < leftLength) {
+        collect(node->left, from, qMin(to, leftLength), out);
+    }
+    const qsizetype pieceStart = leftLength;
+    const qsizetype pieceEnd = leftLength + node->length;
+    if (from < pieceEnd && to > pieceStart) {
+        const qsizetype begin = qMax(from, pieceStart) - pieceStart;
+        const qsizetype end = qMin(to, pieceEnd) - pieceStart;
+        out.append(node->view().sliced(begin, end - begin));
+    }
+    if (to > pieceEnd) {
+        collect(node->right, qMax<qsizetype>(0, from - pieceEnd), to - pieceEnd, out);
+    }
+}
+
+QString PieceTable::mid(qsizetype position, qsizetype length) const
+{
+    position = qBound<qsizetype>(0, position, size());
+    length = qBound<qsizetype>(0, length, size() - position);
+    QString result;
+    result.reserve(length);
+    collect(m_root, position, position + length, result);
+    return result;
+}
+
+QString PieceTable::text() const
+{
+    return mid(0, size());
+}
+
+qsizetype PieceTable::lineStart(qsizetype line) const
+{
+    if (line <= 0) {
+        return line == 0 ? 0 : -1;
+    }
+    if (line > newlinesOf(m_root)) {
+        return -1;
+    }
+
+    // 找到第 line 个换行符，行首在它之后
+    qsizetype remaining = line;
+    qsizetype base = 0;
+    const Node *node = m_root.get();
+    while (node) {
+        const qsizetype leftNewlines = newlinesOf(node->left);
+        if (remaining <= leftNewlines) {
+            node = node->left.get();
+            continue;
+        }
+        const qsizetype leftLength = lengthOf(node->left);
+        if (remaining <= leftNewlines + node->newlines) {
+            qsizetype count = remaining - leftNewlines;
+            const QStringView text = node->view();
+            for (qsizetype i = 0; i < text.size(); ++i) {
+                if (text[i] == u'\n' && --count == 0) {
+                    return base + leftLength + i + 1;
+                }
+            }
+            break;
+        }
+        remaining -= leftNewlines + node->newlines;
+        base += leftLength + node->length;
+        node = node->right.get();
+    }
+    return -1;
+}
+
+qsizetype PieceTable::lineAt(qsizetype position) const
+{
+    position = qBound<qsizetype>(0, position, size());
+    qsizetype line = 0;
+    const Node *node = m_root.get();
+    while (node) {
+        const qsizetype leftLength = lengthOf(node->left);
+        if (position < leftLength) {
+            node = node->left.get();
+        } else if (position < leftLength + node->length) {
+            return line + newlinesOf(node->left) + countNewlines(node->view().first(position - leftLength));
+        } else {
+            line += newlinesOf(node->left) + node->newlines;
+            position -= leftLength + node->length;
+            node = node->right.get();
+        }
+    }
+    return line;
+}
+
+qsizetype PieceTable::pieceCount() const
+{
+    // 迭代遍历，避免对很深的子树递归
+    qsizetype count = 0;
+    std::vector<const Node *> stack;
+    if (m_root) {
+        stack.push_back(m_root.get());
+    }
+    while (!stack.empty()) {
+        const Node *node = stack.back();
+        stack.pop_back();
+        ++count;
+        if (node->left) {
+            stack.push_back(node->left.get());
+        }
+        if (node->right) {
+            stack.push_back(node->right.get());
+        }
+    }
+    return count;
+}
@@ -0,0 +1,71 @@
+// piecetable.h
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QString>
+#include <QStringView>
+#include <memory>
+#include <utility>
+
+// 编辑器的纯文本缓冲区（片段表）。
+// 文本由若干片段组成，每个片段引用一块只读缓冲区中的一段：打开的原文，或者追加式的编辑缓冲区。
+// 片段按顺序保存在带子树长度和换行数的平衡树（treap）中，插入、删除、按位置/行号定位都是 O(log n)。
+// 树节点创建后不再修改，编辑时只复制从根到修改位置的路径，
+// 因此复制一个 PieceTable 是 O(1) 的快照，快照不受之后编辑的影响，可以交给其他线程读取。
+// 编辑只能在一个线程中进行
+class PieceTable
+{
+public:
+    PieceTable();
+    explicit PieceTable(const QString &text);
+
+    qsizetype size() const;
+    bool isEmpty() const { return size() == 0; }
+    // 行数 = 换行符数 + 1
+    qsizetype lineCount() const;
+
+    void insert(qsizetype position, QStringView text);
+    void remove(qsizetype position, qsizetype length);
+    void clear();
+
+    QChar at(qsizetype position) const;
+    QString mid(qsizetype position, qsizetype length) const;
+    QString text() const;
+
+    // 第 line 行（从 0 开始）的起始位置，行号超出范围时返回 -1
+    qsizetype lineStart(qsizetype line) const;
+    // position 所在的行号
+    qsizetype lineAt(qsizetype position) const;
+
+    // 片段数，用于调试和性能统计
+    qsizetype pieceCount() const;
+
+    // 单个片段的最大长度：拆分片段时需要统计一侧的换行数，片段越短代价越小
+    static constexpr qsizetype MaxPieceLength = 64 * 1024;
+    // 编辑缓冲区每块的容量（字符数）
+    static constexpr qsizetype AddChunkCapacity = 16 * 1024;
+
+private:
+    struct Buffer;
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    static qsizetype lengthOf(const NodePtr &node);
+    static qsizetype newlinesOf(const NodePtr &node);
+    static NodePtr makeNode(const Node &piece, NodePtr left, NodePtr right);
+    NodePtr makeLeaf(const std::shared_ptr<const Buffer> &buffer, qsizetype offset, qsizetype length);
+    NodePtr makeLeaf(const std::shared_ptr<const Buffer> &buffer, qsizetype offset, qsizetype length, qsizetype newlines);
+    std::pair<NodePtr, NodePtr> split(const NodePtr &node, qsizetype position);
+    static NodePtr merge(const NodePtr &left, const NodePtr &right);
+    static const Node *rightmost(const NodePtr &node);
+    static NodePtr extendRightmost(const NodePtr &node, qsizetype extra, qsizetype extraNewlines);
+    static void collect(const NodePtr &node, qsizetype from, qsizetype to, QString &out);
+    NodePtr buildLeaves(const std::shared_ptr<const Buffer> &buffer, qsizetype offset, qsizetype length);
+    quint32 nextPriority();
+
+    NodePtr m_root;
+    std::shared_ptr<Buffer> m_add;  // 当前的编辑缓冲区块，只追加
+    quint32 m_seed = 0x9e3779b9u;
+};
+
+#endif // PIECETABLE_H
@@ -0,0 +1,205 @@
+// quickopendialog.cpp
+#include "quickopendialog.h"
+#include "perftrace.h"
+
+#include <QLineEdit>
+#include <QListWidget>
+#include <QVBoxLayout>
+#include <QKeyEvent>
+#include <QCoreApplication>
+#include <QStringList>
+#include <QtConcurrent/QtConcurrentRun>
+#include <utility>
+
+QuickOpenDialog::QuickOpenDialog(QWidget *parent)
+    : QDialog(parent)
+    , m_queryEdit(new QLineEdit(this))
+    , m_results(new QListWidget(this))
+    , m_buildWatcher(new QFutureWatcher<CandidatesPtr>(this))
+    , m_matchWatcher(new QFutureWatcher<Matches>(this))
+{
+    setWindowTitle(tr("快速打开"));
+    resize(560, 420);
+
+    m_queryEdit->setPlaceholderText(tr("输入笔记、文档或标题名称..."));
+    m_queryEdit->installEventFilter(this);
+    m_results->setUniformItemSizes(true);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_queryEdit);
+    layout->addWidget(m_results);
+
+    connect(m_queryEdit, &QLineEdit::textChanged, this, &QuickOpenDialog::onQueryChanged);
+    connect(m_queryEdit, &QLineEdit::returnPressed, this, &QuickOpenDialog::activateCurrent);
+    connect(m_results, &QListWidget::itemActivated, this, &QuickOpenDialog::activateCurrent);
+    connect(m_buildWatcher, &QFutureWatcherBase::finished, this, &QuickOpenDialog::onBuilt);
+    connect(m_matchWatcher, &QFutureWatcherBase::finished, this, &QuickOpenDialog::onMatched);
+}
+
+QuickOpenDialog::~QuickOpenDialog()
+{
+    m_buildWatcher->waitForFinished();
+    m_matchWatcher->waitForFinished();
+}
+
+void QuickOpenDialog::rebuild(const Collector &collect)
+{
+    if (m_buildWatcher->isRunning()) {
+        m_pendingCollect = collect;
+        return;
+    }
+    startBuild(collect);
+}
+
+void QuickOpenDialog::startBuild(const Collector &collect)
+{
+    m_buildWatcher->setFuture(QtConcurrent::run([collect]() {
+        PERF_SCOPE("QuickOpenDialog::build");
+        auto candidates = std::make_shared<Candidates>();
+        candidates->items = collect();
+        QStringList texts;
+        texts.reserve(candidates->items.size());
+        for (const QuickOpenItem &item : std::as_const(candidates->items)) {
+            texts.append(item.text);
+        }
+        candidates->matcher = FuzzyMatcher(texts);
+        return CandidatesPtr(std::move(candidates));
+    }));
+}
+
+void QuickOpenDialog::onBuilt()
+{
+    m_candidates = m_buildWatcher->result();
+    if (m_pendingCollect) {
+        startBuild(std::exchange(m_pendingCollect, Collector()));
+    }
+    // 面板打开时用新的候选重新匹配当前的输入
+    if (isVisible()) {
+        onQueryChanged(m_queryEdit->text());
+    }
+}
+
+void QuickOpenDialog::showPalette()
+{
+    m_queryEdit->blockSignals(true);
+    m_queryEdit->clear();
+    m_queryEdit->blockSignals(false);
+    onQueryChanged(QString());
+    show();
+    raise();
+    activateWindow();
+    m_queryEdit->setFocus();
+}
+
+void QuickOpenDialog::onQueryChanged(const QString &query)
+{
+    if (!m_candidates) {
+        // 候选还在生成，完成后（onBuilt）再匹配
+        m_results->clear();
+        m_shown.clear();
+        return;
+    }
+
+    if (query.trimmed().isEmpty()) {
+        // 没有输入时按原顺序列出前面的候选（笔记在最前）
+        m_hasPending = false;
+        Matches matches;
+        for (int i = 0; i < qMin(int(m_candidates->items.size()), ResultLimit); ++i) {
+            matches.append({i, 0});
+        }
+        showMatches(matches);
+        return;
+    }
+
+    if (m_candidates->matcher.size() < BackgroundThreshold) {
+        showMatches(m_candidates->matcher.match(query, ResultLimit));
+        return;
+    }
+    if (m_matchWatcher->isRunning()) {
+        // 上一次匹配结束后只匹配最新的输入
+        m_pendingQuery = query;
+        m_hasPending = true;
+        return;
+    }
+    startMatch(query);
+}
+
+void QuickOpenDialog::startMatch(const QString &query)
+{
+    m_matchingCandidates = m_candidates;
+    const CandidatesPtr candidates = m_candidates;
+    m_matchWatcher->setFuture(QtConcurrent::run([candidates, query]() {
+        return candidates->matcher.match(query, ResultLimit);
+    }));
+}
+
+void QuickOpenDialog::onMatched()
+{
+    if (m_hasPending) {
+        m_hasPending = false;
+        startMatch(m_pendingQuery);
+        return;
+    }
+    // 候选在匹配期间被替换时，结果的下标已经失效
+    if (m_matchingCandidates != m_candidates) {
+        startMatch(m_queryEdit->text());
+        return;
+    }
+    if (!m_queryEdit->text().trimmed().isEmpty()) {
+        showMatches(m_matchWatcher->result());
+    }
+}
+
+void QuickOpenDialog::showMatches(const Matches &matches)
+{
+    m_results->clear();
+    m_shown.clear();
+    for (const FuzzyMatcher::Match &match : matches) {
+        const QuickOpenItem &item = m_candidates->items.at(match.index);
+        QListWidgetItem *row = new QListWidgetItem(displayText(item), m_results);
+        if (item.kind != QuickOpenItem::Note) {
+            row->setToolTip(item.note + "/" + item.path);
+        }
+        m_shown.append(item);
+    }
+    if (m_results->count() > 0) {
+        m_results->setCurrentRow(0);
+    }
+}
+
+QString QuickOpenDialog::displayText(const QuickOpenItem &item) const
+{
+    switch (item.kind) {
+    case QuickOpenItem::Note:
+        return tr("笔记：%1").arg(item.note);
+    case QuickOpenItem::File:
+        return item.note + "/" + item.path;
+    case QuickOpenItem::Heading:
+        return QString("# %1    %2/%3:%4").arg(item.text, item.note, item.path).arg(item.line);
+    }
+    return item.text;
+}
+
+void QuickOpenDialog::activateCurrent()
+{
+    const int row = m_results->currentRow();
+    if (row < 0 || row >= m_shown.size()) {
+        return;
+    }
+    const QuickOpenItem item = m_shown.at(row);
+    accept();
+    emit itemActivated(item);
+}
+
+// 输入框中的上下键和翻页键移动结果列表的选中项
+bool QuickOpenDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_queryEdit && event->type() == QEvent::KeyPress) {
+        const int key = static_cast<QKeyEvent *>(event)->key();
+        if (key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_PageUp || key == Qt::Key_PageDown) {
+            QCoreApplication::sendEvent(m_results, event);
+            return true;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
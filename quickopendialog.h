@@ -0,0 +1,92 @@
+// quickopendialog.h
+#ifndef QUICKOPENDIALOG_H
+#define QUICKOPENDIALOG_H
+
+#include "fuzzymatcher.h"
+
+#include <QDialog>
+#include <QList>
+#include <QString>
+#include <QFutureWatcher>
+#include <functional>
+#include <memory>
+
+class QLineEdit;
+class QListWidget;
+
+// 快速打开的一个候选：笔记、笔记目录中的文档或文档中的标题
+struct QuickOpenItem
+{
+    enum Kind { Note, File, Heading };
+    Kind kind = Note;
+    QString note;
+    QString path;  // 相对笔记目录（文档和标题）
+    int line = 0;  // 标题所在行，从 1 开始
+    QString text;  // 参与匹配的文字
+};
+
+// 快速打开面板（Ctrl+P）：输入时对笔记名称、文档名称和标题做模糊匹配，回车打开选中的结果。
+// 候选和匹配器在后台生成并缓存，笔记库变化后由调用者请求重新生成，打开面板时直接使用。
+// 候选较多时匹配也在后台线程进行，输入过快时只匹配最新的查询
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // 生成候选的函数，在后台线程调用
+    using Collector = std::function<QList<QuickOpenItem>()>;
+
+    explicit QuickOpenDialog(QWidget *parent = nullptr);
+    ~QuickOpenDialog();
+
+    // 显示的结果数
+    static constexpr int ResultLimit = 50;
+    // 候选超过这个数时在后台匹配
+    static constexpr int BackgroundThreshold = 20000;
+
+    // 在后台重新生成候选；正在生成时，完成后再用最新的 collect 生成一次
+    void rebuild(const Collector &collect);
+    // 清空输入框并显示面板
+    void showPalette();
+
+signals:
+    void itemActivated(const QuickOpenItem &item);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void onQueryChanged(const QString &query);
+    void onMatched();
+    void onBuilt();
+    void activateCurrent();
+
+private:
+    using Matches = QList<FuzzyMatcher::Match>;
+
+    // 一组候选和它们的匹配器，生成后只读，后台匹配时共享
+    struct Candidates
+    {
+        QList<QuickOpenItem> items;
+        FuzzyMatcher matcher;
+    };
+    using CandidatesPtr = std::shared_ptr<const Candidates>;
+
+    void startBuild(const Collector &collect);
+    void startMatch(const QString &query);
+    void showMatches(const Matches &matches);
+    QString displayText(const QuickOpenItem &item) const;
+
+    QLineEdit *m_queryEdit;
+    QListWidget *m_results;
+    CandidatesPtr m_candidates;
+    QList<QuickOpenItem> m_shown;  // 结果列表中显示的候选，按行排列
+    QFutureWatcher<CandidatesPtr> *m_buildWatcher;
+    Collector m_pendingCollect;
+    QFutureWatcher<Matches> *m_matchWatcher;
+    CandidatesPtr m_matchingCandidates;  // 正在后台匹配的候选
+    QString m_pendingQuery;
+    bool m_hasPending = false;
+};
+
+#endif // QUICKOPENDIALOG_H